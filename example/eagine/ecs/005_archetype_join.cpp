@@ -0,0 +1,121 @@
+/// @example eagine/ecs/005_archetype_join.hpp
+///
+/// Copyright Matus Chochlik.
+/// Distributed under the Boost Software License, Version 1.0.
+/// See accompanying file LICENSE_1_0.txt or copy at
+/// https://www.boost.org/LICENSE_1_0.txt
+///
+import eagine.core;
+import eagine.ecs;
+import std;
+
+namespace eagine {
+//------------------------------------------------------------------------------
+struct cmp_a : ecs::component<"A"> {
+    float value{1.F};
+};
+
+struct cmp_b : ecs::component<"B"> {
+    float value{2.F};
+};
+
+struct cmp_c : ecs::component<"C"> {
+    float value{3.F};
+};
+
+struct cmp_d : ecs::component<"D"> {
+    float value{4.F};
+};
+
+struct cmp_e : ecs::component<"E"> {
+    float value{5.F};
+};
+//------------------------------------------------------------------------------
+using benchmark_manager = ecs::basic_manager<std::uint64_t>;
+
+void populate(benchmark_manager& mgr, std::uint64_t count) {
+    for(std::uint64_t e = 1; e <= count; ++e) {
+        mgr.add(e, cmp_a{}, cmp_b{}, cmp_c{});
+        if(e % 2U == 0U) {
+            mgr.add(e, cmp_d{}, cmp_e{});
+        }
+    }
+}
+//------------------------------------------------------------------------------
+template <typename Function>
+auto measure(Function func, int repeats) -> float {
+    const auto start{std::chrono::steady_clock::now()};
+    for(int r = 0; r < repeats; ++r) {
+        func();
+    }
+    return std::chrono::duration<float, std::milli>(
+             std::chrono::steady_clock::now() - start)
+             .count() /
+           float(repeats);
+}
+//------------------------------------------------------------------------------
+void run_joins(
+  main_ctx& ctx,
+  benchmark_manager& mgr,
+  std::string_view storage,
+  int repeats) {
+    float sum{0.F};
+    const auto join3{measure(
+      [&] {
+          mgr.for_each_with<cmp_a, const cmp_b, const cmp_c>(
+            [&](const auto, auto& a, auto& b, auto& c) {
+                a->value += b->value * c->value;
+                sum += a->value;
+            });
+      },
+      repeats)};
+    const auto join5{measure(
+      [&] {
+          mgr.for_each_with<cmp_a, const cmp_b, const cmp_c, cmp_d, cmp_e>(
+            [&](const auto, auto& a, auto& b, auto& c, auto& d, auto& e) {
+                d->value = a->value + b->value;
+                e->value = c->value * d->value;
+                sum += e->value;
+            });
+      },
+      repeats)};
+
+    ctx.cio()
+      .print("ECS", "${storage}: 3-way join ${join3}ms, 5-way join ${join5}ms")
+      .arg("storage", storage)
+      .arg("join3", join3)
+      .arg("join5", join5)
+      .arg("checksum", sum);
+}
+//------------------------------------------------------------------------------
+auto main(main_ctx& ctx) -> int {
+    const std::uint64_t count{100000U};
+    const int repeats{10};
+
+    {
+        benchmark_manager mgr;
+        mgr.register_component_storages<
+          ecs::flat_map_cmp_storage,
+          cmp_a,
+          cmp_b,
+          cmp_c,
+          cmp_d,
+          cmp_e>();
+        populate(mgr, count);
+        run_joins(ctx, mgr, "flat_map", repeats);
+    }
+    {
+        benchmark_manager mgr;
+        mgr.register_archetype_storages<cmp_a, cmp_b, cmp_c, cmp_d, cmp_e>();
+        populate(mgr, count);
+        run_joins(ctx, mgr, "archetype", repeats);
+    }
+
+    return 0;
+}
+//------------------------------------------------------------------------------
+} // namespace eagine
+
+auto main(int argc, const char** argv) -> int {
+    return eagine::default_main(argc, argv, eagine::main);
+}
@@ -0,0 +1,467 @@
+/// @example eagine/ecs/benchmarks/main.cpp
+///
+/// Copyright Matus Chochlik.
+/// Distributed under the Boost Software License, Version 1.0.
+/// See accompanying file LICENSE_1_0.txt or copy at
+/// https://www.boost.org/LICENSE_1_0.txt
+///
+import eagine.core;
+import eagine.ecs;
+import std;
+
+namespace eagine {
+//------------------------------------------------------------------------------
+struct cmp_a : ecs::component<"A"> {
+    float value{1.F};
+};
+
+struct cmp_b : ecs::component<"B"> {
+    float value{2.F};
+};
+
+struct cmp_c : ecs::component<"C"> {
+    float value{3.F};
+};
+
+struct cmp_d : ecs::component<"D"> {
+    float value{4.F};
+};
+
+struct cmp_e : ecs::component<"E"> {
+    float value{5.F};
+};
+
+struct link : ecs::relation<"Link"> {};
+//------------------------------------------------------------------------------
+using benchmark_manager = ecs::basic_manager<std::uint64_t>;
+//------------------------------------------------------------------------------
+// Results
+//------------------------------------------------------------------------------
+// prints the results to the console and optionally saves them into a file
+class result_writer {
+public:
+    result_writer(main_ctx& ctx, std::ostream* out, bool csv) noexcept
+      : _ctx{ctx}
+      , _out{out}
+      , _csv{csv} {
+        if(_out) {
+            if(_csv) {
+                *_out
+                  << "backend,operation,entities,items,total_ns,ns_per_item\n";
+            } else {
+                *_out << "[";
+            }
+        }
+    }
+
+    result_writer(result_writer&&) = delete;
+    result_writer(const result_writer&) = delete;
+    auto operator=(result_writer&&) = delete;
+    auto operator=(const result_writer&) = delete;
+
+    ~result_writer() noexcept {
+        if(_out) {
+            if(not _csv) {
+                *_out << "\n]\n";
+            }
+            _out->flush();
+        }
+    }
+
+    void add(
+      std::string_view backend,
+      std::string_view operation,
+      std::size_t entities,
+      std::size_t items,
+      std::chrono::nanoseconds total) {
+        const auto ns{double(total.count())};
+        const auto per_item{items > 0U ? ns / double(items) : 0.0};
+        _ctx.cio()
+          .print(
+            "ECS",
+            "${backend} ${operation} (${entities} entities): "
+            "${perItem}ns per item")
+          .arg("backend", backend)
+          .arg("operation", operation)
+          .arg("entities", entities)
+          .arg("perItem", per_item);
+        if(not _out) {
+            return;
+        }
+        auto& out{*_out};
+        if(_csv) {
+            out << backend << ',' << operation << ',' << entities << ','
+                << items << ',' << total.count() << ',' << per_item << '\n';
+        } else {
+            out << (_first ? "\n" : ",\n") << "  {\"backend\": \"" << backend
+                << "\", \"operation\": \"" << operation
+                << "\", \"entities\": " << entities
+                << ", \"items\": " << items
+                << ", \"total_ns\": " << total.count()
+                << ", \"ns_per_item\": " << per_item << "}";
+            _first = false;
+        }
+        out.flush();
+    }
+
+private:
+    main_ctx& _ctx;
+    std::ostream* _out;
+    bool _csv;
+    bool _first{true};
+};
+//------------------------------------------------------------------------------
+// stores the value into a volatile, so that the measured loops are kept
+template <typename T>
+void do_not_optimize(const T& value) noexcept {
+    static volatile T sink{};
+    sink = value;
+}
+//------------------------------------------------------------------------------
+template <typename Function>
+auto measure(Function func) -> std::chrono::nanoseconds {
+    const auto start{std::chrono::steady_clock::now()};
+    func();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start);
+}
+//------------------------------------------------------------------------------
+// evenly spread subset of the entities used by the point operations
+auto sample_of(const std::vector<std::uint64_t>& entities)
+  -> std::vector<std::uint64_t> {
+    const std::size_t count{std::min<std::size_t>(entities.size(), 256U)};
+    std::vector<std::uint64_t> result;
+    result.reserve(count);
+    for(std::size_t i = 0; i < count; ++i) {
+        result.push_back(entities[i * entities.size() / count]);
+    }
+    return result;
+}
+//------------------------------------------------------------------------------
+// Components
+//------------------------------------------------------------------------------
+template <typename Register>
+void run_components(
+  result_writer& results,
+  std::string_view backend,
+  Register register_storages,
+  std::size_t count) {
+    benchmark_manager mgr;
+    register_storages(mgr);
+
+    std::vector<std::uint64_t> entities;
+    entities.reserve(count);
+    results.add(backend, "spawn", count, count, measure([&] {
+                    for(std::size_t i = 0; i < count; ++i) {
+                        entities.push_back(mgr.spawn());
+                    }
+                }));
+
+    std::size_t added{0U};
+    const auto add_time{measure([&] {
+        for(std::size_t i = 0; i < count; ++i) {
+            const auto e{entities[i]};
+            mgr.add(e, cmp_a{}, cmp_b{}, cmp_c{});
+            added += 3U;
+            if(i % 2U == 0U) {
+                mgr.add(e, cmp_d{});
+                ++added;
+            }
+            if(i % 3U == 0U) {
+                mgr.add(e, cmp_e{});
+                ++added;
+            }
+        }
+    })};
+    results.add(backend, "add", count, added, add_time);
+
+    float sum{0.F};
+    std::size_t visited{0U};
+    const auto visit{[&](auto& m) {
+        sum += m.read().value;
+        ++visited;
+    }};
+
+    visited = 0U;
+    const auto each_time{measure([&] {
+        mgr.for_each_with<const cmp_a>(
+          [&](const auto, auto& a) { visit(a); });
+    })};
+    results.add(backend, "for_each", count, visited, each_time);
+
+    visited = 0U;
+    const auto join2_time{measure([&] {
+        mgr.for_each_with<cmp_a, const cmp_b>(
+          [&](const auto, auto& a, auto& b) {
+              a.write().value += b.read().value;
+              visit(a);
+          });
+    })};
+    results.add(backend, "join2", count, visited, join2_time);
+
+    visited = 0U;
+    const auto join3_time{measure([&] {
+        mgr.for_each_with<cmp_a, const cmp_b, const cmp_c>(
+          [&](const auto, auto& a, auto& b, auto& c) {
+              a.write().value += b.read().value * c.read().value;
+              visit(a);
+          });
+    })};
+    results.add(backend, "join3", count, visited, join3_time);
+
+    visited = 0U;
+    const auto join4_time{measure([&] {
+        mgr.for_each_with<cmp_a, const cmp_b, const cmp_c, const cmp_d>(
+          [&](const auto, auto& a, auto& b, auto& c, auto& d) {
+              a.write().value += b.read().value * c.read().value;
+              a.write().value -= d.read().value;
+              visit(a);
+          });
+    })};
+    results.add(backend, "join4", count, visited, join4_time);
+
+    visited = 0U;
+    const auto join5_time{measure([&] {
+        mgr.for_each_with<cmp_a, const cmp_b, const cmp_c, cmp_d, const cmp_e>(
+          [&](const auto, auto& a, auto& b, auto& c, auto& d, auto& e) {
+              d.write().value = a.read().value + b.read().value;
+              a.write().value = c.read().value * d.read().value;
+              a.write().value -= e.read().value;
+              visit(a);
+          });
+    })};
+    results.add(backend, "join5", count, visited, join5_time);
+
+    visited = 0U;
+    const auto opt_time{measure([&] {
+        mgr.for_each_with_opt<const cmp_a, const cmp_d>(
+          [&](const auto, auto& a, auto& d) {
+              if(d.has_value()) {
+                  sum += d.read().value;
+              }
+              visit(a);
+          });
+    })};
+    results.add(backend, "for_each_opt", count, visited, opt_time);
+
+    const auto sample{sample_of(entities)};
+    results.add(backend, "hide", count, sample.size(), measure([&] {
+                    for(const auto e : sample) {
+                        mgr.hide<cmp_b>(e);
+                    }
+                }));
+    results.add(backend, "show", count, sample.size(), measure([&] {
+                    for(const auto e : sample) {
+                        mgr.show<cmp_b>(e);
+                    }
+                }));
+    results.add(backend, "remove", count, sample.size(), measure([&] {
+                    for(const auto e : sample) {
+                        mgr.remove<cmp_c>(e);
+                    }
+                }));
+    results.add(backend, "forget", count, sample.size(), measure([&] {
+                    for(const auto e : sample) {
+                        mgr.forget(e);
+                    }
+                }));
+
+    do_not_optimize(sum);
+}
+//------------------------------------------------------------------------------
+template <template <class, class> class Storage>
+void run_components(
+  result_writer& results,
+  std::string_view backend,
+  std::size_t count) {
+    run_components(
+      results,
+      backend,
+      [](benchmark_manager& mgr) {
+          mgr.register_component_storages<
+            Storage,
+            cmp_a,
+            cmp_b,
+            cmp_c,
+            cmp_d,
+            cmp_e>();
+      },
+      count);
+}
+//------------------------------------------------------------------------------
+// Relations
+//------------------------------------------------------------------------------
+template <template <class, class> class Storage>
+void run_relations(
+  result_writer& results,
+  std::string_view backend,
+  std::size_t count) {
+    benchmark_manager mgr;
+    mgr.register_relation_storage<Storage, link>();
+
+    // each subject links to the following few objects, in sorted order
+    const std::uint64_t fanout{4U};
+    const auto store_time{measure([&] {
+        for(std::uint64_t s = 1; s <= count; ++s) {
+            for(std::uint64_t o = 1; o <= fanout; ++o) {
+                mgr.ensure<link>(s, s + o);
+            }
+        }
+    })};
+    results.add(backend, "store", count, count * fanout, store_time);
+
+    std::size_t visited{0U};
+    const auto visit{[&](std::uint64_t, std::uint64_t) {
+        ++visited;
+    }};
+    const callable_ref<void(std::uint64_t, std::uint64_t)> func{
+      construct_from, visit};
+
+    results.add(backend, "for_each", count, count * fanout, measure([&] {
+                    mgr.for_each_having<link>(func);
+                }));
+
+    std::vector<std::uint64_t> entities(count);
+    std::iota(entities.begin(), entities.end(), std::uint64_t(1U));
+    const auto sample{sample_of(entities)};
+
+    visited = 0U;
+    const auto objects_time{measure([&] {
+        for(const auto s : sample) {
+            mgr.for_each_object_of<link>(s, func);
+        }
+    })};
+    results.add(backend, "for_each_object_of", count, visited, objects_time);
+
+    visited = 0U;
+    const auto subjects_time{measure([&] {
+        for(const auto o : sample) {
+            mgr.for_each_subject_of<link>(o, func);
+        }
+    })};
+    results.add(backend, "for_each_subject_of", count, visited, subjects_time);
+
+    results.add(backend, "remove", count, sample.size(), measure([&] {
+                    for(const auto s : sample) {
+                        mgr.remove_relation<link>(s, s + 1U);
+                    }
+                }));
+}
+//------------------------------------------------------------------------------
+// Main
+//------------------------------------------------------------------------------
+struct benchmark_options {
+    std::size_t min_entities{1000U};
+    std::size_t max_entities{10000000U};
+    std::string_view backend{};
+    std::string_view output{};
+    bool csv{false};
+};
+//------------------------------------------------------------------------------
+void run_benchmarks(
+  main_ctx& ctx,
+  const benchmark_options& opts,
+  std::ostream* out) {
+    result_writer results{ctx, out, opts.csv};
+    const auto enabled{[&](std::string_view backend) {
+        return opts.backend.empty() or (opts.backend == backend);
+    }};
+
+    for(std::size_t count = opts.min_entities; count <= opts.max_entities;
+        count *= 10U) {
+        if(enabled("std_map")) {
+            run_components<ecs::std_map_cmp_storage>(results, "std_map", count);
+            run_relations<ecs::std_map_rel_storage>(results, "std_map", count);
+        }
+        if(enabled("flat_map")) {
+            run_components<ecs::flat_map_cmp_storage>(
+              results, "flat_map", count);
+            run_relations<ecs::flat_map_rel_storage>(
+              results, "flat_map", count);
+        }
+        if(enabled("chunk_map")) {
+            run_components<ecs::chunk_map_cmp_storage>(
+              results, "chunk_map", count);
+            run_relations<ecs::chunk_map_rel_storage>(
+              results, "chunk_map", count);
+        }
+        if(enabled("flat_map_indexed")) {
+            run_relations<ecs::flat_map_indexed_rel_storage>(
+              results, "flat_map_indexed", count);
+        }
+        if(enabled("sparse_set")) {
+            run_components<ecs::sparse_set_cmp_storage>(
+              results, "sparse_set", count);
+        }
+        if(enabled("archetype")) {
+            run_components(
+              results,
+              "archetype",
+              [](benchmark_manager& mgr) {
+                  mgr.register_archetype_storages<
+                    cmp_a,
+                    cmp_b,
+                    cmp_c,
+                    cmp_d,
+                    cmp_e>();
+              },
+              count);
+        }
+    }
+}
+//------------------------------------------------------------------------------
+auto parse_count(const program_arg& arg, std::size_t& count) -> bool {
+    const auto value{arg.get()};
+    const auto result{
+      std::from_chars(value.data(), value.data() + value.size(), count)};
+    return result.ec == std::errc{};
+}
+//------------------------------------------------------------------------------
+auto main(main_ctx& ctx) -> int {
+    benchmark_options opts;
+    const auto& args{ctx.args()};
+    opts.csv = bool(args.find("--csv"));
+    if(const auto arg{args.find("--min-entities")}) {
+        if(not parse_count(arg.next(), opts.min_entities)) {
+            ctx.cio()
+              .print("ECS", "invalid ${option} value")
+              .arg("option", "--min-entities");
+            return 1;
+        }
+    }
+    if(const auto arg{args.find("--max-entities")}) {
+        if(not parse_count(arg.next(), opts.max_entities)) {
+            ctx.cio()
+              .print("ECS", "invalid ${option} value")
+              .arg("option", "--max-entities");
+            return 1;
+        }
+    }
+    if(const auto arg{args.find("--backend")}) {
+        opts.backend = arg.next().get();
+    }
+    if(const auto arg{args.find("--output")}) {
+        opts.output = arg.next().get();
+    }
+    opts.min_entities = std::max<std::size_t>(opts.min_entities, 1U);
+
+    if(opts.output.empty()) {
+        run_benchmarks(ctx, opts, nullptr);
+    } else {
+        std::ofstream output{std::string{opts.output}};
+        if(not output) {
+            ctx.cio()
+              .print("ECS", "cannot open ${path}")
+              .arg("path", opts.output);
+            return 1;
+        }
+        run_benchmarks(ctx, opts, &output);
+    }
+    return 0;
+}
+//------------------------------------------------------------------------------
+} // namespace eagine
+
+auto main(int argc, const char** argv) -> int {
+    return eagine::default_main(argc, argv, eagine::main);
+}
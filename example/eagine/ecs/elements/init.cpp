@@ -30,22 +30,20 @@ public:
         assert(not path.empty());
         assert(not data.empty());
 
-        const element_symbol elem{path.front()};
         if(path.size() == 2) {
             if(path.back() == "protons") {
-                _elements.ensure<element_protons>(elem).set(
+                _ensure<element_protons>(path.front()).set(
                   limit_cast<short>(data.front()));
             } else if(path.back() == "period") {
-                _elements.ensure<element_period>(elem).set(
+                _ensure<element_period>(path.front()).set(
                   limit_cast<short>(data.front()));
             } else if(path.back() == "group") {
-                _elements.ensure<element_group>(elem).set(
+                _ensure<element_group>(path.front()).set(
                   limit_cast<short>(data.front()));
             }
         } else if(path.size() == 4 and path[1] == "isotopes") {
-            element_symbol isot{path[2]};
             if(path.back() == "neutrons") {
-                _elements.ensure<isotope_neutrons>(isot).set(
+                _ensure<isotope_neutrons>(path[2]).set(
                   limit_cast<short>(data.front()));
             }
         }
@@ -56,10 +54,9 @@ public:
         assert(not path.empty());
         assert(not data.empty());
 
-        const element_symbol elem{path.front()};
         if(path.size() == 2) {
             if(path.back() == "atomic_weight") {
-                _elements.ensure<atomic_weight>(elem).set(
+                _ensure<atomic_weight>(path.front()).set(
                   limit_cast<float>(data.front()));
             }
         }
@@ -71,39 +68,36 @@ public:
         assert(not path.empty());
         assert(not data.empty());
 
-        const element_symbol elem{path.front()};
         if(path.size() == 3) {
             if(path.back() == "latin") {
-                _elements.ensure<element_name>(elem).set_latin_name(
+                _ensure<element_name>(path.front()).set_latin_name(
                   to_string(data.front()));
             } else if(path.back() == "english") {
-                _elements.ensure<element_name>(elem).set_english_name(
+                _ensure<element_name>(path.front()).set_english_name(
                   to_string(data.front()));
             }
         } else if(path.size() == 4 and path[1] == "isotopes") {
-            element_symbol isot{path[2]};
             if(path.back() == "half_life") {
                 data.and_then(from_string<std::chrono::duration<float>>(_1))
                   .and_then([&](auto hl) -> noopt {
-                      _elements.ensure<half_life>(isot).set(hl);
+                      _ensure<half_life>(path[2]).set(hl);
                       return {};
                   });
             }
         } else if(path.size() == 6 and path[1] == "isotopes") {
             if(path.back() == "latin") {
-                _elements.ensure<element_name>(elem).set_latin_name(
+                _ensure<element_name>(path.front()).set_latin_name(
                   to_string(data.front()));
             } else if(path.back() == "english") {
-                _elements.ensure<element_name>(elem).set_english_name(
+                _ensure<element_name>(path.front()).set_english_name(
                   to_string(data.front()));
             }
         }
         if(path.starts_with(_decay_path)) {
-            element_symbol isot{path[2]};
             if(path.back() == "mode") {
-                _elements.ensure<decay_modes>(isot).add(data.front());
+                _ensure<decay_modes>(path[2]).add(data.front());
             } else if(path[5] == "products") {
-                _elements.ensure<decay_modes>(isot).back().and_then(
+                _ensure<decay_modes>(path[2]).back().and_then(
                   [&](auto& mode) -> noopt {
                       for(auto prod : data) {
                           mode.products.push_back(to_string(prod));
@@ -133,6 +127,14 @@ public:
 
 private:
     ecs::basic_manager<element_symbol>& _elements;
+
+    // looks the element up by the symbol from the path, without making
+    // an element_symbol unless the component is added
+    template <typename Component>
+    auto _ensure(string_view symbol) -> ecs::manipulator<Component> {
+        return _elements.ensure<ecs::hash_map_cmp_storage, Component>(symbol);
+    }
+
     const basic_string_path _decay_path{"*/isotopes/*/decay/_"};
 };
 //------------------------------------------------------------------------------
@@ -189,21 +191,23 @@ static void do_initialize(
   const embedded_resource& json_res) {
     // components
     elements
-      .register_component_storage<ecs::std_map_cmp_storage, element_name>();
+      .register_component_storage<ecs::hash_map_cmp_storage, element_name>();
     elements
-      .register_component_storage<ecs::std_map_cmp_storage, element_protons>();
+      .register_component_storage<ecs::hash_map_cmp_storage, element_protons>();
+    elements.register_component_storage<
+      ecs::hash_map_cmp_storage,
+      isotope_neutrons>();
     elements
-      .register_component_storage<ecs::std_map_cmp_storage, isotope_neutrons>();
+      .register_component_storage<ecs::hash_map_cmp_storage, element_period>();
     elements
-      .register_component_storage<ecs::std_map_cmp_storage, element_period>();
+      .register_component_storage<ecs::hash_map_cmp_storage, element_group>();
     elements
-      .register_component_storage<ecs::std_map_cmp_storage, element_group>();
+      .register_component_storage<ecs::hash_map_cmp_storage, atomic_weight>();
+    elements.register_component_storage<ecs::hash_map_cmp_storage, half_life>();
     elements
-      .register_component_storage<ecs::std_map_cmp_storage, atomic_weight>();
-    elements.register_component_storage<ecs::std_map_cmp_storage, half_life>();
-    elements.register_component_storage<ecs::std_map_cmp_storage, decay_modes>();
+      .register_component_storage<ecs::hash_map_cmp_storage, decay_modes>();
     // relations
-    elements.register_relation_storage<ecs::std_map_rel_storage, isotope>();
+    elements.register_relation_storage<ecs::hash_map_rel_storage, isotope>();
 
     auto input{valtree::traverse_json_stream(
       std::make_shared<elements_data_loader>(elements),
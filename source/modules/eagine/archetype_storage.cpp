@@ -0,0 +1,1065 @@
+/// @file
+///
+/// Copyright Matus Chochlik.
+/// Distributed under the Boost Software License, Version 1.0.
+/// See accompanying file LICENSE_1_0.txt or copy at
+/// https://www.boost.org/LICENSE_1_0.txt
+///
+module;
+
+#include <cassert>
+
+export module eagine.ecs:archetype_storage;
+
+import std;
+import eagine.core.types;
+import eagine.core.utility;
+import :entity_traits;
+import :manipulator;
+import :storage;
+
+namespace eagine::ecs {
+//------------------------------------------------------------------------------
+// Archetype column
+//------------------------------------------------------------------------------
+template <typename Entity>
+struct archetype_column_intf : interface<archetype_column_intf<Entity>> {
+    virtual auto make_empty() const -> unique_holder<archetype_column_intf> = 0;
+
+    virtual auto is_hidden(std::size_t row) const noexcept -> bool = 0;
+
+    virtual void set_hidden(std::size_t row, bool) noexcept = 0;
+
+    virtual void move_row_to(std::size_t row, archetype_column_intf&) = 0;
+
+    virtual void erase_row(std::size_t row) = 0;
+};
+//------------------------------------------------------------------------------
+template <typename Entity, typename Component>
+class archetype_column final : public archetype_column_intf<Entity> {
+public:
+    auto make_empty() const
+      -> unique_holder<archetype_column_intf<Entity>> final {
+        return {hold<archetype_column>};
+    }
+
+    auto is_hidden(std::size_t row) const noexcept -> bool final {
+        assert(row < _hidden.size());
+        return _hidden[row];
+    }
+
+    void set_hidden(std::size_t row, bool hidden) noexcept final {
+        assert(row < _hidden.size());
+        _hidden[row] = hidden;
+    }
+
+    void move_row_to(std::size_t row, archetype_column_intf<Entity>& dst) final {
+        assert(row < _data.size());
+        assert(dynamic_cast<archetype_column*>(&dst));
+        static_cast<archetype_column&>(dst).push_back(
+          std::move(_data[row]), _hidden[row]);
+    }
+
+    void erase_row(std::size_t row) final {
+        assert(row < _data.size());
+        const auto last{_data.size() - 1U};
+        if(row != last) {
+            _data[row] = std::move(_data[last]);
+            _hidden[row] = _hidden[last];
+        }
+        _data.pop_back();
+        _hidden.pop_back();
+    }
+
+    auto push_back(Component&& component, bool hidden) -> Component& {
+        _data.push_back(std::move(component));
+        _hidden.push_back(hidden);
+        return _data.back();
+    }
+
+    auto at(std::size_t row) noexcept -> Component& {
+        assert(row < _data.size());
+        return _data[row];
+    }
+
+    auto rows(std::size_t first, std::size_t count) noexcept
+      -> std::span<Component> {
+        assert(first + count <= _data.size());
+        return {_data.data() + first, count};
+    }
+
+private:
+    std::vector<Component> _data;
+    std::vector<bool> _hidden;
+};
+//------------------------------------------------------------------------------
+// Archetype table
+//------------------------------------------------------------------------------
+template <typename Entity>
+class archetype_table {
+public:
+    using column_ptr = unique_holder<archetype_column_intf<Entity>>;
+
+    archetype_table(
+      std::vector<identifier_t> signature,
+      std::vector<column_ptr> columns) noexcept
+      : _signature{std::move(signature)}
+      , _columns{std::move(columns)} {
+        assert(_signature.size() == _columns.size());
+    }
+
+    [[nodiscard]] auto signature() const noexcept
+      -> const std::vector<identifier_t>& {
+        return _signature;
+    }
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t {
+        return _entities.size();
+    }
+
+    [[nodiscard]] auto entity(std::size_t row) const noexcept -> const Entity& {
+        assert(row < size());
+        return _entities[row];
+    }
+
+    [[nodiscard]] auto entities(std::size_t first, std::size_t count)
+      const noexcept -> std::span<const Entity> {
+        assert(first + count <= size());
+        return {_entities.data() + first, count};
+    }
+
+    [[nodiscard]] auto column_index(identifier_t cid) const noexcept
+      -> std::optional<std::size_t> {
+        const auto pos{
+          std::lower_bound(_signature.begin(), _signature.end(), cid)};
+        if((pos != _signature.end()) and (*pos == cid)) {
+            return {
+              static_cast<std::size_t>(std::distance(_signature.begin(), pos))};
+        }
+        return {};
+    }
+
+    [[nodiscard]] auto has_column(identifier_t cid) const noexcept -> bool {
+        return std::binary_search(_signature.begin(), _signature.end(), cid);
+    }
+
+    [[nodiscard]] auto has_columns(std::span<const identifier_t> cids)
+      const noexcept -> bool {
+        return std::all_of(cids.begin(), cids.end(), [this](auto cid) {
+            return has_column(cid);
+        });
+    }
+
+    [[nodiscard]] auto column(std::size_t index) noexcept
+      -> archetype_column_intf<Entity>& {
+        assert(index < _columns.size());
+        return *_columns[index];
+    }
+
+    [[nodiscard]] auto column(std::size_t index) const noexcept
+      -> const archetype_column_intf<Entity>& {
+        assert(index < _columns.size());
+        return *_columns[index];
+    }
+
+    template <typename Component>
+    [[nodiscard]] auto column() noexcept -> archetype_column<Entity, Component>& {
+        using C = archetype_column<Entity, Component>;
+        const auto index{column_index(Component::uid())};
+        assert(index);
+        auto& col{column(*index)};
+        assert(dynamic_cast<C*>(&col));
+        return static_cast<C&>(col);
+    }
+
+    void push_entity(entity_param_t<Entity> e) {
+        _entities.push_back(e);
+    }
+
+    /// @brief Removes the row, moving the last row in its place.
+    /// @returns the entity that was moved into the specified row, if any.
+    auto erase_row(std::size_t row) -> std::optional<Entity> {
+        assert(row < size());
+        for(auto& col : _columns) {
+            col->erase_row(row);
+        }
+        const auto last{size() - 1U};
+        std::optional<Entity> moved;
+        if(row != last) {
+            _entities[row] = std::move(_entities[last]);
+            moved = _entities[row];
+        }
+        _entities.pop_back();
+        return moved;
+    }
+
+private:
+    std::vector<identifier_t> _signature;
+    std::vector<column_ptr> _columns;
+    std::vector<Entity> _entities;
+};
+//------------------------------------------------------------------------------
+// Archetype registry
+//------------------------------------------------------------------------------
+/// @brief Shared store grouping entities into tables by their component set.
+/// @ingroup ecs
+/// @see archetype_cmp_storage
+/// @see basic_manager::register_archetype_storages
+///
+/// Each table holds the entities having exactly the same set of components
+/// and keeps each component type in a separate contiguous column.
+/// Adding or removing a component moves the entity's row to another table.
+/// @note Adding and removing components that moves an entity to another
+/// table while a for_each pass is running is deferred until the pass ends,
+/// so that the tables are not reallocated under the iteration. Until then
+/// the deferred changes are not visible to has, find and further passes.
+export template <typename Entity>
+class archetype_registry {
+public:
+    using entity_param = entity_param_t<Entity>;
+
+    /// @brief Registers the column type for the specified Component.
+    template <typename Component>
+    void register_column() {
+        _prototypes.emplace(
+          Component::uid(),
+          column_ptr{hold<archetype_column<Entity, Component>>});
+    }
+
+    /// @brief Sets the observer of changes of the specified component.
+    void set_observer(
+      identifier_t cid,
+      storage_observer<Entity>* observer,
+      std::size_t key) {
+        _observers[cid].reset(observer, key);
+    }
+
+    /// @brief Removes all instances of the specified component and its tables.
+    void unregister_column(identifier_t cid) {
+        for(const auto& e : _entities_with(cid)) {
+            remove(cid, e);
+        }
+        std::erase_if(
+          _tables, [cid](auto& t) { return t.has_column(cid); });
+        _prototypes.erase(cid);
+        _observers.erase(cid);
+        _reindex();
+    }
+
+    [[nodiscard]] auto has(identifier_t cid, entity_param e) noexcept
+      -> bool {
+        return _with_column(
+          e, cid, [](auto& tbl, auto row, auto col) {
+              return not tbl.column(col).is_hidden(row);
+          });
+    }
+
+    [[nodiscard]] auto is_hidden(identifier_t cid, entity_param e) noexcept
+      -> bool {
+        return _with_column(e, cid, [](auto& tbl, auto row, auto col) {
+            return tbl.column(col).is_hidden(row);
+        });
+    }
+
+    auto hide(identifier_t cid, entity_param e) noexcept -> bool {
+        if(_set_hidden(cid, e, true)) {
+            _observer(cid).hidden(e);
+            return true;
+        }
+        return false;
+    }
+
+    auto show(identifier_t cid, entity_param e) noexcept -> bool {
+        if(_set_hidden(cid, e, false)) {
+            _observer(cid).shown(e);
+            return true;
+        }
+        return false;
+    }
+
+    /// @brief Returns a pointer to the visible component of an entity or null.
+    template <typename Component>
+    [[nodiscard]] auto find(entity_param e) noexcept -> Component* {
+        if(const auto pos{_locations.find(e)}; pos != _locations.end()) {
+            auto& tbl{_tables[pos->second.table]};
+            if(tbl.has_column(Component::uid())) {
+                auto& col{tbl.template column<Component>()};
+                if(not col.is_hidden(pos->second.row)) {
+                    return &col.at(pos->second.row);
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    template <typename Component>
+    auto store(entity_param ent, Component&& component) -> Component* {
+        const identifier_t cid{Component::uid()};
+        const Entity e{ent};
+        const auto pos{_locations.find(e)};
+        if(pos != _locations.end()) {
+            auto& tbl{_tables[pos->second.table]};
+            if(tbl.has_column(cid)) {
+                auto& col{tbl.template column<Component>()};
+                const auto row{pos->second.row};
+                if(col.is_hidden(row)) {
+                    col.at(row) = std::move(component);
+                    col.set_hidden(row, false);
+                }
+                _observer(cid).stored(e);
+                return &col.at(row);
+            }
+        }
+        if(_pass_depth > 0U) {
+            auto& op{_deferred.emplace_back(
+              hold<_deferred_store<Component>>, e, std::move(component))};
+            return &static_cast<_deferred_store<Component>*>(op.get())
+                      ->component;
+        }
+
+        std::vector<identifier_t> signature;
+        if(pos != _locations.end()) {
+            signature = _tables[pos->second.table].signature();
+        }
+        signature.insert(
+          std::upper_bound(signature.begin(), signature.end(), cid), cid);
+
+        const auto dst_idx{_table_for(std::move(signature))};
+        const auto dst_row{_move_entity(e, dst_idx)};
+        auto& dst{_tables[dst_idx]};
+        dst.push_entity(e);
+        _locations[e] = {dst_idx, dst_row};
+        _observer(cid).stored(e);
+        return &dst.template column<Component>().push_back(
+          std::move(component), false);
+    }
+
+    /// @brief Removes the specified component from an entity.
+    /// @returns true if the removed component was visible.
+    auto remove(identifier_t cid, entity_param e) -> bool {
+        const auto pos{_locations.find(e)};
+        if(pos == _locations.end()) {
+            return false;
+        }
+        const auto loc{pos->second};
+        auto& src{_tables[loc.table]};
+        const auto col_idx{src.column_index(cid)};
+        if(not col_idx) {
+            return false;
+        }
+        const bool was_visible{not src.column(*col_idx).is_hidden(loc.row)};
+        if(_pass_depth > 0U) {
+            _deferred.emplace_back(hold<_deferred_remove>, cid, Entity{e});
+            return was_visible;
+        }
+
+        std::vector<identifier_t> signature{src.signature()};
+        std::erase(signature, cid);
+        if(signature.empty()) {
+            _erase_row(loc);
+            _locations.erase(e);
+        } else {
+            const Entity ent{e};
+            const auto dst_idx{_table_for(std::move(signature))};
+            const auto dst_row{_move_entity(ent, dst_idx)};
+            _tables[dst_idx].push_entity(ent);
+            _locations[ent] = {dst_idx, dst_row};
+        }
+        _observer(cid).removed(e);
+        return was_visible;
+    }
+
+    /// @brief Calls a function on each visible instance of Component.
+    template <typename Component, typename Function>
+    void for_each(Function&& func) {
+        using C = std::remove_const_t<Component>;
+        std::vector<Entity> removed;
+        concrete_manipulator<Component> m(true /*can_remove*/);
+        const auto observer{_observer(C::uid())};
+        {
+            const _pass_guard pass{*this};
+            for(auto& tbl : _tables) {
+                if(tbl.has_column(C::uid())) {
+                    auto& col{tbl.template column<C>()};
+                    for(std::size_t row = 0; row < tbl.size(); ++row) {
+                        if(not col.is_hidden(row)) {
+                            m.reset(col.at(row));
+                            func(tbl.entity(row), m);
+                            if(m.remove_requested()) {
+                                removed.push_back(tbl.entity(row));
+                            } else if constexpr(not std::is_const_v<
+                                                  Component>) {
+                                observer.modified(tbl.entity(row));
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        for(const auto& e : removed) {
+            remove(C::uid(), e);
+        }
+        _apply_deferred();
+    }
+
+    /// @brief Calls a function on each hidden instance of Component.
+    template <typename Component, typename Function>
+    void for_each_hidden(Function&& func) {
+        concrete_manipulator<const Component> m(false /*can_remove*/);
+        for(auto& tbl : _tables) {
+            if(tbl.has_column(Component::uid())) {
+                auto& col{tbl.template column<Component>()};
+                for(std::size_t row = 0; row < tbl.size(); ++row) {
+                    if(col.is_hidden(row)) {
+                        m.reset(col.at(row));
+                        func(tbl.entity(row), m);
+                    }
+                }
+            }
+        }
+    }
+
+    /// @brief Calls a function on each entity having all visible Components.
+    /// @note This is a linear walk over the tables containing all Components.
+    template <typename... Components>
+    void for_each_all(
+      const callable_ref<
+        void(entity_param, manipulator<Components>&...)>& func) {
+        _for_each_all<Components...>(
+          func, std::index_sequence_for<Components...>{});
+        _apply_deferred();
+    }
+
+    /// @brief Calls a function on runs of rows having all visible Components.
+    /// @note The function gets spans of entities and of each of Components.
+    template <typename... Components, typename Function>
+    void for_each_batch(Function&& func) {
+        {
+            const _pass_guard pass{*this};
+            _for_each_batch<Components...>(
+              func, std::index_sequence_for<Components...>{});
+        }
+        _apply_deferred();
+    }
+
+    /// @brief Returns the number of tables, visited by the parallel passes.
+    /// @see for_each_batch_in
+    [[nodiscard]] auto table_count() const noexcept -> std::size_t {
+        return _tables.size();
+    }
+
+    /// @brief Calls a function on runs of rows of a table with all Components.
+    /// @see table_count
+    ///
+    /// The tables can be visited concurrently. The tables must not be changed
+    /// until all of them are visited and the observers are not notified.
+    template <typename... Components, typename Function>
+    void for_each_batch_in(std::size_t table, Function&& func) {
+        assert(table < _tables.size());
+        _table_batch<Components...>(
+          _tables[table],
+          func,
+          false /*notify*/,
+          std::index_sequence_for<Components...>{});
+    }
+
+    /// @brief Notifies the observer that the component of e was modified.
+    void modified(identifier_t cid, entity_param e) const noexcept {
+        _observer(cid).modified(e);
+    }
+
+    /// @brief Returns the number of entities having the specified component.
+    /// @note Includes the entities with the component hidden.
+    [[nodiscard]] auto count(identifier_t cid) const noexcept -> std::size_t {
+        std::size_t result{0U};
+        for(auto& tbl : _tables) {
+            if(tbl.column_index(cid)) {
+                result += tbl.size();
+            }
+        }
+        return result;
+    }
+
+    /// @brief Returns a sorted list of entities having visible Component.
+    [[nodiscard]] auto visible_entities(identifier_t cid) const
+      -> std::vector<Entity> {
+        std::vector<Entity> result;
+        for(auto& tbl : _tables) {
+            if(const auto col_idx{tbl.column_index(cid)}) {
+                const auto& col{tbl.column(*col_idx)};
+                for(std::size_t row = 0; row < tbl.size(); ++row) {
+                    if(not col.is_hidden(row)) {
+                        result.push_back(tbl.entity(row));
+                    }
+                }
+            }
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+private:
+    using column_ptr = unique_holder<archetype_column_intf<Entity>>;
+
+    struct _location {
+        std::size_t table{0U};
+        std::size_t row{0U};
+    };
+
+    std::vector<archetype_table<Entity>> _tables;
+    std::map<std::vector<identifier_t>, std::size_t> _table_index;
+    std::map<Entity, _location> _locations;
+    std::map<identifier_t, column_ptr> _prototypes;
+    std::map<identifier_t, storage_observer_ref<Entity>> _observers;
+
+    struct _deferred_op : interface<_deferred_op> {
+        virtual void apply(archetype_registry&) = 0;
+    };
+
+    template <typename Component>
+    struct _deferred_store final : _deferred_op {
+        _deferred_store(entity_param e, Component&& c)
+          : entity{e}
+          , component{std::move(c)} {}
+
+        void apply(archetype_registry& registry) final {
+            registry.store(entity, std::move(component));
+        }
+
+        Entity entity;
+        Component component;
+    };
+
+    struct _deferred_remove final : _deferred_op {
+        _deferred_remove(identifier_t c, Entity e) noexcept
+          : cid{c}
+          , entity{std::move(e)} {}
+
+        void apply(archetype_registry& registry) final {
+            registry.remove(cid, entity);
+        }
+
+        identifier_t cid;
+        Entity entity;
+    };
+
+    // changes moving entities between tables, made during a pass
+    std::vector<unique_holder<_deferred_op>> _deferred;
+    std::size_t _pass_depth{0U};
+
+    struct _pass_guard {
+        _pass_guard(archetype_registry& registry) noexcept
+          : _registry{registry} {
+            ++_registry._pass_depth;
+        }
+
+        _pass_guard(_pass_guard&&) = delete;
+        _pass_guard(const _pass_guard&) = delete;
+        auto operator=(_pass_guard&&) = delete;
+        auto operator=(const _pass_guard&) = delete;
+
+        ~_pass_guard() noexcept {
+            --_registry._pass_depth;
+        }
+
+        archetype_registry& _registry;
+    };
+
+    void _apply_deferred() {
+        if(_pass_depth == 0U) {
+            while(not _deferred.empty()) {
+                auto deferred{std::move(_deferred)};
+                _deferred.clear();
+                for(auto& op : deferred) {
+                    op->apply(*this);
+                }
+            }
+        }
+    }
+
+    auto _observer(identifier_t cid) const noexcept
+      -> storage_observer_ref<Entity> {
+        if(const auto pos{_observers.find(cid)}; pos != _observers.end()) {
+            return pos->second;
+        }
+        return {};
+    }
+
+    template <typename Func>
+    auto _with_column(entity_param e, identifier_t cid, const Func& func) noexcept
+      -> bool {
+        if(const auto pos{_locations.find(e)}; pos != _locations.end()) {
+            auto& tbl{_tables[pos->second.table]};
+            if(const auto col_idx{tbl.column_index(cid)}) {
+                return func(tbl, pos->second.row, *col_idx);
+            }
+        }
+        return false;
+    }
+
+    auto _set_hidden(identifier_t cid, entity_param e, bool hidden) noexcept
+      -> bool {
+        return _with_column(e, cid, [hidden](auto& tbl, auto row, auto col) {
+            auto& column{tbl.column(col)};
+            if(column.is_hidden(row) != hidden) {
+                column.set_hidden(row, hidden);
+                return true;
+            }
+            return false;
+        });
+    }
+
+    auto _table_for(std::vector<identifier_t> signature) -> std::size_t {
+        if(const auto pos{_table_index.find(signature)};
+           pos != _table_index.end()) {
+            return pos->second;
+        }
+        std::vector<column_ptr> columns;
+        columns.reserve(signature.size());
+        for(const auto cid : signature) {
+            const auto proto{_prototypes.find(cid)};
+            assert(proto != _prototypes.end());
+            columns.push_back(proto->second->make_empty());
+        }
+        const auto idx{_tables.size()};
+        _table_index.emplace(signature, idx);
+        _tables.emplace_back(std::move(signature), std::move(columns));
+        return idx;
+    }
+
+    // moves the columns shared by the source and destination table of an
+    // entity (if any), the caller pushes the entity and the added column
+    auto _move_entity(entity_param e, std::size_t dst_idx) -> std::size_t {
+        auto& dst{_tables[dst_idx]};
+        const auto dst_row{dst.size()};
+        if(const auto pos{_locations.find(e)}; pos != _locations.end()) {
+            const auto loc{pos->second};
+            auto& src{_tables[loc.table]};
+            for(std::size_t i = 0; i < src.signature().size(); ++i) {
+                if(const auto j{dst.column_index(src.signature()[i])}) {
+                    src.column(i).move_row_to(loc.row, dst.column(*j));
+                }
+            }
+            _erase_row(loc);
+        }
+        return dst_row;
+    }
+
+    void _erase_row(_location loc) {
+        if(const auto moved{_tables[loc.table].erase_row(loc.row)}) {
+            _locations[*moved] = loc;
+        }
+    }
+
+    auto _entities_with(identifier_t cid) const -> std::vector<Entity> {
+        std::vector<Entity> result;
+        for(auto& tbl : _tables) {
+            if(tbl.has_column(cid)) {
+                for(std::size_t row = 0; row < tbl.size(); ++row) {
+                    result.push_back(tbl.entity(row));
+                }
+            }
+        }
+        return result;
+    }
+
+    void _reindex() {
+        _table_index.clear();
+        _locations.clear();
+        for(std::size_t t = 0; t < _tables.size(); ++t) {
+            _table_index.emplace(_tables[t].signature(), t);
+            for(std::size_t row = 0; row < _tables[t].size(); ++row) {
+                _locations[_tables[t].entity(row)] = {t, row};
+            }
+        }
+    }
+
+    template <typename... Components, typename Func, std::size_t... I>
+    void _for_each_batch(Func& func, std::index_sequence<I...> seq) {
+        for(auto& tbl : _tables) {
+            _table_batch<Components...>(tbl, func, true /*notify*/, seq);
+        }
+    }
+
+    template <typename... Components, typename Func, std::size_t... I>
+    void _table_batch(
+      archetype_table<Entity>& tbl,
+      Func& func,
+      bool notify,
+      std::index_sequence<I...>) {
+        const std::array<identifier_t, sizeof...(Components)> cids{
+          std::remove_const_t<Components>::uid()...};
+        if(not tbl.has_columns(cids)) {
+            return;
+        }
+        const std::tuple<archetype_column<
+          Entity,
+          std::remove_const_t<Components>>*...>
+          cols{&tbl.template column<std::remove_const_t<Components>>()...};
+        const auto is_visible{[&](std::size_t row) {
+            return not(... or std::get<I>(cols)->is_hidden(row));
+        }};
+        std::size_t row{0U};
+        while(row < tbl.size()) {
+            if(not is_visible(row)) {
+                ++row;
+                continue;
+            }
+            const auto first{row};
+            while((row < tbl.size()) and is_visible(row)) {
+                ++row;
+            }
+            func(
+              tbl.entities(first, row - first),
+              std::get<I>(cols)->rows(first, row - first)...);
+            if(notify) {
+                (...,
+                 (std::is_const_v<Components>
+                    ? void()
+                    : _observer(cids[I]).modified(
+                        tbl.entities(first, row - first))));
+            }
+        }
+    }
+
+    template <typename... Components, std::size_t... I>
+    void _for_each_all(
+      const callable_ref<void(entity_param, manipulator<Components>&...)>&
+        func,
+      std::index_sequence<I...>) {
+        const std::array<identifier_t, sizeof...(Components)> cids{
+          std::remove_const_t<Components>::uid()...};
+        std::array<std::vector<Entity>, sizeof...(Components)> removed;
+        const std::array<storage_observer_ref<Entity>, sizeof...(Components)>
+          observers{_observer(cids[I])...};
+        const _pass_guard pass{*this};
+        for(auto& tbl : _tables) {
+            if(not tbl.has_columns(cids)) {
+                continue;
+            }
+            const std::tuple<archetype_column<
+              Entity,
+              std::remove_const_t<Components>>*...>
+              cols{&tbl.template column<std::remove_const_t<Components>>()...};
+            for(std::size_t row = 0; row < tbl.size(); ++row) {
+                if((... or std::get<I>(cols)->is_hidden(row))) {
+                    continue;
+                }
+                std::tuple<concrete_manipulator<Components>...> ms{
+                  concrete_manipulator<Components>{
+                    std::get<I>(cols)->at(row), true /*can_remove*/}...};
+                func(tbl.entity(row), std::get<I>(ms)...);
+                (...,
+                 (std::get<I>(ms).remove_requested()
+                    ? removed[I].push_back(tbl.entity(row))
+                  : std::is_const_v<Components>
+                    ? void()
+                    : observers[I].modified(tbl.entity(row))));
+            }
+        }
+        for(std::size_t i = 0; i < cids.size(); ++i) {
+            for(const auto& e : removed[i]) {
+                remove(cids[i], e);
+            }
+        }
+    }
+};
+//------------------------------------------------------------------------------
+// Archetype component storage
+//------------------------------------------------------------------------------
+export template <typename Entity, typename Component>
+class archetype_cmp_storage;
+
+export template <typename Entity, typename Component>
+class archetype_cmp_storage_iterator
+  : public component_storage_iterator_intf<Entity> {
+public:
+    archetype_cmp_storage_iterator(archetype_registry<Entity>& r)
+      : _registry{&r} {
+        reset();
+    }
+
+    void reset() final {
+        _order = _registry->visible_entities(Component::uid());
+        _pos = 0U;
+    }
+
+    auto done() -> bool final {
+        return _pos >= _order.size();
+    }
+
+    void next() final {
+        assert(not done());
+        ++_pos;
+    }
+
+    auto seek(entity_param_t<Entity> e) -> bool final {
+        if(not done() and (current() < e)) {
+            const auto pos{std::lower_bound(
+              _order.begin() + static_cast<std::ptrdiff_t>(_pos),
+              _order.end(),
+              e)};
+            _pos = static_cast<std::size_t>(std::distance(_order.begin(), pos));
+        }
+        return not done();
+    }
+
+    auto find(entity_param_t<Entity> e) -> bool final {
+        return seek(e) and (e == current());
+    }
+
+    auto current() -> Entity final {
+        assert(not done());
+        return _order[_pos];
+    }
+
+private:
+    archetype_registry<Entity>* _registry{nullptr};
+    std::vector<Entity> _order;
+    std::size_t _pos{0U};
+
+    friend class archetype_cmp_storage<Entity, Component>;
+};
+//------------------------------------------------------------------------------
+/// @brief Component storage adapter placing components into archetype tables.
+/// @ingroup ecs
+/// @see archetype_registry
+/// @see basic_manager::register_archetype_storages
+export template <typename Entity, typename Component>
+class archetype_cmp_storage : public component_storage<Entity, Component> {
+public:
+    using entity_param = entity_param_t<Entity>;
+    using iterator_t = component_storage_iterator<Entity>;
+
+    archetype_cmp_storage(shared_holder<archetype_registry<Entity>> registry)
+      : _registry{std::move(registry)} {
+        assert(_registry);
+        _registry->template register_column<Component>();
+    }
+
+    archetype_cmp_storage(archetype_cmp_storage&&) = delete;
+    archetype_cmp_storage(const archetype_cmp_storage&) = delete;
+    auto operator=(archetype_cmp_storage&&) = delete;
+    auto operator=(const archetype_cmp_storage&) = delete;
+
+    ~archetype_cmp_storage() noexcept override {
+        _registry->unregister_column(Component::uid());
+    }
+
+    /// @brief Returns the registry holding the archetype tables.
+    auto registry() const noexcept -> archetype_registry<Entity>& {
+        return *_registry;
+    }
+
+    auto capabilities() -> storage_caps final {
+        return storage_caps{
+          storage_cap_bit::hide | storage_cap_bit::copy |
+          storage_cap_bit::exchange | storage_cap_bit::remove |
+          storage_cap_bit::store | storage_cap_bit::modify};
+    }
+
+    void swap_buffers() final {}
+
+    void set_observer(storage_observer<Entity>* observer, std::size_t key)
+      final {
+        _registry->set_observer(Component::uid(), observer, key);
+    }
+
+    auto size() -> std::size_t final {
+        return _registry->count(Component::uid());
+    }
+
+    auto new_iterator(storage_buffer) -> iterator_t final {
+        const std::unique_lock lock{_iter_mutex};
+        return iterator_t(_iterators.make(*_registry));
+    }
+
+    void delete_iterator(iterator_t&& i) final {
+        const std::unique_lock lock{_iter_mutex};
+        _iterators.eat(i.release());
+    }
+
+    auto has(entity_param e) -> bool final {
+        return _registry->has(Component::uid(), e);
+    }
+
+    auto is_hidden(entity_param e) -> bool final {
+        return _registry->is_hidden(Component::uid(), e);
+    }
+
+    auto is_hidden(iterator_t& i) -> bool final {
+        assert(not i.done());
+        return is_hidden(_iter_cast(i).current());
+    }
+
+    auto hide(entity_param e) -> bool final {
+        return _registry->hide(Component::uid(), e);
+    }
+
+    void hide(iterator_t& i) final {
+        assert(not i.done());
+        auto& iter{_iter_cast(i)};
+        hide(iter.current());
+        iter.next();
+    }
+
+    auto show(entity_param e) -> bool final {
+        return _registry->show(Component::uid(), e);
+    }
+
+    auto copy(entity_param ef, entity_param et) -> void* final {
+        if(const auto found{_registry->template find<Component>(ef)}) {
+            return static_cast<void*>(store(et, Component(*found)));
+        }
+        return nullptr;
+    }
+
+    auto exchange(const entity_param ea, const entity_param eb) -> bool final {
+        const auto fa{_registry->template find<Component>(ea)};
+        const auto fb{_registry->template find<Component>(eb)};
+
+        if(fa and fb) {
+            using std::swap;
+            swap(*fa, *fb);
+        } else if(fa) {
+            Component tmp{std::move(*fa)};
+            remove(ea);
+            store(eb, std::move(tmp));
+        } else if(fb) {
+            Component tmp{std::move(*fb)};
+            remove(eb);
+            store(ea, std::move(tmp));
+        }
+        return true;
+    }
+
+    auto remove(entity_param e) -> bool final {
+        return _registry->remove(Component::uid(), e);
+    }
+
+    void remove(iterator_t& i) final {
+        assert(not i.done());
+        auto& iter{_iter_cast(i)};
+        remove(iter.current());
+        iter.next();
+    }
+
+    auto store(entity_param e, Component&& c) -> Component* final {
+        return _registry->store(e, std::move(c));
+    }
+
+    auto store(iterator_t&, entity_param e, Component&& c)
+      -> Component* final {
+        return store(e, std::move(c));
+    }
+
+    void for_single(
+      const callable_ref<void(entity_param, manipulator<const Component>&)> func,
+      entity_param e) final {
+        _apply_single<const Component>(func, e);
+    }
+
+    void for_single(
+      const callable_ref<void(entity_param, manipulator<const Component>&)> func,
+      iterator_t& i) final {
+        assert(not i.done());
+        _for_single_iter<const Component>(func, _iter_cast(i));
+    }
+
+    void for_single(
+      const callable_ref<void(entity_param, manipulator<Component>&)> func,
+      entity_param e) final {
+        _apply_single<Component>(func, e);
+    }
+
+    void for_single(
+      const callable_ref<void(entity_param, manipulator<Component>&)> func,
+      iterator_t& i) final {
+        assert(not i.done());
+        _for_single_iter<Component>(func, _iter_cast(i));
+    }
+
+    void for_each(
+      const callable_ref<void(entity_param, manipulator<const Component>&)>
+        func) final {
+        _registry->template for_each<const Component>(func);
+    }
+
+    void for_each(
+      const callable_ref<void(entity_param, manipulator<Component>&)> func)
+      final {
+        _registry->template for_each<Component>(func);
+    }
+
+    void for_each(const callable_ref<void(manipulator<Component>&)> func) final {
+        _registry->template for_each<Component>(
+          [&func](entity_param, manipulator<Component>& m) { func(m); });
+    }
+
+    void for_each_batch(
+      const callable_ref<
+        void(std::span<const Entity>, std::span<const Component>)> func) final {
+        _registry->template for_each_batch<const Component>(func);
+    }
+
+    void for_each_batch(
+      const callable_ref<void(std::span<const Entity>, std::span<Component>)>
+        func) final {
+        _registry->template for_each_batch<Component>(func);
+    }
+
+    void for_each_hidden(
+      const callable_ref<void(entity_param, manipulator<const Component>&)> func)
+      final {
+        _registry->template for_each_hidden<Component>(func);
+    }
+
+    /// @brief Calls a function on each component without type erasure.
+    /// @see basic_manager::read_each
+    /// @see basic_manager::write_each
+    template <typename C, typename Function>
+    void for_each_direct(Function&& func) {
+        _registry->template for_each<C>(func);
+    }
+
+private:
+    using _iter_t = archetype_cmp_storage_iterator<Entity, Component>;
+
+    shared_holder<archetype_registry<Entity>> _registry;
+    object_pool<_iter_t, 2> _iterators{};
+    std::mutex _iter_mutex;
+
+    auto _iter_cast(component_storage_iterator<Entity>& i) noexcept -> auto& {
+        assert(dynamic_cast<_iter_t*>(i.ptr()));
+        return *static_cast<_iter_t*>(i.ptr());
+    }
+
+    template <typename C>
+    auto _apply_single(
+      const callable_ref<void(entity_param, manipulator<C>&)>& func,
+      entity_param e) -> bool {
+        if(const auto found{_registry->template find<Component>(e)}) {
+            concrete_manipulator<C> m(*found, true /*can_remove*/);
+            func(e, m);
+            if(m.remove_requested()) {
+                remove(e);
+                return true;
+            }
+            if constexpr(not std::is_const_v<C>) {
+                _registry->modified(Component::uid(), e);
+            }
+        }
+        return false;
+    }
+
+    template <typename C>
+    void _for_single_iter(
+      const callable_ref<void(entity_param, manipulator<C>&)>& func,
+      _iter_t& iter) {
+        if(_apply_single<C>(func, iter.current())) {
+            iter.next();
+        }
+    }
+};
+//------------------------------------------------------------------------------
+} // namespace eagine::ecs
@@ -0,0 +1,201 @@
+/// @file
+///
+/// Copyright Matus Chochlik.
+/// Distributed under the Boost Software License, Version 1.0.
+/// See accompanying file LICENSE_1_0.txt or copy at
+/// https://www.boost.org/LICENSE_1_0.txt
+///
+export module eagine.ecs:change_tracker;
+
+import std;
+import eagine.core.types;
+import :entity_traits;
+import :storage;
+import :hash_storage;
+
+namespace eagine::ecs {
+//------------------------------------------------------------------------------
+/// @brief Type of the ticks recorded with component changes.
+/// @ingroup ecs
+/// @see change_tracker
+export using change_tick_t = std::uint64_t;
+//------------------------------------------------------------------------------
+/// @brief Records the tick at which components of entities were last changed.
+/// @ingroup ecs
+/// @see basic_manager::track_changes
+/// @see basic_manager::for_each_changed_since
+/// @see component_index
+///
+/// Stored, shown and modified components are recorded with the current tick,
+/// as reported by the component storages through storage_observer.
+/// The last tick of each changed entity is kept in a hash map per component
+/// index, so repeated changes of the same entities only update their ticks.
+/// Entities are dropped when their components are removed, the subjects
+/// of relations are kept until the relation type is unregistered.
+/// The maps are created by track, when the storages are registered, and
+/// are updated without locking. Changes of different components can be
+/// recorded concurrently, like those done by systems run by basic_scheduler,
+/// but changes of the same component must not.
+export template <typename Entity>
+class change_tracker final : public storage_observer<Entity> {
+public:
+    using entity_param = entity_param_t<Entity>;
+
+    /// @brief Returns the tick recorded with the changes done now.
+    [[nodiscard]] auto tick() const noexcept -> change_tick_t {
+        return _tick.load(std::memory_order_acquire);
+    }
+
+    /// @brief Increments the current tick and returns the new value.
+    auto advance() noexcept -> change_tick_t {
+        return _tick.fetch_add(1U, std::memory_order_acq_rel) + 1U;
+    }
+
+    void on_stored(std::size_t index, entity_param e) noexcept final {
+        _record(index, e);
+    }
+
+    void on_removed(std::size_t index, entity_param e) noexcept final {
+        if(index < _logs.size()) {
+            if(auto& log{_logs[index]}; log.kind == data_kind::component) {
+                log.ticks.erase(e);
+            }
+        }
+    }
+
+    void on_hidden(std::size_t, entity_param) noexcept final {}
+
+    void on_shown(std::size_t index, entity_param e) noexcept final {
+        _record(index, e);
+    }
+
+    void on_modified(std::size_t index, entity_param e) noexcept final {
+        _record(index, e);
+    }
+
+    /// @brief Starts recording changes of the component or relation with index.
+    /// @note Must not be called concurrently with record.
+    void track(std::size_t index, data_kind kind) {
+        if(_logs.size() <= index) {
+            _logs.resize(index + 1U);
+        }
+        _logs[index].kind = kind;
+    }
+
+    /// @brief Records a change of the component with the index, at current tick.
+    /// @see track
+    /// @see suppress
+    ///
+    /// Changes of components that are not tracked or are suppressed
+    /// are ignored.
+    void record(std::size_t index, entity_param e) {
+        if(index >= _logs.size()) {
+            return;
+        }
+        auto& log{_logs[index]};
+        if(log.suppressed) {
+            return;
+        }
+        const auto t{tick()};
+        if(auto pos{log.ticks.find(e)}; pos != log.ticks.end()) {
+            // the tick may advance concurrently, never move it back
+            pos->second = std::max(pos->second, t);
+        } else {
+            log.ticks.try_emplace(e, t);
+        }
+    }
+
+    /// @brief Returns the sorted entities with the component changed since tick.
+    /// @note Includes the changes done at the specified tick.
+    ///
+    /// Returns nothing if some change could not be recorded, in which case
+    /// all entities should be considered to be changed.
+    [[nodiscard]] auto changed_since(std::size_t index, change_tick_t since)
+      -> std::optional<std::vector<Entity>> {
+        std::vector<Entity> result;
+        if(index < _logs.size()) {
+            const auto& log{_logs[index]};
+            if(log.incomplete) {
+                return {};
+            }
+            for(const auto& [e, t] : log.ticks) {
+                if(t >= since) {
+                    result.push_back(e);
+                }
+            }
+        }
+        std::sort(result.begin(), result.end());
+        return {std::move(result)};
+    }
+
+    /// @brief Forgets the recorded changes of the component with the index.
+    void clear(std::size_t index) noexcept {
+        if(index < _logs.size()) {
+            auto& log{_logs[index]};
+            log.ticks.clear();
+            log.incomplete = false;
+        }
+    }
+
+    /// @brief Forgets all recorded changes.
+    void clear() noexcept {
+        _logs.clear();
+    }
+
+    /// @brief Suppresses the recording of changes of a component while alive.
+    /// @see suppress
+    class suppress_guard {
+    public:
+        suppress_guard(change_tracker& parent, std::size_t index) noexcept
+          : _parent{parent}
+          , _index{index} {
+            _parent._set_suppressed(_index, true);
+        }
+
+        suppress_guard(suppress_guard&&) = delete;
+        suppress_guard(const suppress_guard&) = delete;
+        auto operator=(suppress_guard&&) = delete;
+        auto operator=(const suppress_guard&) = delete;
+
+        ~suppress_guard() noexcept {
+            _parent._set_suppressed(_index, false);
+        }
+
+    private:
+        change_tracker& _parent;
+        std::size_t _index;
+    };
+
+    /// @brief Returns a guard suppressing the changes of the component.
+    [[nodiscard]] auto suppress(std::size_t index) noexcept -> suppress_guard {
+        return {*this, index};
+    }
+
+private:
+    struct _log {
+        hash_map<Entity, change_tick_t> ticks;
+        data_kind kind{data_kind::component};
+        bool suppressed{false};
+        // set if a change could not be recorded
+        bool incomplete{false};
+    };
+
+    std::atomic<change_tick_t> _tick{0U};
+    std::vector<_log> _logs;
+
+    void _set_suppressed(std::size_t index, bool value) noexcept {
+        if(index < _logs.size()) {
+            _logs[index].suppressed = value;
+        }
+    }
+
+    void _record(std::size_t index, entity_param e) noexcept {
+        try {
+            record(index, e);
+        } catch(...) {
+            _logs[index].incomplete = true;
+        }
+    }
+};
+//------------------------------------------------------------------------------
+} // namespace eagine::ecs
@@ -0,0 +1,418 @@
+/// @file
+///
+/// Copyright Matus Chochlik.
+/// Distributed under the Boost Software License, Version 1.0.
+/// See accompanying file LICENSE_1_0.txt or copy at
+/// https://www.boost.org/LICENSE_1_0.txt
+///
+module;
+
+#include <cassert>
+
+export module eagine.ecs:command_buffer;
+
+import std;
+import eagine.core.types;
+import eagine.core.identifier;
+import eagine.core.container;
+import :entity_traits;
+import :component;
+import :storage;
+
+namespace eagine::ecs {
+//------------------------------------------------------------------------------
+/// @brief Placeholder for an entity spawned when a command_buffer is applied.
+/// @ingroup ecs
+/// @see command_buffer::spawn
+export struct deferred_entity {
+    std::size_t index{0U};
+};
+//------------------------------------------------------------------------------
+/// @brief Entity or deferred_entity targeted by a command in command_buffer.
+/// @ingroup ecs
+export template <typename Entity>
+class command_target {
+public:
+    command_target(entity_param_t<Entity> e) noexcept
+      : _entity{e} {}
+
+    command_target(deferred_entity d) noexcept
+      : _spawned{d.index} {}
+
+    /// @brief Indicates if this target is an entity not spawned yet.
+    [[nodiscard]] auto is_deferred() const noexcept -> bool {
+        return _spawned != _not_spawned;
+    }
+
+    /// @brief Returns the targeted entity, given the entities spawned so far.
+    [[nodiscard]] auto resolve(std::span<const Entity> spawned) const
+      -> Entity {
+        if(is_deferred()) {
+            assert(_spawned < spawned.size());
+            return spawned[_spawned];
+        }
+        return _entity;
+    }
+
+private:
+    static constexpr const std::size_t _not_spawned{~std::size_t(0U)};
+
+    Entity _entity{};
+    std::size_t _spawned{_not_spawned};
+};
+//------------------------------------------------------------------------------
+/// @brief Records structural changes of entities, to be applied later.
+/// @ingroup ecs
+/// @see basic_manager::apply
+///
+/// The recorded commands do not access the manager, so they can be recorded
+/// while iterating the components or from worker threads, using a separate
+/// buffer on each thread. basic_manager::apply replays the commands.
+/// Between the recorded forget commands, the commands are replayed grouped
+/// by storage and sorted by entity, so each storage is looked up once and
+/// consecutive insertions are passed to the storage in a single batch.
+/// Commands targeting the same entity in the same storage keep their order.
+export template <typename Entity>
+class command_buffer {
+public:
+    using entity_param = entity_param_t<Entity>;
+    using target = command_target<Entity>;
+
+    /// @brief Records spawning of a new entity.
+    /// @see basic_manager::spawn
+    ///
+    /// The returned placeholder can be used as target of the commands
+    /// recorded later into this buffer. Spawned entities are allocated
+    /// before the other commands recorded since the last forget are applied.
+    auto spawn() -> deferred_entity {
+        _commands.push_back({.op = _op::spawn});
+        return {_spawn_count++};
+    }
+
+    /// @brief Records removal of all information about the entity.
+    /// @see basic_manager::forget
+    auto forget(target ent) -> auto& {
+        _commands.push_back({.op = _op::forget, .subject = ent});
+        return *this;
+    }
+
+    /// @brief Records adding of the specified components to the entity.
+    template <component_data... Components>
+    auto add(target ent, Components&&... components) -> auto& {
+        (..., _store(ent, ent, std::forward<Components>(components)));
+        return *this;
+    }
+
+    /// @brief Records adding of the specified relation of subject to object.
+    template <relation_data Relation>
+    auto add(target subject, target object, Relation&& rel) -> auto& {
+        _store(subject, object, std::forward<Relation>(rel));
+        return *this;
+    }
+
+    /// @brief Records removal of the specified components from the entity.
+    template <component_data... Components>
+    auto remove(target ent) -> auto& {
+        (..., _record<Components>(_op::remove, ent, ent));
+        return *this;
+    }
+
+    /// @brief Records removal of the specified relation of subject to object.
+    template <relation_data Relation>
+    auto remove_relation(target subject, target object) -> auto& {
+        _record<Relation>(_op::remove, subject, object);
+        return *this;
+    }
+
+    /// @brief Records hiding of the specified components of the entity.
+    template <component_data... Components>
+    auto hide(target ent) -> auto& {
+        (..., _record<Components>(_op::hide, ent, ent));
+        return *this;
+    }
+
+    /// @brief Records showing of the specified components of the entity.
+    template <component_data... Components>
+    auto show(target ent) -> auto& {
+        (..., _record<Components>(_op::show, ent, ent));
+        return *this;
+    }
+
+    /// @brief Indicates if there are no recorded commands.
+    [[nodiscard]] auto empty() const noexcept -> bool {
+        return _commands.empty();
+    }
+
+    /// @brief Returns the number of recorded commands.
+    [[nodiscard]] auto size() const noexcept -> std::size_t {
+        return _commands.size();
+    }
+
+    /// @brief Discards the recorded commands, keeps the allocated memory.
+    void clear() noexcept {
+        _commands.clear();
+        _spawn_count = 0U;
+        for(auto& entry : _values) {
+            std::get<1>(entry)->clear();
+        }
+    }
+
+    /// @brief Replays the recorded commands and clears this buffer.
+    /// @see basic_manager::apply
+    ///
+    /// The functions provided by the manager spawn and forget entities,
+    /// and return pointers to the component and relation storages with
+    /// the specified uid or null if such storage is not registered.
+    template <
+      typename SpawnFunc,
+      typename ForgetFunc,
+      typename CmpStorageFunc,
+      typename RelStorageFunc>
+    void replay(
+      const SpawnFunc& spawn_entity,
+      const ForgetFunc& forget_entity,
+      const CmpStorageFunc& cmp_storage,
+      const RelStorageFunc& rel_storage) {
+        std::vector<Entity> spawned;
+        spawned.reserve(_spawn_count);
+        std::vector<_resolved> batch;
+        batch.reserve(_commands.size());
+
+        auto pos{_commands.begin()};
+        while(pos != _commands.end()) {
+            batch.clear();
+            while((pos != _commands.end()) and (pos->op != _op::forget)) {
+                if(pos->op == _op::spawn) {
+                    spawned.push_back(spawn_entity());
+                } else {
+                    batch.push_back(
+                      {.cmd = &*pos,
+                       .subject = pos->subject.resolve(spawned),
+                       .object = pos->object.resolve(spawned)});
+                }
+                ++pos;
+            }
+            _replay_batch(batch, cmp_storage, rel_storage);
+            if(pos != _commands.end()) {
+                forget_entity(pos->subject.resolve(spawned));
+                ++pos;
+            }
+        }
+        clear();
+    }
+
+private:
+    enum class _op : std::uint8_t { spawn, forget, store, remove, hide, show };
+
+    struct _values_base : interface<_values_base> {
+        virtual void store(
+          base_component_storage<Entity>&,
+          std::span<const Entity>,
+          std::span<const std::size_t>) = 0;
+
+        virtual void store(
+          base_relation_storage<Entity>&,
+          entity_param,
+          entity_param,
+          std::size_t) = 0;
+
+        virtual void clear() noexcept = 0;
+    };
+
+    template <typename Data>
+    struct _typed_values final : _values_base {
+        std::vector<Data> values;
+
+        void store(
+          base_component_storage<Entity>& b_storage,
+          std::span<const Entity> entities,
+          std::span<const std::size_t> indices) final {
+            if constexpr(component_data<Data>) {
+                using S = component_storage<Entity, Data>;
+                S* c_storage = dynamic_cast<S*>(&b_storage);
+                assert(c_storage);
+                std::vector<Data> batch;
+                batch.reserve(indices.size());
+                for(const auto index : indices) {
+                    batch.push_back(std::move(values[index]));
+                }
+                c_storage->store_bulk(entities, batch);
+            }
+        }
+
+        void store(
+          base_relation_storage<Entity>& b_storage,
+          entity_param subject,
+          entity_param object,
+          std::size_t index) final {
+            if constexpr(relation_data<Data>) {
+                using S = relation_storage<Entity, Data>;
+                S* r_storage = dynamic_cast<S*>(&b_storage);
+                assert(r_storage);
+                r_storage->store(subject, object, std::move(values[index]));
+            }
+        }
+
+        void clear() noexcept final {
+            values.clear();
+        }
+    };
+
+    struct _command {
+        _op op{_op::spawn};
+        data_kind kind{data_kind::component};
+        identifier_t uid{0U};
+        target subject{Entity{}};
+        target object{Entity{}};
+        _values_base* values{nullptr};
+        std::size_t index{0U};
+    };
+
+    struct _resolved {
+        const _command* cmd{nullptr};
+        Entity subject{};
+        Entity object{};
+    };
+
+    std::vector<_command> _commands;
+    std::size_t _spawn_count{0U};
+    flat_map<
+      std::pair<data_kind, identifier_t>,
+      unique_holder<_values_base>>
+      _values;
+
+    template <typename Data>
+    auto _values_of() -> _typed_values<Data>& {
+        const std::pair<data_kind, identifier_t> key{
+          Data::kind(), Data::uid()};
+        auto pos{_values.find(key)};
+        if(pos == _values.end()) {
+            unique_holder<_values_base> values{hold<_typed_values<Data>>};
+            pos = _values.emplace(key, std::move(values)).first;
+        }
+        assert(dynamic_cast<_typed_values<Data>*>(pos->second.get()));
+        return *static_cast<_typed_values<Data>*>(pos->second.get());
+    }
+
+    template <typename D>
+    void _store(target subject, target object, D&& data) {
+        using Data = std::remove_cvref_t<D>;
+        auto& values{_values_of<Data>()};
+        _commands.push_back(
+          {.op = _op::store,
+           .kind = Data::kind(),
+           .uid = Data::uid(),
+           .subject = subject,
+           .object = object,
+           .values = &values,
+           .index = values.values.size()});
+        values.values.emplace_back(std::forward<D>(data));
+    }
+
+    template <typename Data>
+    void _record(_op op, target subject, target object) {
+        _commands.push_back(
+          {.op = op,
+           .kind = Data::kind(),
+           .uid = Data::uid(),
+           .subject = subject,
+           .object = object});
+    }
+
+    template <typename CmpStorageFunc, typename RelStorageFunc>
+    static void _replay_batch(
+      std::vector<_resolved>& batch,
+      const CmpStorageFunc& cmp_storage,
+      const RelStorageFunc& rel_storage) {
+        std::stable_sort(
+          batch.begin(), batch.end(), [](const auto& l, const auto& r) {
+              return std::tie(l.cmd->kind, l.cmd->uid, l.subject, l.object) <
+                     std::tie(r.cmd->kind, r.cmd->uid, r.subject, r.object);
+          });
+        auto pos{batch.begin()};
+        while(pos != batch.end()) {
+            const auto kind{pos->cmd->kind};
+            const auto uid{pos->cmd->uid};
+            const auto same_storage{[&](const auto& entry) {
+                return (entry.cmd->kind == kind) and (entry.cmd->uid == uid);
+            }};
+            const auto group_end{
+              std::find_if_not(std::next(pos), batch.end(), same_storage)};
+            if(kind == data_kind::component) {
+                if(auto b_storage{cmp_storage(uid)}) {
+                    _replay_components(*b_storage, pos, group_end);
+                }
+            } else {
+                if(auto b_storage{rel_storage(uid)}) {
+                    _replay_relations(*b_storage, pos, group_end);
+                }
+            }
+            pos = group_end;
+        }
+    }
+
+    // consecutive stores are passed to the storage in a single batch
+    template <typename Iter>
+    static void _replay_components(
+      base_component_storage<Entity>& b_storage,
+      Iter pos,
+      const Iter end) {
+        std::vector<Entity> entities;
+        std::vector<std::size_t> indices;
+        while(pos != end) {
+            if(pos->cmd->op == _op::store) {
+                auto values{pos->cmd->values};
+                entities.clear();
+                indices.clear();
+                for(; (pos != end) and (pos->cmd->op == _op::store); ++pos) {
+                    entities.push_back(pos->subject);
+                    indices.push_back(pos->cmd->index);
+                }
+                values->store(b_storage, entities, indices);
+                continue;
+            }
+            switch(pos->cmd->op) {
+                case _op::store:
+                    break;
+                case _op::remove:
+                    b_storage.remove(pos->subject);
+                    break;
+                case _op::hide:
+                    b_storage.hide(pos->subject);
+                    break;
+                case _op::show:
+                    b_storage.show(pos->subject);
+                    break;
+                case _op::spawn:
+                case _op::forget:
+                    break;
+            }
+            ++pos;
+        }
+    }
+
+    template <typename Iter>
+    static void _replay_relations(
+      base_relation_storage<Entity>& b_storage,
+      Iter pos,
+      const Iter end) {
+        for(; pos != end; ++pos) {
+            switch(pos->cmd->op) {
+                case _op::store:
+                    pos->cmd->values->store(
+                      b_storage, pos->subject, pos->object, pos->cmd->index);
+                    break;
+                case _op::remove:
+                    b_storage.remove(pos->subject, pos->object);
+                    break;
+                case _op::hide:
+                case _op::show:
+                case _op::spawn:
+                case _op::forget:
+                    break;
+            }
+        }
+    }
+};
+//------------------------------------------------------------------------------
+} // namespace eagine::ecs
@@ -55,6 +55,27 @@ concept relation_data = requires(const T& x) {
     bool(x.is_relation());
 };
 //------------------------------------------------------------------------------
+// component_index
+auto next_component_index() noexcept -> std::size_t {
+    static std::atomic<std::size_t> counter{0U};
+    return counter.fetch_add(1U);
+}
+
+template <identifier_value Uid>
+auto component_index_of() noexcept -> std::size_t {
+    static const std::size_t index{next_component_index()};
+    return index;
+}
+
+/// @brief Returns a small process-wide unique index of the specified Data.
+/// @ingroup ecs
+///
+/// Indices are assigned in the order in which they are first requested.
+export template <typename Data>
+[[nodiscard]] auto component_index() noexcept -> std::size_t {
+    return component_index_of<Data::uid()>();
+}
+//------------------------------------------------------------------------------
 // component_uid_map
 export template <typename T>
 class component_uid_map {
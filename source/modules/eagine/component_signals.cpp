@@ -0,0 +1,199 @@
+/// @file
+///
+/// Copyright Matus Chochlik.
+/// Distributed under the Boost Software License, Version 1.0.
+/// See accompanying file LICENSE_1_0.txt or copy at
+/// https://www.boost.org/LICENSE_1_0.txt
+///
+export module eagine.ecs:component_signals;
+
+import std;
+import eagine.core.types;
+import eagine.core.utility;
+import :entity_traits;
+import :storage;
+
+namespace eagine::ecs {
+//------------------------------------------------------------------------------
+export template <typename Entity>
+class component_signal_dispatcher;
+//------------------------------------------------------------------------------
+/// @brief Signals emitted when components of a single type are changed.
+/// @ingroup ecs
+/// @see basic_manager::component_signals
+/// @see basic_manager::flush_component_signals
+///
+/// By default the per-entity signals are emitted immediately, from within
+/// the operation changing the component. In batched mode the entities are
+/// only recorded and are delivered in spans by the batch signals when
+/// the manager flushes the component signals. Consecutive notifications
+/// of the same kind are delivered in a single span, and the order of
+/// the notifications is preserved.
+export template <typename Entity>
+class basic_component_signals {
+public:
+    using entity_param = entity_param_t<Entity>;
+
+    /// @brief Emitted when a component is stored for an entity.
+    /// @note Also emitted when an existing component is replaced.
+    signal<void(entity_param) noexcept> added;
+    /// @brief Emitted when the component of an entity is removed.
+    signal<void(entity_param) noexcept> removed;
+    /// @brief Emitted when the component of an entity is hidden.
+    signal<void(entity_param) noexcept> hidden;
+    /// @brief Emitted when the component of an entity is shown.
+    signal<void(entity_param) noexcept> shown;
+
+    /// @brief Emitted on flush with entities whose component was stored.
+    signal<void(std::span<const Entity>) noexcept> added_batch;
+    /// @brief Emitted on flush with entities whose component was removed.
+    signal<void(std::span<const Entity>) noexcept> removed_batch;
+    /// @brief Emitted on flush with entities whose component was hidden.
+    signal<void(std::span<const Entity>) noexcept> hidden_batch;
+    /// @brief Emitted on flush with entities whose component was shown.
+    signal<void(std::span<const Entity>) noexcept> shown_batch;
+
+    /// @brief Switches between the immediate and the batched delivery.
+    /// @note Pending batches are delivered by the next flush in any mode.
+    auto batched(bool value = true) noexcept -> auto& {
+        _batched = value;
+        return *this;
+    }
+
+    /// @brief Indicates if the changes are delivered in batches on flush.
+    [[nodiscard]] auto is_batched() const noexcept -> bool {
+        return _batched;
+    }
+
+    /// @brief Emits the batch signals for the recorded entities.
+    void flush() noexcept {
+        std::vector<Entity> entities;
+        std::vector<std::pair<_kind, std::size_t>> runs;
+        {
+            const std::unique_lock lock{_mutex};
+            entities.swap(_pending);
+            runs.swap(_runs);
+        }
+        std::size_t begin{0U};
+        for(const auto& [kind, end] : runs) {
+            const std::span<const Entity> batch{
+              entities.data() + begin, end - begin};
+            switch(kind) {
+                case _kind::added:
+                    added_batch(batch);
+                    break;
+                case _kind::removed:
+                    removed_batch(batch);
+                    break;
+                case _kind::hidden:
+                    hidden_batch(batch);
+                    break;
+                case _kind::shown:
+                    shown_batch(batch);
+                    break;
+            }
+            begin = end;
+        }
+    }
+
+private:
+    friend class component_signal_dispatcher<Entity>;
+
+    enum class _kind : std::uint8_t { added, removed, hidden, shown };
+
+    std::vector<Entity> _pending;
+    std::vector<std::pair<_kind, std::size_t>> _runs;
+    std::mutex _mutex;
+    bool _batched{false};
+
+    void _record(_kind kind, entity_param e) noexcept {
+        const std::unique_lock lock{_mutex};
+        _pending.push_back(e);
+        if(_runs.empty() or (_runs.back().first != kind)) {
+            _runs.emplace_back(kind, _pending.size());
+        } else {
+            _runs.back().second = _pending.size();
+        }
+    }
+
+    void _notify(
+      _kind kind,
+      const signal<void(entity_param) noexcept>& immediate,
+      entity_param e) noexcept {
+        if(_batched) {
+            _record(kind, e);
+        } else {
+            immediate(e);
+        }
+    }
+};
+//------------------------------------------------------------------------------
+/// @brief Storage observer emitting the per-component signals.
+/// @ingroup ecs
+/// @see basic_component_signals
+/// @see component_index
+export template <typename Entity>
+class component_signal_dispatcher final : public storage_observer<Entity> {
+    using _signals_t = basic_component_signals<Entity>;
+    using _kind = typename _signals_t::_kind;
+
+public:
+    using entity_param = entity_param_t<Entity>;
+
+    /// @brief Returns the signals of the component with the specified index.
+    /// @note Not to be called while the components are being changed.
+    auto signals(std::size_t index) -> _signals_t& {
+        if(_signals.size() <= index) {
+            _signals.resize(index + 1U);
+        }
+        auto& result{_signals[index]};
+        if(not result) {
+            result = {hold<_signals_t>};
+        }
+        return *result;
+    }
+
+    void on_stored(std::size_t index, entity_param e) noexcept final {
+        if(auto sigs{_find(index)}) {
+            sigs->_notify(_kind::added, sigs->added, e);
+        }
+    }
+
+    void on_removed(std::size_t index, entity_param e) noexcept final {
+        if(auto sigs{_find(index)}) {
+            sigs->_notify(_kind::removed, sigs->removed, e);
+        }
+    }
+
+    void on_hidden(std::size_t index, entity_param e) noexcept final {
+        if(auto sigs{_find(index)}) {
+            sigs->_notify(_kind::hidden, sigs->hidden, e);
+        }
+    }
+
+    void on_shown(std::size_t index, entity_param e) noexcept final {
+        if(auto sigs{_find(index)}) {
+            sigs->_notify(_kind::shown, sigs->shown, e);
+        }
+    }
+
+    void on_modified(std::size_t, entity_param) noexcept final {}
+
+    /// @brief Delivers the batched changes of all components.
+    void flush() noexcept {
+        for(auto& sigs : _signals) {
+            if(sigs) {
+                sigs->flush();
+            }
+        }
+    }
+
+private:
+    std::vector<unique_holder<_signals_t>> _signals;
+
+    auto _find(std::size_t index) const noexcept -> _signals_t* {
+        return index < _signals.size() ? _signals[index].get() : nullptr;
+    }
+};
+//------------------------------------------------------------------------------
+} // namespace eagine::ecs
@@ -0,0 +1,420 @@
+/// @file
+///
+/// Copyright Matus Chochlik.
+/// Distributed under the Boost Software License, Version 1.0.
+/// See accompanying file LICENSE_1_0.txt or copy at
+/// https://www.boost.org/LICENSE_1_0.txt
+///
+module;
+
+#include <cassert>
+
+export module eagine.ecs:double_buffer_storage;
+
+import std;
+import eagine.core.types;
+import eagine.core.utility;
+import eagine.core.container;
+import :entity_traits;
+import :manipulator;
+import :storage;
+import :map_storage;
+
+namespace eagine::ecs {
+//------------------------------------------------------------------------------
+export template <typename Entity, typename Component, class Map>
+class basic_double_buffer_cmp_storage;
+
+export template <typename Entity, typename Component, class Map>
+class basic_double_buffer_cmp_storage_iterator
+  : public component_storage_iterator_intf<Entity> {
+public:
+    basic_double_buffer_cmp_storage_iterator(Map& m) noexcept
+      : _map{&m}
+      , _i{m.begin()} {
+        assert(_map);
+    }
+
+    void reset() final {
+        assert(_map);
+        _i = _map->begin();
+    }
+
+    auto done() -> bool final {
+        assert(_map);
+        return _i == _map->end();
+    }
+
+    void next() final {
+        assert(not done());
+        ++_i;
+    }
+
+    auto seek(entity_param_t<Entity> e) -> bool final {
+        assert(_map);
+        map_seek(*_map, _i, e);
+        return not done();
+    }
+
+    auto find(entity_param_t<Entity> e) -> bool final {
+        return seek(e) and (_i->first == e);
+    }
+
+    auto current() -> Entity final {
+        return _i->first;
+    }
+
+private:
+    using _iter_t = typename Map::iterator;
+    Map* _map{nullptr};
+    _iter_t _i;
+
+    friend class basic_double_buffer_cmp_storage<Entity, Component, Map>;
+};
+//------------------------------------------------------------------------------
+/// @brief Component storage keeping the current and the next frame of data.
+/// @ingroup ecs
+/// @see basic_manager::swap_buffers
+///
+/// Readers, using manipulators of const Component, see the current buffer.
+/// Writers modify the next buffer, which becomes current on swap_buffers.
+/// After the swap the next buffer starts as a copy of the current one.
+/// Adding, removing, hiding and showing components affects both buffers
+/// immediately, so the buffers always contain the same set of entities.
+/// Removals requested through manipulators are applied on swap_buffers,
+/// so readers and writers can run concurrently during a frame.
+export template <typename Entity, typename Component, class Map>
+class basic_double_buffer_cmp_storage
+  : public component_storage<Entity, Component> {
+
+public:
+    using entity_param = entity_param_t<Entity>;
+    using iterator_t = component_storage_iterator<Entity>;
+
+    auto capabilities() -> storage_caps final {
+        return storage_caps{
+          storage_cap_bit::double_buffer | storage_cap_bit::hide |
+          storage_cap_bit::copy | storage_cap_bit::exchange |
+          storage_cap_bit::remove | storage_cap_bit::store |
+          storage_cap_bit::modify};
+    }
+
+    void swap_buffers() final {
+        for(const auto& e : _removed) {
+            remove(e);
+        }
+        _removed.clear();
+        _current = 1U - _current;
+        _write_buffer() = _read_buffer();
+    }
+
+    void set_observer(storage_observer<Entity>* observer, std::size_t key)
+      final {
+        _observer.reset(observer, key);
+    }
+
+    auto size() -> std::size_t final {
+        return _read_buffer().size();
+    }
+
+    auto new_iterator(storage_buffer buffer) -> iterator_t final {
+        const std::unique_lock lock{_iter_mutex};
+        return iterator_t(_iterators.make(_buffer(buffer)));
+    }
+
+    void delete_iterator(iterator_t&& i) final {
+        const std::unique_lock lock{_iter_mutex};
+        _iterators.eat(i.release());
+    }
+
+    auto has(entity_param e) -> bool final {
+        return _read_buffer().contains(e);
+    }
+
+    auto is_hidden(entity_param e) -> bool final {
+        return _hidden.contains(e);
+    }
+
+    auto is_hidden(iterator_t& i) -> bool final {
+        assert(not i.done());
+        return is_hidden(_iter_entity(i));
+    }
+
+    auto hide(entity_param e) -> bool final {
+        if(auto found{find(_write_buffer(), e)}) {
+            _hidden.emplace(e, std::move(*found));
+            _write_buffer().erase(found.position());
+            _read_buffer().erase(e);
+            _observer.hidden(e);
+            return true;
+        }
+        return false;
+    }
+
+    void hide(iterator_t& i) final {
+        assert(not i.done());
+        const Entity e{_iter_entity(i)};
+        if(auto found{find(_write_buffer(), e)}) {
+            _hidden.emplace(e, std::move(*found));
+        }
+        _erase(i);
+        _other_buffer(i).erase(e);
+        _observer.hidden(e);
+    }
+
+    auto show(entity_param e) -> bool final {
+        if(auto found{find(_hidden, e)}) {
+            _read_buffer().emplace(e, *found);
+            _write_buffer().emplace(e, std::move(*found));
+            _hidden.erase(found.position());
+            _observer.shown(e);
+            return true;
+        }
+        return false;
+    }
+
+    auto copy(entity_param ef, entity_param et) -> void* final {
+        if(const auto found{find(_write_buffer(), ef)}) {
+            return static_cast<void*>(store(et, Component(*found)));
+        }
+        return nullptr;
+    }
+
+    auto exchange(const entity_param ea, const entity_param eb) -> bool final {
+        auto& wb{_write_buffer()};
+        auto& rb{_read_buffer()};
+        const auto fa{find(wb, ea)};
+        const auto fb{find(wb, eb)};
+
+        if(fa and fb) {
+            using std::swap;
+            swap(*fa, *fb);
+            swap(*find(rb, ea), *find(rb, eb));
+        } else if(fa) {
+            Component tmp{std::move(*fa)};
+            remove(ea);
+            store(eb, std::move(tmp));
+        } else if(fb) {
+            Component tmp{std::move(*fb)};
+            remove(eb);
+            store(ea, std::move(tmp));
+        }
+        return true;
+    }
+
+    auto remove(entity_param e) -> bool final {
+        const bool was_hidden{_hidden.erase(e) > 0};
+        _read_buffer().erase(e);
+        const bool was_shown{_write_buffer().erase(e) > 0};
+        if(was_hidden or was_shown) {
+            _observer.removed(e);
+        }
+        return was_shown;
+    }
+
+    void remove(iterator_t& i) final {
+        assert(not i.done());
+        const Entity e{_iter_entity(i)};
+        _erase(i);
+        _hidden.erase(e);
+        _other_buffer(i).erase(e);
+        _observer.removed(e);
+    }
+
+    auto store(entity_param e, Component&& c) -> Component* final {
+        _hidden.erase(e);
+        _read_buffer().emplace(e, c);
+        const auto pos{_write_buffer().emplace(e, std::move(c)).first};
+        _observer.stored(e);
+        return &pos->second;
+    }
+
+    auto store(iterator_t& i, entity_param e, Component&& c)
+      -> Component* final {
+        _hidden.erase(e);
+        auto& iter{_iter_cast(i)};
+        _other_buffer(i).emplace(e, c);
+        iter._i = iter._map->emplace_hint(iter._i, e, std::move(c));
+        _observer.stored(e);
+        return &*find(_write_buffer(), e);
+    }
+
+    void for_single(
+      const callable_ref<void(entity_param, manipulator<const Component>&)> func,
+      entity_param e) final {
+        _apply_single<const Component>(func, e);
+    }
+
+    void for_single(
+      const callable_ref<void(entity_param, manipulator<const Component>&)> func,
+      iterator_t& i) final {
+        assert(not i.done());
+        _apply_single_iter<const Component>(func, i);
+    }
+
+    void for_single(
+      const callable_ref<void(entity_param, manipulator<Component>&)> func,
+      entity_param e) final {
+        _apply_single<Component>(func, e);
+    }
+
+    void for_single(
+      const callable_ref<void(entity_param, manipulator<Component>&)> func,
+      iterator_t& i) final {
+        assert(not i.done());
+        _apply_single_iter<Component>(func, i);
+    }
+
+    void for_each(
+      const callable_ref<void(entity_param, manipulator<const Component>&)>
+        func) final {
+        for_each_direct<const Component>(func);
+    }
+
+    void for_each(
+      const callable_ref<void(entity_param, manipulator<Component>&)> func)
+      final {
+        for_each_direct<Component>(func);
+    }
+
+    void for_each(const callable_ref<void(manipulator<Component>&)> func) final {
+        for_each_direct<Component>(
+          [&func](entity_param, manipulator<Component>& m) { func(m); });
+    }
+
+    void for_each_batch(
+      const callable_ref<
+        void(std::span<const Entity>, std::span<const Component>)> func) final {
+        map_cmp_for_each_batch<Entity, const Component>(_read_buffer(), func);
+    }
+
+    void for_each_batch(
+      const callable_ref<void(std::span<const Entity>, std::span<Component>)>
+        func) final {
+        map_cmp_for_each_batch<Entity, Component>(_write_buffer(), func);
+        if(_observer) {
+            for(const auto& entry : _write_buffer()) {
+                _observer.modified(entry.first);
+            }
+        }
+    }
+
+    void for_each_hidden(
+      const callable_ref<void(entity_param, manipulator<const Component>&)> func)
+      final {
+        concrete_manipulator<const Component> m(false /*can_remove*/);
+        for(auto& entry : _hidden) {
+            m.reset(entry.second);
+            func(entry.first, m);
+        }
+    }
+
+    /// @brief Calls a function on each component without type erasure.
+    /// @see basic_manager::read_each
+    /// @see basic_manager::write_each
+    template <typename C, typename Function>
+    void for_each_direct(Function&& func) {
+        auto& buffer{_buffer_for<C>()};
+        concrete_manipulator<C> m(true /*can_remove*/);
+        auto p = buffer.begin();
+        while(p != buffer.end()) {
+            m.reset(p->second);
+            func(p->first, m);
+            if(m.remove_requested()) {
+                _defer_remove(p->first);
+            } else if constexpr(not std::is_const_v<C>) {
+                _observer.modified(p->first);
+            }
+            ++p;
+        }
+    }
+
+private:
+    using _iter_t =
+      basic_double_buffer_cmp_storage_iterator<Entity, Component, Map>;
+
+    std::array<Map, 2> _buffers{};
+    std::size_t _current{0U};
+    Map _hidden{};
+    object_pool<_iter_t, 2> _iterators{};
+    std::mutex _iter_mutex;
+    std::vector<Entity> _removed;
+    std::mutex _removed_mutex;
+    storage_observer_ref<Entity> _observer;
+
+    void _defer_remove(entity_param e) {
+        const std::unique_lock lock{_removed_mutex};
+        _removed.push_back(e);
+    }
+
+    auto _read_buffer() noexcept -> Map& {
+        return _buffers[_current];
+    }
+
+    auto _write_buffer() noexcept -> Map& {
+        return _buffers[1U - _current];
+    }
+
+    auto _buffer(storage_buffer buffer) noexcept -> Map& {
+        return buffer == storage_buffer::read ? _read_buffer()
+                                              : _write_buffer();
+    }
+
+    template <typename C>
+    auto _buffer_for() noexcept -> Map& {
+        return _buffer(storage_buffer_from_constness(std::is_const_v<C>));
+    }
+
+    auto _iter_cast(component_storage_iterator<Entity>& i) noexcept -> auto& {
+        assert(dynamic_cast<_iter_t*>(i.ptr()));
+        return *static_cast<_iter_t*>(i.ptr());
+    }
+
+    auto _iter_entity(component_storage_iterator<Entity>& i) noexcept {
+        return _iter_cast(i)._i->first;
+    }
+
+    auto _other_buffer(component_storage_iterator<Entity>& i) noexcept
+      -> Map& {
+        return _iter_cast(i)._map == &_read_buffer() ? _write_buffer()
+                                                     : _read_buffer();
+    }
+
+    void _erase(component_storage_iterator<Entity>& i) {
+        auto& iter{_iter_cast(i)};
+        iter._i = iter._map->erase(iter._i);
+    }
+
+    template <typename C, typename Func>
+    void _apply_single(const Func& func, entity_param e) {
+        if(auto found{eagine::find(_buffer_for<C>(), e)}) {
+            concrete_manipulator<C> m(*found, true /*can_remove*/);
+            func(e, m);
+            if(m.remove_requested()) {
+                _defer_remove(e);
+            } else if constexpr(not std::is_const_v<C>) {
+                _observer.modified(e);
+            }
+        }
+    }
+
+    template <typename C, typename Func>
+    void _apply_single_iter(const Func& func, iterator_t& i) {
+        auto& p = _iter_cast(i)._i;
+        concrete_manipulator<C> m(p->second, true /*can_remove*/);
+        func(p->first, m);
+        if(m.remove_requested()) {
+            _defer_remove(p->first);
+        } else if constexpr(not std::is_const_v<C>) {
+            _observer.modified(p->first);
+        }
+    }
+};
+//------------------------------------------------------------------------------
+export template <typename Entity, typename Component>
+using double_buffer_cmp_storage = basic_double_buffer_cmp_storage<
+  Entity,
+  Component,
+  flat_map<Entity, Component>>;
+//------------------------------------------------------------------------------
+} // namespace eagine::ecs
@@ -12,5 +12,19 @@ export import :component;
 export import :manipulator;
 export import :storage;
 export import :map_storage;
+export import :double_buffer_storage;
+export import :flag_storage;
+export import :hash_storage;
+export import :archetype_storage;
+export import :mapped_storage;
+export import :signature;
+export import :view;
+export import :change_tracker;
+export import :component_signals;
+export import :command_buffer;
+export import :snapshot;
+export import :worker_pool;
 export import :manager;
+export import :static_manager;
+export import :scheduler;
 export import :object;
@@ -5,11 +5,17 @@
 /// See accompanying file LICENSE_1_0.txt or copy at
 /// https://www.boost.org/LICENSE_1_0.txt
 ///
+module;
+
+#include <cassert>
+
 export module eagine.ecs:entity_traits;
 
 import std;
+import eagine.core.types;
 import eagine.core.identifier;
 import eagine.core.reflection;
+import :snapshot;
 
 namespace eagine::ecs {
 //------------------------------------------------------------------------------
@@ -24,9 +30,37 @@ constexpr auto enumerator_mapping(
 }
 //------------------------------------------------------------------------------
 export template <typename Entity>
+class sequential_entity_allocator;
+
+export template <
+  std::unsigned_integral Entity,
+  std::size_t IndexBits = sizeof(Entity) * 4U>
+class generational_entity_allocator;
+
+export template <std::size_t IndexBits>
+class entity_handle_allocator;
+
+template <typename Entity>
+struct default_entity_allocator {
+    using type = sequential_entity_allocator<Entity>;
+};
+
+template <std::unsigned_integral Entity>
+struct default_entity_allocator<Entity> {
+    using type = generational_entity_allocator<Entity>;
+};
+//------------------------------------------------------------------------------
+/// @brief Traits of the types used as entities in basic_manager.
+/// @ingroup ecs
+///
+/// The allocator_type is used by basic_manager::spawn and forget to create
+/// and recycle entities. It can be changed by specializing this template.
+export template <typename Entity>
 struct entity_traits {
     using parameter_type = const Entity;
 
+    using allocator_type = typename default_entity_allocator<Entity>::type;
+
     [[nodiscard]] static constexpr auto first() noexcept -> Entity {
         return Entity();
     }
@@ -44,6 +78,8 @@ export template <>
 struct entity_traits<std::string> {
     using parameter_type = const std::string&;
 
+    using allocator_type = sequential_entity_allocator<std::string>;
+
     [[nodiscard]] static constexpr auto first() noexcept -> std::string {
         return {};
     }
@@ -53,6 +89,9 @@ export template <std::size_t M, std::size_t B, typename C, typename T, bool V>
 struct entity_traits<basic_identifier<M, B, C, T, V>> {
     using parameter_type = const basic_identifier<M, B, C, T, V>;
 
+    using allocator_type =
+      sequential_entity_allocator<basic_identifier<M, B, C, T, V>>;
+
     [[nodiscard]] static constexpr auto first() noexcept
       -> basic_identifier<M, B, C, T, V> {
         return {};
@@ -72,6 +111,8 @@ struct entity_traits<basic_identifier_value<M, B, C, T, V>> {
 
     using parameter_type = const value_type;
 
+    using allocator_type = sequential_entity_allocator<value_type>;
+
     [[nodiscard]] static constexpr auto first() noexcept -> value_type {
         return {identifier_type{}.value()};
     }
@@ -82,5 +123,346 @@ struct entity_traits<basic_identifier_value<M, B, C, T, V>> {
     }
 };
 //------------------------------------------------------------------------------
+/// @brief Compact entity type packing a slot index and a generation.
+/// @ingroup ecs
+/// @see entity_handle_allocator
+/// @see direct_index_cmp_storage
+///
+/// The lower IndexBits of the 32-bit value are the index, the upper bits
+/// are the generation. The index can be used by storages for addressing
+/// arrays directly, the generation distinguishes the entities reusing
+/// the index. The default-constructed handle is the null entity.
+export template <std::size_t IndexBits = 24U>
+class entity_handle {
+    static_assert((IndexBits > 0U) and (IndexBits < 32U));
+
+public:
+    using value_type = std::uint32_t;
+
+    /// @brief The number of bits used for the index.
+    static constexpr const std::size_t index_bits{IndexBits};
+
+    /// @brief The number of bits used for the generation.
+    static constexpr const std::size_t generation_bits{32U - IndexBits};
+
+    constexpr entity_handle() noexcept = default;
+
+    /// @brief Construction from the index and generation parts.
+    constexpr entity_handle(value_type index, value_type generation) noexcept
+      : _value{(generation << index_bits) | (index & _index_mask)} {
+        assert(index <= _index_mask);
+    }
+
+    /// @brief Returns the handle with the specified packed value.
+    [[nodiscard]] static constexpr auto from_value(value_type value) noexcept
+      -> entity_handle {
+        entity_handle result;
+        result._value = value;
+        return result;
+    }
+
+    /// @brief Returns the packed index and generation.
+    [[nodiscard]] constexpr auto value() const noexcept -> value_type {
+        return _value;
+    }
+
+    /// @brief Returns the index part of this handle.
+    [[nodiscard]] constexpr auto index() const noexcept -> value_type {
+        return _value & _index_mask;
+    }
+
+    /// @brief Returns the generation part of this handle.
+    [[nodiscard]] constexpr auto generation() const noexcept -> value_type {
+        return _value >> index_bits;
+    }
+
+    /// @brief Indicates if this is not the null entity.
+    [[nodiscard]] constexpr explicit operator bool() const noexcept {
+        return _value != 0U;
+    }
+
+    [[nodiscard]] constexpr auto operator<=>(const entity_handle&)
+      const noexcept = default;
+
+private:
+    static constexpr const value_type _index_mask{
+      ~value_type(0U) >> generation_bits};
+
+    value_type _value{0U};
+};
+//------------------------------------------------------------------------------
+export template <std::size_t IndexBits>
+struct entity_traits<entity_handle<IndexBits>> {
+    using parameter_type = const entity_handle<IndexBits>;
+
+    using allocator_type = entity_handle_allocator<IndexBits>;
+
+    [[nodiscard]] static constexpr auto first() noexcept
+      -> entity_handle<IndexBits> {
+        return {};
+    }
+
+    [[nodiscard]] static constexpr auto next(parameter_type e) noexcept
+      -> entity_handle<IndexBits> {
+        return {e.index() + 1U, e.generation()};
+    }
+
+    /// @brief Returns the index used by storages for direct addressing.
+    [[nodiscard]] static constexpr auto index_of(parameter_type e) noexcept
+      -> std::size_t {
+        return e.index();
+    }
+};
+//------------------------------------------------------------------------------
+/// @brief Indicates if the Entity type has an index for direct addressing.
+/// @ingroup ecs
+/// @see direct_index_cmp_storage
+export template <typename Entity>
+concept indexed_entity = requires(entity_param_t<Entity> e) {
+    { entity_traits<Entity>::index_of(e) } -> std::convertible_to<std::size_t>;
+};
+//------------------------------------------------------------------------------
+/// @brief Entity allocator generating new entities from a sequence.
+/// @ingroup ecs
+/// @see generational_entity_allocator
+///
+/// Entities already known to the manager are skipped, released entities
+/// are not reused.
+export template <typename Entity>
+class sequential_entity_allocator {
+public:
+    /// @brief Returns the next entity from the sequence not in use.
+    template <typename Predicate>
+    auto allocate(const Predicate& is_used) -> Entity {
+        do {
+            _sequence = entity_traits<Entity>::next(_sequence);
+        } while(is_used(_sequence));
+        return _sequence;
+    }
+
+    /// @brief Does nothing, released entities are not tracked.
+    auto release(entity_param_t<Entity>) noexcept -> bool {
+        return false;
+    }
+
+    /// @brief Returns indeterminate, released entities are not tracked.
+    [[nodiscard]] auto is_alive(entity_param_t<Entity>) const noexcept
+      -> tribool {
+        return indeterminate;
+    }
+
+    /// @brief Saves the position in the sequence into a snapshot.
+    void save_snapshot(snapshot_writer& writer) const {
+        writer.write_values(std::span<const Entity>{&_sequence, 1U});
+    }
+
+    /// @brief Loads the position in the sequence from a snapshot.
+    auto load_snapshot(snapshot_reader& reader) -> bool {
+        return reader.read_values(std::span<Entity>{&_sequence, 1U});
+    }
+
+private:
+    Entity _sequence{entity_traits<Entity>::first()};
+};
+//------------------------------------------------------------------------------
+/// @brief Entity allocator recycling released entities, with generations.
+/// @ingroup ecs
+/// @see sequential_entity_allocator
+///
+/// The lower IndexBits of an entity, by default the lower half of its bits,
+/// are an index into a table of slots, the upper bits are the generation
+/// of the slot. Released indices are kept in a free list and reused with
+/// the next generation, so entities stored after they were released are
+/// recognized as stale. Release and reuse take constant time, only new
+/// indices are checked with the is_used predicate. The zero index is never
+/// used so zero remains a null entity. Slots whose generation would overflow
+/// are retired.
+export template <std::unsigned_integral Entity, std::size_t IndexBits>
+class generational_entity_allocator {
+    static_assert((IndexBits > 0U) and (IndexBits < sizeof(Entity) * 8U));
+
+public:
+    /// @brief The number of bits used for the index.
+    static constexpr const std::size_t index_bits{IndexBits};
+
+    /// @brief Returns the index part of the specified entity.
+    [[nodiscard]] static constexpr auto index_of(const Entity e) noexcept
+      -> Entity {
+        return e & _index_mask;
+    }
+
+    /// @brief Returns the generation part of the specified entity.
+    [[nodiscard]] static constexpr auto generation_of(const Entity e) noexcept
+      -> Entity {
+        return e >> index_bits;
+    }
+
+    /// @brief Returns a recycled entity or a new one not in use.
+    ///
+    /// Recycled entities are returned without calling is_used. The first
+    /// generation of a new index is skipped if it is in use, for example
+    /// because it was stored explicitly, and the index is recycled later.
+    template <typename Predicate>
+    auto allocate(const Predicate& is_used) -> Entity {
+        if(not _free.empty()) {
+            const auto index{_free.back()};
+            _free.pop_back();
+            auto& slot{_slots[index]};
+            slot.alive = true;
+            return Entity(Entity(slot.generation << index_bits) | index);
+        }
+        while(true) {
+            assert(_slots.size() < _index_mask);
+            const auto index{Entity(_slots.size())};
+            auto& slot{_slots.emplace_back()};
+            const auto e{Entity(Entity(slot.generation << index_bits) | index)};
+            if(not is_used(e)) {
+                slot.alive = true;
+                return e;
+            }
+            ++slot.generation;
+            _free.push_back(index);
+        }
+    }
+
+    /// @brief Releases the specified entity for reuse.
+    /// @returns false if the entity is not alive.
+    auto release(const Entity e) -> bool {
+        if(not is_alive(e)) {
+            return false;
+        }
+        auto& slot{_slots[index_of(e)]};
+        slot.alive = false;
+        if(slot.generation < _max_generation) {
+            ++slot.generation;
+            _free.push_back(index_of(e));
+        }
+        return true;
+    }
+
+    /// @brief Indicates if e was allocated and not released since.
+    [[nodiscard]] auto is_alive(const Entity e) const noexcept -> tribool {
+        const auto index{index_of(e)};
+        return (index > 0U) and (index < _slots.size()) and
+               _slots[index].alive and
+               (_slots[index].generation == generation_of(e));
+    }
+
+    /// @brief Saves the generations of the slots and the free list.
+    void save_snapshot(snapshot_writer& writer) const {
+        std::vector<Entity> generations;
+        std::vector<std::uint8_t> alive;
+        generations.reserve(_slots.size());
+        alive.reserve(_slots.size());
+        for(const auto& slot : _slots) {
+            generations.push_back(slot.generation);
+            alive.push_back(slot.alive ? 1U : 0U);
+        }
+        writer.write_value(std::uint64_t(_slots.size()));
+        writer.write_values(std::span<const Entity>{generations});
+        writer.write_values(std::span<const std::uint8_t>{alive});
+        writer.write_value(std::uint64_t(_free.size()));
+        writer.write_values(std::span<const Entity>{_free});
+    }
+
+    /// @brief Loads the generations of the slots and the free list.
+    /// @returns false if the snapshot data is not valid.
+    auto load_snapshot(snapshot_reader& reader) -> bool {
+        std::uint64_t slot_count{0U};
+        if(
+          not reader.read_value(slot_count) or (slot_count == 0U) or
+          (slot_count > reader.remaining())) {
+            return false;
+        }
+        std::vector<Entity> generations(slot_count);
+        std::vector<std::uint8_t> alive(slot_count);
+        std::uint64_t free_count{0U};
+        if(
+          not reader.read_values(std::span{generations}) or
+          not reader.read_values(std::span{alive}) or
+          not reader.read_value(free_count) or
+          (free_count > reader.remaining())) {
+            return false;
+        }
+        std::vector<Entity> free(free_count);
+        if(not reader.read_values(std::span{free})) {
+            return false;
+        }
+        for(const auto index : free) {
+            if((index == 0U) or (index >= slot_count) or alive[index]) {
+                return false;
+            }
+        }
+        _slots.resize(slot_count);
+        for(std::size_t i = 0; i < _slots.size(); ++i) {
+            _slots[i] = {.generation = generations[i], .alive = alive[i] != 0U};
+        }
+        _free = std::move(free);
+        return true;
+    }
+
+private:
+    static constexpr const Entity _index_mask{
+      Entity(~Entity(0U) >> (sizeof(Entity) * 8U - index_bits))};
+    static constexpr const Entity _max_generation{
+      Entity(~Entity(0U) >> index_bits)};
+
+    struct _slot {
+        Entity generation{0U};
+        bool alive{false};
+    };
+
+    std::vector<_slot> _slots{1U};
+    std::vector<Entity> _free;
+};
+//------------------------------------------------------------------------------
+/// @brief Generational allocator of entity handles.
+/// @ingroup ecs
+/// @see entity_handle
+/// @see generational_entity_allocator
+export template <std::size_t IndexBits>
+class entity_handle_allocator {
+    using _handle_t = entity_handle<IndexBits>;
+
+public:
+    /// @brief Returns a new or recycled entity handle.
+    template <typename Predicate>
+    auto allocate(const Predicate& is_used) -> _handle_t {
+        return _handle_t::from_value(_values.allocate(
+          [&](std::uint32_t v) { return is_used(_handle_t::from_value(v)); }));
+    }
+
+    /// @brief Releases the specified entity handle for reuse.
+    /// @returns false if the entity is not alive.
+    auto release(const _handle_t e) -> bool {
+        return _values.release(e.value());
+    }
+
+    /// @brief Indicates if e was allocated and not released since.
+    [[nodiscard]] auto is_alive(const _handle_t e) const noexcept -> tribool {
+        return _values.is_alive(e.value());
+    }
+
+    void save_snapshot(snapshot_writer& writer) const {
+        _values.save_snapshot(writer);
+    }
+
+    auto load_snapshot(snapshot_reader& reader) -> bool {
+        return _values.load_snapshot(reader);
+    }
+
+private:
+    generational_entity_allocator<typename _handle_t::value_type, IndexBits>
+      _values;
+};
+//------------------------------------------------------------------------------
 } // namespace eagine::ecs
+//------------------------------------------------------------------------------
+template <std::size_t IndexBits>
+struct std::hash<eagine::ecs::entity_handle<IndexBits>> {
+    auto operator()(const eagine::ecs::entity_handle<IndexBits> e)
+      const noexcept -> std::size_t {
+        return std::hash<std::uint32_t>{}(e.value());
+    }
+};
 
@@ -0,0 +1,477 @@
+/// @file
+///
+/// Copyright Matus Chochlik.
+/// Distributed under the Boost Software License, Version 1.0.
+/// See accompanying file LICENSE_1_0.txt or copy at
+/// https://www.boost.org/LICENSE_1_0.txt
+///
+module;
+
+#include <cassert>
+
+export module eagine.ecs:flag_storage;
+
+import std;
+import eagine.core.types;
+import eagine.core.utility;
+import eagine.core.container;
+import :entity_traits;
+import :manipulator;
+import :storage;
+import :map_storage;
+
+namespace eagine::ecs {
+//------------------------------------------------------------------------------
+/// @brief Component stored together with its visibility flag.
+/// @ingroup ecs
+/// @see basic_flag_map_cmp_storage
+export template <typename Component>
+struct flagged_component {
+    Component component;
+    bool hidden{false};
+};
+//------------------------------------------------------------------------------
+export template <typename Entity, typename Component, class Map>
+class basic_flag_map_cmp_storage;
+
+export template <typename Entity, typename Component, class Map>
+class basic_flag_map_cmp_storage_iterator
+  : public component_storage_iterator_intf<Entity> {
+public:
+    basic_flag_map_cmp_storage_iterator(Map& m) noexcept
+      : _map{&m}
+      , _i{m.begin()} {
+        assert(_map);
+        _skip();
+    }
+
+    void reset() final {
+        assert(_map);
+        _i = _map->begin();
+        _skip();
+    }
+
+    auto done() -> bool final {
+        assert(_map);
+        return _i == _map->end();
+    }
+
+    void next() final {
+        assert(not done());
+        ++_i;
+        _skip();
+    }
+
+    auto seek(entity_param_t<Entity> e) -> bool final {
+        assert(_map);
+        map_seek(*_map, _i, e);
+        _skip();
+        return not done();
+    }
+
+    auto find(entity_param_t<Entity> e) -> bool final {
+        return seek(e) and (_i->first == e);
+    }
+
+    auto current() -> Entity final {
+        return _i->first;
+    }
+
+private:
+    using _iter_t = typename Map::iterator;
+    Map* _map{nullptr};
+    _iter_t _i;
+
+    // hidden components are not visited
+    void _skip() noexcept {
+        while((_i != _map->end()) and _i->second.hidden) {
+            ++_i;
+        }
+    }
+
+    friend class basic_flag_map_cmp_storage<Entity, Component, Map>;
+};
+//------------------------------------------------------------------------------
+/// @brief Component storage keeping hidden components in place.
+/// @ingroup ecs
+/// @see flagged_component
+///
+/// Unlike basic_map_cmp_storage, which moves hidden components into another
+/// map, this storage only sets the visibility flag stored with the component
+/// and skips the hidden components during iteration. Hiding and showing
+/// components thus does not allocate memory or move the other components.
+export template <typename Entity, typename Component, class Map>
+class basic_flag_map_cmp_storage : public component_storage<Entity, Component> {
+public:
+    using entity_param = entity_param_t<Entity>;
+    using iterator_t = component_storage_iterator<Entity>;
+
+    auto capabilities() -> storage_caps final {
+        return storage_caps{
+          storage_cap_bit::hide | storage_cap_bit::copy |
+          storage_cap_bit::exchange | storage_cap_bit::remove |
+          storage_cap_bit::store | storage_cap_bit::modify};
+    }
+
+    void swap_buffers() final {}
+
+    void set_observer(storage_observer<Entity>* observer, std::size_t key)
+      final {
+        _observer.reset(observer, key);
+    }
+
+    auto size() -> std::size_t final {
+        return _components.size() - _hidden_count;
+    }
+
+    auto new_iterator(storage_buffer) -> iterator_t final {
+        const std::unique_lock lock{_iter_mutex};
+        return iterator_t(_iterators.make(_components));
+    }
+
+    void delete_iterator(iterator_t&& i) final {
+        const std::unique_lock lock{_iter_mutex};
+        _iterators.eat(i.release());
+    }
+
+    auto has(entity_param e) -> bool final {
+        const auto pos{_components.find(e)};
+        return (pos != _components.end()) and not pos->second.hidden;
+    }
+
+    auto is_hidden(entity_param e) -> bool final {
+        const auto pos{_components.find(e)};
+        return (pos != _components.end()) and pos->second.hidden;
+    }
+
+    auto is_hidden(iterator_t& i) -> bool final {
+        assert(not i.done());
+        return _iter_cast(i)._i->second.hidden;
+    }
+
+    auto hide(entity_param e) -> bool final {
+        const auto pos{_components.find(e)};
+        if((pos != _components.end()) and not pos->second.hidden) {
+            _hide(pos);
+            return true;
+        }
+        return false;
+    }
+
+    void hide(iterator_t& i) final {
+        assert(not i.done());
+        auto& iter{_iter_cast(i)};
+        _hide(iter._i);
+        iter._skip();
+    }
+
+    auto show(entity_param e) -> bool final {
+        const auto pos{_components.find(e)};
+        if((pos != _components.end()) and pos->second.hidden) {
+            pos->second.hidden = false;
+            --_hidden_count;
+            _observer.shown(e);
+            return true;
+        }
+        return false;
+    }
+
+    auto copy(entity_param ef, entity_param et) -> void* final {
+        if(const auto found{_find_shown(ef)}) {
+            return static_cast<void*>(store(et, Component(*found)));
+        }
+        return nullptr;
+    }
+
+    auto exchange(const entity_param ea, const entity_param eb) -> bool final {
+        const auto fa{_find_shown(ea)};
+        const auto fb{_find_shown(eb)};
+
+        if(fa and fb) {
+            using std::swap;
+            swap(*fa, *fb);
+        } else if(fa) {
+            store(eb, std::move(*fa));
+            remove(ea);
+        } else if(fb) {
+            store(ea, std::move(*fb));
+            remove(eb);
+        }
+        return true;
+    }
+
+    auto remove(entity_param e) -> bool final {
+        const auto pos{_components.find(e)};
+        if(pos != _components.end()) {
+            const bool was_shown{not pos->second.hidden};
+            _remove(pos);
+            return was_shown;
+        }
+        return false;
+    }
+
+    void remove(iterator_t& i) final {
+        assert(not i.done());
+        auto& iter{_iter_cast(i)};
+        iter._i = _remove(iter._i);
+        iter._skip();
+    }
+
+    auto store(entity_param e, Component&& c) -> Component* final {
+        auto pos{_components.find(e)};
+        if(pos == _components.end()) {
+            pos = _components.emplace(e, _entry_t{std::move(c), false}).first;
+        } else {
+            _replace_hidden(pos, std::move(c));
+        }
+        _observer.stored(e);
+        return &pos->second.component;
+    }
+
+    auto store(iterator_t& i, entity_param e, Component&& c)
+      -> Component* final {
+        auto& pos{_iter_cast(i)._i};
+        pos = _components.find(e);
+        if(pos == _components.end()) {
+            pos = _components.emplace(e, _entry_t{std::move(c), false}).first;
+        } else {
+            _replace_hidden(pos, std::move(c));
+        }
+        _observer.stored(e);
+        return &pos->second.component;
+    }
+
+    void for_single(
+      const callable_ref<void(entity_param, manipulator<const Component>&)> func,
+      entity_param e) final {
+        _apply_single<const Component>(func, e);
+    }
+
+    void for_single(
+      const callable_ref<void(entity_param, manipulator<const Component>&)> func,
+      iterator_t& i) final {
+        assert(not i.done());
+        _apply_single_iter<const Component>(func, i);
+    }
+
+    void for_single(
+      const callable_ref<void(entity_param, manipulator<Component>&)> func,
+      entity_param e) final {
+        _apply_single<Component>(func, e);
+    }
+
+    void for_single(
+      const callable_ref<void(entity_param, manipulator<Component>&)> func,
+      iterator_t& i) final {
+        assert(not i.done());
+        _apply_single_iter<Component>(func, i);
+    }
+
+    void for_each(
+      const callable_ref<void(entity_param, manipulator<const Component>&)>
+        func) final {
+        for_each_direct<const Component>(func);
+    }
+
+    void for_each(
+      const callable_ref<void(entity_param, manipulator<Component>&)> func)
+      final {
+        for_each_direct<Component>(func);
+    }
+
+    void for_each(const callable_ref<void(manipulator<Component>&)> func) final {
+        for_each_direct<Component>(
+          [&func](entity_param, manipulator<Component>& m) { func(m); });
+    }
+
+    void for_each_batch(
+      const callable_ref<
+        void(std::span<const Entity>, std::span<const Component>)> func) final {
+        _for_each_batch<const Component>(func);
+    }
+
+    void for_each_batch(
+      const callable_ref<void(std::span<const Entity>, std::span<Component>)>
+        func) final {
+        _for_each_batch<Component>(func);
+    }
+
+    void for_each_hidden(
+      const callable_ref<void(entity_param, manipulator<const Component>&)> func)
+      final {
+        concrete_manipulator<const Component> m(false /*can_remove*/);
+        for(auto& [entity, entry] : _components) {
+            if(entry.hidden) {
+                m.reset(entry.component);
+                func(entity, m);
+            }
+        }
+    }
+
+    /// @brief Calls a function on each shown component without type erasure.
+    /// @see basic_manager::read_each
+    /// @see basic_manager::write_each
+    template <typename C, typename Function>
+    void for_each_direct(Function&& func) {
+        concrete_manipulator<C> m(true /*can_remove*/);
+        map_sweep(
+          _components,
+          _components.begin(),
+          [](const auto&) { return true; },
+          [&](auto& entry) {
+              if(entry.second.hidden) {
+                  return false;
+              }
+              m.reset(entry.second.component);
+              func(entry.first, m);
+              if(m.remove_requested()) {
+                  return true;
+              }
+              if constexpr(not std::is_const_v<C>) {
+                  _observer.modified(entry.first);
+              }
+              return false;
+          },
+          [this](const auto& entry) { _observer.removed(entry.first); });
+    }
+
+private:
+    using _entry_t = flagged_component<Component>;
+    using _map_iter_t =
+      basic_flag_map_cmp_storage_iterator<Entity, Component, Map>;
+
+    Map _components{};
+    std::size_t _hidden_count{0U};
+    object_pool<_map_iter_t, 2> _iterators{};
+    std::mutex _iter_mutex;
+    storage_observer_ref<Entity> _observer;
+
+    auto _iter_cast(component_storage_iterator<Entity>& i) noexcept -> auto& {
+        assert(dynamic_cast<_map_iter_t*>(i.ptr()));
+        return *static_cast<_map_iter_t*>(i.ptr());
+    }
+
+    auto _find_shown(entity_param e) noexcept -> Component* {
+        const auto pos{_components.find(e)};
+        if((pos != _components.end()) and not pos->second.hidden) {
+            return &pos->second.component;
+        }
+        return nullptr;
+    }
+
+    void _hide(typename Map::iterator pos) {
+        assert(not pos->second.hidden);
+        pos->second.hidden = true;
+        ++_hidden_count;
+        _observer.hidden(pos->first);
+    }
+
+    // like storing into basic_map_cmp_storage, replaces a hidden component
+    // and keeps a shown one
+    void _replace_hidden(typename Map::iterator pos, Component&& c) {
+        if(pos->second.hidden) {
+            pos->second = _entry_t{std::move(c), false};
+            --_hidden_count;
+        }
+    }
+
+    auto _remove(typename Map::iterator pos) {
+        assert(pos != _components.end());
+        if(pos->second.hidden) {
+            --_hidden_count;
+        }
+        _observer.removed(pos->first);
+        return _components.erase(pos);
+    }
+
+    template <typename C, typename Func>
+    void _apply_single(const Func& func, entity_param e) {
+        const auto pos{_components.find(e)};
+        if((pos != _components.end()) and not pos->second.hidden) {
+            concrete_manipulator<C> m(
+              pos->second.component, true /*can_remove*/);
+            func(e, m);
+            if(m.remove_requested()) {
+                _remove(pos);
+            } else if constexpr(not std::is_const_v<C>) {
+                _observer.modified(e);
+            }
+        }
+    }
+
+    template <typename C, typename Func>
+    void _apply_single_iter(const Func& func, iterator_t& i) {
+        auto& iter{_iter_cast(i)};
+        auto& p{iter._i};
+        assert(p != _components.end());
+        concrete_manipulator<C> m(p->second.component, true /*can_remove*/);
+        func(p->first, m);
+        if(m.remove_requested()) {
+            p = _remove(p);
+            iter._skip();
+        } else if constexpr(not std::is_const_v<C>) {
+            _observer.modified(p->first);
+        }
+    }
+
+    // the shown trivially copyable components are staged in blocks of about
+    // one memory page and written back after the call, other components are
+    // passed one at a time
+    template <typename C, typename Func>
+    void _for_each_batch(const Func& func) {
+        if constexpr(std::is_trivially_copyable_v<Component>) {
+            const std::size_t batch_size{
+              std::max<std::size_t>(4096U / sizeof(Component), 1U)};
+            std::vector<Entity> entities;
+            std::vector<Component> staged;
+            std::vector<Component*> targets;
+            entities.reserve(batch_size);
+            staged.reserve(batch_size);
+            targets.reserve(batch_size);
+            auto p = _components.begin();
+            while(p != _components.end()) {
+                entities.clear();
+                staged.clear();
+                targets.clear();
+                while((p != _components.end()) and
+                      (entities.size() < batch_size)) {
+                    if(not p->second.hidden) {
+                        entities.push_back(p->first);
+                        staged.push_back(p->second.component);
+                        targets.push_back(&p->second.component);
+                    }
+                    ++p;
+                }
+                if(entities.empty()) {
+                    continue;
+                }
+                func(std::span<const Entity>{entities}, std::span<C>{staged});
+                if constexpr(not std::is_const_v<C>) {
+                    for(std::size_t k = 0U; k < staged.size(); ++k) {
+                        *targets[k] = staged[k];
+                        _observer.modified(entities[k]);
+                    }
+                }
+            }
+        } else {
+            for(auto& [entity, entry] : _components) {
+                if(not entry.hidden) {
+                    func(
+                      std::span<const Entity>{&entity, 1U},
+                      std::span<C>{&entry.component, 1U});
+                    if constexpr(not std::is_const_v<C>) {
+                        _observer.modified(entity);
+                    }
+                }
+            }
+        }
+    }
+};
+//------------------------------------------------------------------------------
+export template <typename Entity, typename Component>
+using flag_map_cmp_storage = basic_flag_map_cmp_storage<
+  Entity,
+  Component,
+  flat_map<Entity, flagged_component<Component>>>;
+//------------------------------------------------------------------------------
+} // namespace eagine::ecs
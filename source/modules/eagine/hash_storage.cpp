@@ -0,0 +1,704 @@
+/// @file
+///
+/// Copyright Matus Chochlik.
+/// Distributed under the Boost Software License, Version 1.0.
+/// See accompanying file LICENSE_1_0.txt or copy at
+/// https://www.boost.org/LICENSE_1_0.txt
+///
+module;
+
+#include <cassert>
+
+export module eagine.ecs:hash_storage;
+
+import std;
+import eagine.core.types;
+import eagine.core.utility;
+import eagine.core.container;
+import :entity_traits;
+import :manipulator;
+import :storage;
+import :map_storage;
+
+namespace eagine::ecs {
+//------------------------------------------------------------------------------
+/// @brief Transparent hash function for entities.
+/// @ingroup ecs
+/// @see hash_map
+///
+/// Strings and anything convertible to std::string_view are hashed as
+/// std::string_view, so std::string entities can be looked up by string
+/// views or literals without constructing a temporary std::string.
+export struct entity_hash {
+    using is_transparent = void;
+
+    template <typename T>
+        requires(std::is_convertible_v<const T&, std::string_view>)
+    auto operator()(const T& key) const noexcept -> std::size_t {
+        return std::hash<std::string_view>{}(std::string_view{key});
+    }
+
+    template <typename T>
+    auto operator()(const T& key) const noexcept -> std::size_t {
+        return std::hash<T>{}(key);
+    }
+};
+//------------------------------------------------------------------------------
+/// @brief Open-addressing hash map used by the hash component storages.
+/// @ingroup ecs
+/// @see hash_map_cmp_storage
+/// @see hash_map_rel_storage
+///
+/// The entries are kept in a power-of-two sized array of slots probed
+/// linearly, with a separate array of control bytes holding a few bits
+/// of the hash of each used slot, so most of the mismatching slots are
+/// skipped without comparing the keys. Erased slots are only marked,
+/// the other entries are never moved, so erasing while iterating keeps
+/// the iterators valid. Inserting may rehash and invalidate them.
+/// The lookup functions accept any key supported by Hash and KeyEqual.
+export template <
+  typename Key,
+  typename Value,
+  typename Hash = entity_hash,
+  typename KeyEqual = std::equal_to<>>
+class hash_map {
+    using _slot_t = std::optional<std::pair<Key, Value>>;
+
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = std::pair<Key, Value>;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+
+    template <bool IsConst>
+    class basic_iterator {
+        using _map_t = std::conditional_t<IsConst, const hash_map, hash_map>;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = hash_map::value_type;
+        using reference =
+          std::conditional_t<IsConst, const value_type&, value_type&>;
+        using pointer =
+          std::conditional_t<IsConst, const value_type*, value_type*>;
+
+        basic_iterator() noexcept = default;
+
+        basic_iterator(_map_t& m, std::size_t slot) noexcept
+          : _map{&m}
+          , _slot{slot} {}
+
+        operator basic_iterator<true>() const noexcept
+            requires(not IsConst)
+        {
+            return {*_map, _slot};
+        }
+
+        auto operator*() const noexcept -> reference {
+            assert(_map);
+            return *_map->_slots[_slot];
+        }
+
+        auto operator->() const noexcept -> pointer {
+            return &**this;
+        }
+
+        auto operator++() noexcept -> basic_iterator& {
+            assert(_map);
+            _slot = _map->_next_used(_slot + 1U);
+            return *this;
+        }
+
+        auto operator++(int) noexcept -> basic_iterator {
+            auto result{*this};
+            ++*this;
+            return result;
+        }
+
+        friend auto operator==(
+          const basic_iterator& l,
+          const basic_iterator& r) noexcept -> bool {
+            return l._slot == r._slot;
+        }
+
+    private:
+        _map_t* _map{nullptr};
+        std::size_t _slot{0U};
+
+        friend class hash_map;
+    };
+
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    [[nodiscard]] auto empty() const noexcept -> bool {
+        return _size == 0U;
+    }
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t {
+        return _size;
+    }
+
+    [[nodiscard]] auto begin() noexcept -> iterator {
+        return {*this, _next_used(0U)};
+    }
+
+    [[nodiscard]] auto begin() const noexcept -> const_iterator {
+        return {*this, _next_used(0U)};
+    }
+
+    [[nodiscard]] auto end() noexcept -> iterator {
+        return {*this, _slots.size()};
+    }
+
+    [[nodiscard]] auto end() const noexcept -> const_iterator {
+        return {*this, _slots.size()};
+    }
+
+    template <typename K>
+    [[nodiscard]] auto find(const K& key) noexcept -> iterator {
+        return {*this, _find(key)};
+    }
+
+    template <typename K>
+    [[nodiscard]] auto find(const K& key) const noexcept -> const_iterator {
+        return {*this, _find(key)};
+    }
+
+    template <typename K>
+    [[nodiscard]] auto contains(const K& key) const noexcept -> bool {
+        return _find(key) < _slots.size();
+    }
+
+    /// @brief Inserts a value constructed from args unless the key is stored.
+    template <typename K, typename... Args>
+    auto try_emplace(K&& key, Args&&... args) -> std::pair<iterator, bool> {
+        const auto hash{_hash(key)};
+        if(const auto found{_find(key, hash)}; found < _slots.size()) {
+            return {{*this, found}, false};
+        }
+        if((_size + _erased + 1U) * 4U > _slots.size() * 3U) {
+            _rehash(std::max<std::size_t>(
+              std::bit_ceil((_size + 1U) * 2U), _min_slot_count));
+        }
+        const auto slot{_free_slot(hash)};
+        if(_control[slot] == _erased_slot) {
+            --_erased;
+        }
+        _slots[slot].emplace(
+          std::piecewise_construct,
+          std::forward_as_tuple(std::forward<K>(key)),
+          std::forward_as_tuple(std::forward<Args>(args)...));
+        _control[slot] = _tag(hash);
+        ++_size;
+        return {{*this, slot}, true};
+    }
+
+    auto emplace(value_type&& entry) -> std::pair<iterator, bool> {
+        return try_emplace(std::move(entry.first), std::move(entry.second));
+    }
+
+    template <typename K, typename V>
+    auto emplace(K&& key, V&& value) -> std::pair<iterator, bool> {
+        return try_emplace(std::forward<K>(key), std::forward<V>(value));
+    }
+
+    /// @brief Same as emplace, the position hint is ignored.
+    template <typename... Args>
+    auto emplace_hint(const_iterator, Args&&... args) -> iterator {
+        return emplace(std::forward<Args>(args)...).first;
+    }
+
+    /// @brief Erases the entry at the specified position.
+    /// @returns The iterator to the following entry.
+    auto erase(const_iterator pos) noexcept -> iterator {
+        assert(pos._slot < _slots.size());
+        assert(_slots[pos._slot].has_value());
+        _slots[pos._slot].reset();
+        _control[pos._slot] = _erased_slot;
+        --_size;
+        ++_erased;
+        return {*this, _next_used(pos._slot + 1U)};
+    }
+
+    template <typename K>
+    auto erase(const K& key) noexcept -> std::size_t
+        requires(not std::is_convertible_v<const K&, const_iterator>)
+    {
+        if(const auto found{_find(key)}; found < _slots.size()) {
+            erase(const_iterator{*this, found});
+            return 1U;
+        }
+        return 0U;
+    }
+
+    void reserve(std::size_t count) {
+        if(count * 4U > _slots.size() * 3U) {
+            _rehash(std::max<std::size_t>(
+              std::bit_ceil(count * 4U / 3U + 1U), _min_slot_count));
+        }
+    }
+
+    void clear() noexcept {
+        _control.clear();
+        _slots.clear();
+        _size = 0U;
+        _erased = 0U;
+    }
+
+private:
+    static constexpr const std::uint8_t _empty_slot{0x00U};
+    static constexpr const std::uint8_t _erased_slot{0x01U};
+    static constexpr const std::size_t _min_slot_count{16U};
+
+    std::vector<std::uint8_t> _control;
+    std::vector<_slot_t> _slots;
+    std::size_t _size{0U};
+    std::size_t _erased{0U};
+    [[no_unique_address]] Hash _hasher{};
+    [[no_unique_address]] KeyEqual _equal{};
+
+    // mixes the bits, so that sequential integral keys get spread over
+    // the slots and the high bits can be used for the control tags
+    template <typename K>
+    auto _hash(const K& key) const noexcept -> std::uint64_t {
+        auto h{static_cast<std::uint64_t>(_hasher(key))};
+        h ^= h >> 33U;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33U;
+        return h;
+    }
+
+    static constexpr auto _tag(std::uint64_t hash) noexcept -> std::uint8_t {
+        return static_cast<std::uint8_t>(0x80U | (hash >> 57U));
+    }
+
+    auto _mask() const noexcept -> std::size_t {
+        return _slots.size() - 1U;
+    }
+
+    auto _next_used(std::size_t slot) const noexcept -> std::size_t {
+        while((slot < _control.size()) and (_control[slot] < 0x80U)) {
+            ++slot;
+        }
+        return std::min(slot, _slots.size());
+    }
+
+    template <typename K>
+    auto _find(const K& key) const noexcept -> std::size_t {
+        return _find(key, _hash(key));
+    }
+
+    template <typename K>
+    auto _find(const K& key, std::uint64_t hash) const noexcept
+      -> std::size_t {
+        if(_size == 0U) {
+            return _slots.size();
+        }
+        const auto tag{_tag(hash)};
+        for(auto slot{std::size_t(hash) & _mask()};;
+            slot = (slot + 1U) & _mask()) {
+            const auto control{_control[slot]};
+            if(control == _empty_slot) {
+                return _slots.size();
+            }
+            if((control == tag) and _equal(_slots[slot]->first, key)) {
+                return slot;
+            }
+        }
+    }
+
+    auto _free_slot(std::uint64_t hash) const noexcept -> std::size_t {
+        auto slot{std::size_t(hash) & _mask()};
+        while(_control[slot] >= 0x80U) {
+            slot = (slot + 1U) & _mask();
+        }
+        return slot;
+    }
+
+    void _rehash(std::size_t slot_count) {
+        assert(std::has_single_bit(slot_count));
+        auto slots{std::exchange(_slots, std::vector<_slot_t>(slot_count))};
+        _control.assign(slot_count, _empty_slot);
+        _erased = 0U;
+        for(auto& entry : slots) {
+            if(entry) {
+                const auto hash{_hash(entry->first)};
+                const auto slot{_free_slot(hash)};
+                _slots[slot].emplace(std::move(*entry));
+                _control[slot] = _tag(hash);
+            }
+        }
+    }
+};
+//------------------------------------------------------------------------------
+export template <typename Entity, typename Relation, class Map>
+class basic_hash_rel_storage;
+
+export template <typename Entity, typename Relation, class Map>
+class basic_hash_rel_storage_iterator
+  : public relation_storage_iterator_intf<Entity> {
+public:
+    basic_hash_rel_storage_iterator(Map& m) noexcept
+      : _map{&m}
+      , _i{m.begin()} {
+        assert(_map);
+    }
+
+    void reset() final {
+        assert(_map);
+        _i = _map->begin();
+        _j = 0U;
+    }
+
+    auto done() -> bool final {
+        assert(_map);
+        return _i == _map->end();
+    }
+
+    void next() final {
+        assert(not done());
+        if(++_j >= _i->second.size()) {
+            ++_i;
+            _j = 0U;
+        }
+    }
+
+    auto subject() -> Entity final {
+        return _i->first;
+    }
+
+    auto object() -> Entity final {
+        return _i->second[_j].first;
+    }
+
+private:
+    using _iter_t = typename Map::iterator;
+    Map* _map{nullptr};
+    _iter_t _i;
+    std::size_t _j{0U};
+
+    friend class basic_hash_rel_storage<Entity, Relation, Map>;
+};
+//------------------------------------------------------------------------------
+/// @brief Relation storage keeping the objects of each subject in a hash map.
+/// @ingroup ecs
+/// @see hash_map_rel_storage
+///
+/// The Map maps each subject to a vector of (object, relation) pairs sorted
+/// by object. Finding the relations of a subject is a hash lookup followed
+/// by a binary search of its objects; subjects without any object are not
+/// kept in the Map. Finding the subjects of an object scans all subjects.
+export template <typename Entity, typename Relation, class Map>
+class basic_hash_rel_storage : public relation_storage<Entity, Relation> {
+    using _map_iter_t = basic_hash_rel_storage_iterator<Entity, Relation, Map>;
+    using _objects_t = typename Map::mapped_type;
+
+public:
+    using entity_param = entity_param_t<Entity>;
+    using iterator_t = relation_storage_iterator<Entity>;
+
+    auto capabilities() -> storage_caps final {
+        return storage_caps{
+          storage_cap_bit::remove | storage_cap_bit::store |
+          storage_cap_bit::modify | storage_cap_bit::unordered};
+    }
+
+    void swap_buffers() final {}
+
+    void set_observer(storage_observer<Entity>* observer, std::size_t key)
+      final {
+        _observer.reset(observer, key);
+    }
+
+    auto new_iterator(storage_buffer) -> iterator_t final {
+        const std::unique_lock lock{_iter_mutex};
+        return iterator_t(_iterators.make(_relations));
+    }
+
+    void delete_iterator(iterator_t&& i) final {
+        const std::unique_lock lock{_iter_mutex};
+        _iterators.eat(i.release());
+    }
+
+    auto has(entity_param s, entity_param o) -> bool final {
+        return _find(s, o) != nullptr;
+    }
+
+    /// @brief Indicates if the subject and object with the specified keys
+    /// are related.
+    ///
+    /// The keys are any types comparable with the entities, for example
+    /// std::string_view for std::string entities.
+    template <typename S, typename O>
+    auto has(const S& subject, const O& object) -> bool {
+        return _find(subject, object) != nullptr;
+    }
+
+    auto store(entity_param s, entity_param o) -> bool final {
+        _emplace(s, o, Relation());
+        return true;
+    }
+
+    auto store(entity_param s, entity_param o, Relation&& r)
+      -> Relation* final {
+        return _emplace(s, o, std::move(r));
+    }
+
+    auto remove(entity_param s, entity_param o) -> bool final {
+        if(const auto found{_relations.find(s)}; found != _relations.end()) {
+            auto& objects{found->second};
+            const auto pos{_lower_bound(objects, o)};
+            if((pos != objects.end()) and (pos->first == o)) {
+                objects.erase(pos);
+                if(objects.empty()) {
+                    _relations.erase(found);
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void remove(iterator_t& i) final {
+        assert(not i.done());
+        auto& iter{_iter_cast(i)};
+        auto& objects{iter._i->second};
+        objects.erase(std::next(objects.begin(), std::ptrdiff_t(iter._j)));
+        if(objects.empty()) {
+            iter._i = _relations.erase(iter._i);
+            iter._j = 0U;
+        } else if(iter._j >= objects.size()) {
+            ++iter._i;
+            iter._j = 0U;
+        }
+    }
+
+    void for_single(
+      const callable_ref<
+        void(entity_param, entity_param, manipulator<const Relation>&)> func,
+      entity_param subject,
+      entity_param object) final {
+        _for_single<const Relation>(func, subject, object);
+    }
+
+    void for_single(
+      const callable_ref<
+        void(entity_param, entity_param, manipulator<const Relation>&)> func,
+      iterator_t& i) final {
+        _for_single<const Relation>(func, i);
+    }
+
+    void for_single(
+      const callable_ref<
+        void(entity_param, entity_param, manipulator<Relation>&)> func,
+      entity_param subject,
+      entity_param object) final {
+        _for_single<Relation>(func, subject, object);
+    }
+
+    void for_single(
+      const callable_ref<
+        void(entity_param, entity_param, manipulator<Relation>&)> func,
+      iterator_t& i) final {
+        _for_single<Relation>(func, i);
+    }
+
+    void for_each(
+      const callable_ref<void(entity_param, entity_param)> func,
+      entity_param subject) final {
+        if(const auto found{_relations.find(subject)};
+           found != _relations.end()) {
+            for(const auto& entry : found->second) {
+                func(subject, entry.first);
+            }
+        }
+    }
+
+    void for_each(
+      const callable_ref<void(entity_param, entity_param)> func) final {
+        for(const auto& [subject, objects] : _relations) {
+            for(const auto& entry : objects) {
+                func(subject, entry.first);
+            }
+        }
+    }
+
+    void for_each_subject_of(
+      const callable_ref<void(entity_param, entity_param)> func,
+      entity_param object) final {
+        for(auto& [subject, objects] : _relations) {
+            const auto pos{_lower_bound(objects, object)};
+            if((pos != objects.end()) and (pos->first == object)) {
+                func(subject, object);
+            }
+        }
+    }
+
+    void for_each(
+      const callable_ref<
+        void(entity_param, entity_param, manipulator<const Relation>&)> func,
+      entity_param subject) final {
+        if(const auto found{_relations.find(subject)};
+           found != _relations.end()) {
+            _for_each<const Relation>(func, found);
+        }
+    }
+
+    void for_each(
+      const callable_ref<
+        void(entity_param, entity_param, manipulator<Relation>&)> func,
+      entity_param subject) final {
+        if(const auto found{_relations.find(subject)};
+           found != _relations.end()) {
+            _for_each<Relation>(func, found);
+        }
+    }
+
+    void for_each(
+      const callable_ref<
+        void(entity_param, entity_param, manipulator<const Relation>&)> func)
+      final {
+        for(auto pos{_relations.begin()}; pos != _relations.end();) {
+            pos = _for_each<const Relation>(func, pos);
+        }
+    }
+
+    void for_each(
+      const callable_ref<
+        void(entity_param, entity_param, manipulator<Relation>&)> func) final {
+        for(auto pos{_relations.begin()}; pos != _relations.end();) {
+            pos = _for_each<Relation>(func, pos);
+        }
+    }
+
+private:
+    Map _relations;
+    object_pool<_map_iter_t, 2> _iterators{};
+    std::mutex _iter_mutex;
+    storage_observer_ref<Entity> _observer;
+
+    auto _iter_cast(relation_storage_iterator<Entity>& i) noexcept -> auto& {
+        assert(dynamic_cast<_map_iter_t*>(i.ptr()) != nullptr);
+        return *static_cast<_map_iter_t*>(i.ptr());
+    }
+
+    template <typename O>
+    static auto _lower_bound(_objects_t& objects, const O& object) {
+        return std::lower_bound(
+          objects.begin(),
+          objects.end(),
+          object,
+          [](const auto& entry, const O& o) { return entry.first < o; });
+    }
+
+    template <typename S, typename O>
+    auto _find(const S& subject, const O& object) -> Relation* {
+        if(const auto found{_relations.find(subject)};
+           found != _relations.end()) {
+            auto& objects{found->second};
+            const auto pos{_lower_bound(objects, object)};
+            if((pos != objects.end()) and (pos->first == object)) {
+                return &pos->second;
+            }
+        }
+        return nullptr;
+    }
+
+    auto _emplace(entity_param s, entity_param o, Relation&& r) -> Relation* {
+        auto& objects{_relations.try_emplace(s).first->second};
+        auto pos{_lower_bound(objects, o)};
+        if((pos == objects.end()) or (pos->first != o)) {
+            pos = objects.emplace(pos, o, std::move(r));
+        }
+        return &pos->second;
+    }
+
+    template <typename R, typename Func>
+    void _for_single(
+      const Func& func,
+      entity_param subject,
+      entity_param object) {
+        if(auto* found{_find(subject, object)}) {
+            concrete_manipulator<R> m(*found, true /*can_erase*/);
+            func(subject, object, m);
+            if(m.remove_requested()) {
+                remove(subject, object);
+            } else if constexpr(not std::is_const_v<R>) {
+                _observer.modified(subject);
+            }
+        }
+    }
+
+    template <typename R, typename Func>
+    void _for_single(const Func& func, iterator_t& i) {
+        assert(not i.done());
+        auto& iter{_iter_cast(i)};
+        auto& entry{iter._i->second[iter._j]};
+        concrete_manipulator<R> m(entry.second, true /*can_erase*/);
+        func(iter._i->first, entry.first, m);
+        if(m.remove_requested()) {
+            remove(i);
+        } else if constexpr(not std::is_const_v<R>) {
+            _observer.modified(iter._i->first);
+        }
+    }
+
+    // the requested removals are applied after visiting all the objects
+    // of the subject, which is erased if it does not keep any
+    template <typename R, typename Func>
+    auto _for_each(const Func& func, typename Map::iterator pos) ->
+      typename Map::iterator {
+        concrete_manipulator<R> m(true /*can_remove*/);
+        auto& objects{pos->second};
+        auto write{objects.begin()};
+        bool modified{false};
+        for(auto read{objects.begin()}; read != objects.end(); ++read) {
+            m.reset(read->second);
+            func(pos->first, read->first, m);
+            if(not m.remove_requested()) {
+                if(write != read) {
+                    *write = std::move(*read);
+                }
+                ++write;
+                modified = true;
+            }
+        }
+        if constexpr(not std::is_const_v<R>) {
+            if(modified) {
+                _observer.modified(pos->first);
+            }
+        }
+        objects.erase(write, objects.end());
+        if(objects.empty()) {
+            return _relations.erase(pos);
+        }
+        return std::next(pos);
+    }
+};
+//------------------------------------------------------------------------------
+/// @brief Component storage using an open-addressing hash map.
+/// @ingroup ecs
+/// @see hash_map
+/// @see basic_manager::ensure
+///
+/// Suitable for entities that are expensive to compare, like strings.
+/// The storage is not ordered, joins involving it look up the entities
+/// directly instead of merging sorted sequences. Entities can be looked up
+/// by keys of other types comparable with them, like std::string_view.
+export template <typename Entity, typename Component>
+using hash_map_cmp_storage =
+  basic_map_cmp_storage<Entity, Component, hash_map<Entity, Component>>;
+
+/// @brief Relation storage using an open-addressing hash map of subjects.
+/// @ingroup ecs
+/// @see hash_map
+export template <typename Entity, typename Relation>
+using hash_map_rel_storage = basic_hash_rel_storage<
+  Entity,
+  Relation,
+  hash_map<Entity, std::vector<std::pair<Entity, Relation>>>>;
+//------------------------------------------------------------------------------
+} // namespace eagine::ecs
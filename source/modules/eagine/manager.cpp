@@ -17,10 +17,19 @@ import eagine.core.types;
 import eagine.core.string;
 import eagine.core.valid_if;
 import eagine.core.utility;
+import eagine.core.container;
 import :entity_traits;
 import :manipulator;
 import :component;
 import :storage;
+import :archetype_storage;
+import :signature;
+import :view;
+import :change_tracker;
+import :component_signals;
+import :command_buffer;
+import :snapshot;
+import :worker_pool;
 
 namespace eagine::ecs {
 //------------------------------------------------------------------------------
@@ -98,6 +107,65 @@ private:
     }
 };
 //------------------------------------------------------------------------------
+/// @brief Handle of a cached view of the entities having all Components.
+/// @ingroup ecs
+/// @see basic_manager::view
+/// @see entity_view
+///
+/// The handle is cheap to copy and can be kept across frames. The cached
+/// entities are brought up to date on each access.
+export template <typename Entity, typename... Components>
+class basic_view {
+public:
+    basic_view(basic_manager<Entity>& m, entity_view<Entity>& v) noexcept
+      : _m{&m}
+      , _v{&v} {}
+
+    /// @brief Returns the entities having all Components, in ascending order.
+    /// @note The returned span is invalidated by the next access to the view.
+    [[nodiscard]] auto entities() -> std::span<const Entity> {
+        _m->template _refresh_view<std::remove_const_t<Components>...>(*_v);
+        return _v->entities();
+    }
+
+    /// @brief Returns the number of entities in this view.
+    [[nodiscard]] auto size() -> std::size_t {
+        return entities().size();
+    }
+
+    /// @brief Indicates if the specified entity is in this view.
+    [[nodiscard]] auto contains(entity_param_t<Entity> e) -> bool {
+        const auto ents{entities()};
+        return std::binary_search(ents.begin(), ents.end(), e);
+    }
+
+    /// @brief Calls the function on each entity in the view, with the Components.
+    /// @see basic_manager::for_each_with
+    ///
+    /// Components qualified as const are read, the others are written.
+    /// Changes done through the manipulators are reflected by the view
+    /// on the next access. Repeated passes over an unchanged view use
+    /// the component addresses cached by the previous pass, the removals
+    /// requested in such passes are done after visiting all entities.
+    template <typename Func>
+    auto for_each(const Func& func) -> basic_view& {
+        const auto ents{entities()};
+        if(not ents.empty()) {
+            _m->template _call_for_each_c_m_v<Components...>(
+              *_v,
+              ents,
+              callable_ref<void(
+                entity_param_t<Entity>, manipulator<Components> & ...)>{
+                construct_from, func});
+        }
+        return *this;
+    }
+
+private:
+    basic_manager<Entity>* _m;
+    entity_view<Entity>* _v;
+};
+//------------------------------------------------------------------------------
 /// @brief Main class, managing entity data. Entities are represented by values of Entity.
 /// @ingroup ecs
 export template <typename Entity>
@@ -116,10 +184,12 @@ public:
     template <component_data Component>
     auto register_component_type(
       shared_holder<component_storage<Entity, Component>>&& strg) -> auto& {
+        _base_cmp_storage_t* base{strg.get()};
         _do_reg_stg_type<data_kind::component>(
           _base_cmp_storage_ptr_t(std::move(strg)),
           Component::uid(),
           _cmp_name_getter<Component>());
+        _index_storage(component_index<Component>(), base);
         return *this;
     }
 
@@ -130,10 +200,12 @@ public:
     template <relation_data Relation>
     auto register_relation_type(
       shared_holder<relation_storage<Entity, Relation>>&& strg) -> auto& {
+        _base_rel_storage_t* base{strg.get()};
         _do_reg_stg_type<data_kind::relation>(
           _base_rel_storage_ptr_t(std::move(strg)),
           Relation::uid(),
           _cmp_name_getter<Relation>());
+        _index_rel_storage(component_index<Relation>(), base);
         return *this;
     }
 
@@ -158,6 +230,24 @@ public:
         return *this;
     }
 
+    /// @brief Registers archetype table storages for the specified Components.
+    /// @see archetype_registry
+    /// @see register_component_storage
+    ///
+    /// Entities with components stored this way are grouped into tables
+    /// by their exact component set. Multi-component for_each over these
+    /// Components walks the matching tables linearly.
+    template <component_data... Components>
+    auto register_archetype_storages() -> auto& {
+        if(not _archetypes) {
+            _archetypes = {hold<archetype_registry<Entity>>};
+        }
+        (void)(...,
+               register_component_storage<archetype_cmp_storage, Components>(
+                 _archetypes));
+        return *this;
+    }
+
     /// @brief Registers the storage to be used to store instances of Relation type.
     /// @see unregister_relation_type
     /// @see knows_relation_type
@@ -185,6 +275,7 @@ public:
     /// @see unregister_relation_type
     template <component_data Component>
     auto unregister_component_type() -> auto& {
+        _index_storage(component_index<Component>(), nullptr);
         _do_unr_stg_type<data_kind::component>(
           Component::uid(), _cmp_name_getter<Component>());
         return *this;
@@ -196,6 +287,7 @@ public:
     /// @see unregister_component_type
     template <relation_data Relation>
     auto unregister_relation_type() -> auto& {
+        _index_rel_storage(component_index<Relation>(), nullptr);
         _do_unr_stg_type<data_kind::relation>(
           Relation::uid(), _cmp_name_getter<Relation>());
         return *this;
@@ -237,7 +329,7 @@ public:
     /// @see knows_relation_type
     template <relation_data Relation>
     [[nodiscard]] auto relation_storage_caps() const -> storage_caps {
-        return _get_stg_type_caps<true>(
+        return _get_stg_type_caps<data_kind::relation>(
           Relation::uid(), _cmp_name_getter<Relation>());
     }
 
@@ -248,7 +340,7 @@ public:
     template <component_data Component>
     [[nodiscard]] auto component_storage_can(const storage_cap_bit cap) const
       -> bool {
-        return _get_stg_type_caps<false>(
+        return _get_stg_type_caps<data_kind::component>(
                  Component::uid(), _cmp_name_getter<Component>())
           .has(cap);
     }
@@ -260,7 +352,7 @@ public:
     template <relation_data Relation>
     [[nodiscard]] auto relation_storage_can(const storage_cap_bit cap) const
       -> bool {
-        return _get_stg_type_caps<true>(
+        return _get_stg_type_caps<data_kind::relation>(
                  Relation::uid(), _cmp_name_getter<Relation>())
           .has(cap);
     }
@@ -272,9 +364,213 @@ public:
     /// @see spawn
     auto knows(entity_param ent) noexcept -> bool;
 
+    /// @brief Starts keeping per-entity signatures of the stored components.
+    /// @see entity_signatures
+    /// @see has_all
+    /// @see knows
+    /// @see forget
+    ///
+    /// With signatures has_all, knows and forget look up a single bitset
+    /// instead of querying each of the registered component storages.
+    /// The signatures of the already stored components are built from
+    /// the registered storages.
+    auto use_signatures() -> auto& {
+        if(not _signatures) {
+            _signatures = {hold<entity_signatures<Entity>>};
+            _add_observer(*_signatures);
+            _fill_signatures();
+        }
+        return *this;
+    }
+
+    /// @brief Indicates if per-entity component signatures are kept.
+    /// @see use_signatures
+    [[nodiscard]] auto uses_signatures() const noexcept -> bool {
+        return bool(_signatures);
+    }
+
+    /// @brief Starts recording the ticks at which components are changed.
+    /// @see change_tracker
+    /// @see change_tick
+    /// @see mark_changed
+    /// @see for_each_changed_since
+    ///
+    /// Stored and shown components are recorded as changed, as are
+    /// components accessed through non-const manipulators, for example
+    /// by write_each or for_each_with. Relations accessed through non-const
+    /// manipulators are recorded with their subject. Earlier changes are
+    /// not recorded.
+    auto track_changes() -> auto& {
+        if(not _changes) {
+            _changes = {hold<change_tracker<Entity>>};
+            _add_observer(*_changes);
+            for(std::size_t i = 0; i < _indexed_storages.size(); ++i) {
+                if(_indexed_storages[i]) {
+                    _changes->track(i, data_kind::component);
+                }
+            }
+            for(std::size_t i = 0; i < _indexed_rel_storages.size(); ++i) {
+                if(_indexed_rel_storages[i]) {
+                    _changes->track(i, data_kind::relation);
+                }
+            }
+        }
+        return *this;
+    }
+
+    /// @brief Indicates if the ticks of component changes are recorded.
+    /// @see track_changes
+    [[nodiscard]] auto tracks_changes() const noexcept -> bool {
+        return bool(_changes);
+    }
+
+    /// @brief Returns the tick recorded with the changes done now.
+    /// @see advance_change_tick
+    /// @see for_each_changed_since
+    [[nodiscard]] auto change_tick() const noexcept -> change_tick_t {
+        return _changes ? _changes->tick() : change_tick_t{0U};
+    }
+
+    /// @brief Increments the current change tick and returns the new value.
+    /// @see change_tick
+    ///
+    /// Typically a consumer of changes passes the tick returned by this
+    /// function, after it processed the changes, to the next call of
+    /// for_each_changed_since.
+    auto advance_change_tick() noexcept -> change_tick_t {
+        return _changes ? _changes->advance() : change_tick_t{0U};
+    }
+
+    /// @brief Records that the Component of the entity changed at current tick.
+    /// @see track_changes
+    template <component_data Component>
+    auto mark_changed(entity_param ent) -> auto& {
+        if(_changes) {
+            _changes->record(component_index<Component>(), ent);
+        }
+        return *this;
+    }
+
+    /// @brief Calls function on each Component changed at or after tick.
+    /// @see track_changes
+    /// @see advance_change_tick
+    ///
+    /// The entities are visited in ascending order. Hidden and removed
+    /// components are skipped. If changes are not tracked then all
+    /// instances of Component are considered to be changed.
+    /// Modifications done by the function are not recorded as new changes.
+    template <component_data Component, typename Function>
+        requires(Component::is_component())
+    auto for_each_changed_since(change_tick_t tick, Function&& function)
+      -> auto& {
+        const callable_ref<void(entity_param, manipulator<Component>&)> func{
+          construct_from, function};
+        if(_changes) {
+            using C = std::remove_const_t<Component>;
+            const auto changed{
+              _changes->changed_since(component_index<C>(), tick)};
+            const auto suppressed{_changes->suppress(component_index<C>())};
+            if(changed) {
+                _apply_on_stg<C, data_kind::component>(
+                  [&](auto& c_storage) -> tribool {
+                      for(const auto& e : *changed) {
+                          c_storage->for_single(func, e);
+                      }
+                      return true;
+                  })
+                  .or_false();
+            } else {
+                for_each<Component>(func);
+            }
+        } else {
+            for_each<Component>(func);
+        }
+        return *this;
+    }
+
+    /// @brief Calls function on each Relation of subjects changed since tick.
+    /// @see track_changes
+    /// @see advance_change_tick
+    ///
+    /// Visits all relations of the subjects which had some Relation modified
+    /// at or after tick. If changes are not tracked then all relations are
+    /// visited. Modifications done by the function are not recorded.
+    template <relation_data Relation, typename Function>
+        requires(Relation::is_relation())
+    auto for_each_changed_since(change_tick_t tick, Function&& function)
+      -> auto& {
+        const callable_ref<
+          void(entity_param, entity_param, manipulator<Relation>&)>
+          func{construct_from, function};
+        if(_changes) {
+            using R = std::remove_const_t<Relation>;
+            const auto changed{
+              _changes->changed_since(component_index<R>(), tick)};
+            const auto suppressed{_changes->suppress(component_index<R>())};
+            if(changed) {
+                _apply_on_stg<R, data_kind::relation>(
+                  [&](auto& r_storage) -> tribool {
+                      for(const auto& s : *changed) {
+                          r_storage->for_each(func, s);
+                      }
+                      return true;
+                  })
+                  .or_false();
+            } else {
+                _call_for_each_r<Relation>(func);
+            }
+        } else {
+            _call_for_each_r<Relation>(func);
+        }
+        return *this;
+    }
+
+    /// @brief Returns the signals emitted when instances of Component change.
+    /// @see basic_component_signals
+    /// @see flush_component_signals
+    ///
+    /// The signals are emitted for changes done after the first call.
+    /// Unlike entity_spawned and entity_forgotten, these signals can be
+    /// switched to batched mode, delivering spans of entities on flush.
+    template <component_data Component>
+    auto component_signals() -> basic_component_signals<Entity>& {
+        if(not _cmp_signals) {
+            _cmp_signals = {hold<component_signal_dispatcher<Entity>>};
+            _add_observer(*_cmp_signals);
+        }
+        return _cmp_signals->signals(
+          component_index<std::remove_const_t<Component>>());
+    }
+
+    /// @brief Delivers the changes recorded by batched component signals.
+    /// @see component_signals
+    auto flush_component_signals() noexcept -> auto& {
+        if(_cmp_signals) {
+            _cmp_signals->flush();
+        }
+        return *this;
+    }
+
+    /// @brief Indicates if the entity was spawned and not forgotten since.
+    /// @see spawn
+    /// @see forget
+    ///
+    /// Returns indeterminate if the entity allocator does not track entities.
+    [[nodiscard]] auto is_alive(entity_param ent) const noexcept -> tribool {
+        return _entities.is_alive(ent);
+    }
+
     /// @brief Creates a new entity that is not yet known to this manager
     /// @see knows
     /// @see forget
+    /// @see is_alive
+    /// @see entity_traits
+    ///
+    /// The entity is created by the allocator specified in entity_traits.
+    /// Allocators of integral entities recycle forgotten entities with
+    /// a new generation in constant time, without checking the storages.
+    /// Only entities with a new index are checked, so that entities
+    /// explicitly chosen before they were spawned are skipped.
     auto spawn() noexcept -> Entity;
 
     /// @brief Removes all information, including components, about the
@@ -290,6 +586,10 @@ public:
     /// @see forget
     template <component_data Component>
     [[nodiscard]] auto has(entity_param ent) noexcept -> bool {
+        if(_signatures) {
+            return _signatures->has_all(
+              ent, std::array{component_index<Component>()});
+        }
         return _does_have_c(
           ent, Component::uid(), _cmp_name_getter<Component>());
     }
@@ -310,6 +610,10 @@ public:
     /// @see forget
     template <component_data... Components>
     [[nodiscard]] auto has_all(entity_param ent) -> bool {
+        if(_signatures) {
+            return _signatures->has_all(
+              ent, std::array{component_index<Components>()...});
+        }
         return (
           ... and
           _does_have_c(ent, Components::uid(), _cmp_name_getter<Components>()));
@@ -352,12 +656,46 @@ public:
         return *this;
     }
 
+    /// @brief Adds the components to the corresponding entities, in one batch.
+    /// @see add
+    ///
+    /// The components are moved from. The result is the same as adding
+    /// the components one by one, but storages like flat_map_cmp_storage
+    /// sort the batch and merge it into the stored components in one pass.
+    template <component_data Component>
+    auto add_bulk(
+      std::span<const Entity> entities,
+      std::span<Component> components) -> auto& {
+        assert(entities.size() == components.size());
+        _apply_on_stg<Component, data_kind::component>(
+          [&](auto& c_storage) -> tribool {
+              c_storage->store_bulk(entities, components);
+              return true;
+          });
+        return *this;
+    }
+
     template <component_data Component>
     auto ensure(entity_param ent, std::type_identity<Component> = {})
       -> manipulator<Component> {
         return {_do_add_c(ent, Component{}), false};
     }
 
+    /// @brief Ensures that the entity with the specified key has Component.
+    /// @see hash_map_cmp_storage
+    ///
+    /// If the storage registered for Component is a Storage<Entity, Component>
+    /// that can look up entities by Key, like hash_map_cmp_storage can find
+    /// std::string entities by std::string_view, the entity is constructed
+    /// only if the component is added. Otherwise it is constructed from key.
+    template <
+      template <class, class> class Storage,
+      component_data Component,
+      typename Key>
+    auto ensure(const Key& key) -> manipulator<Component> {
+        return {_do_ensure_c<Storage, Component>(key), false};
+    }
+
     template <relation_data Relation>
     auto add(entity_param subject, entity_param object, Relation&& rel)
       -> manipulator<Relation> {
@@ -498,6 +836,34 @@ public:
             construct_from, std::forward<Function>(function)});
     }
 
+    /// @brief Calls function on each Component in statically known Storage.
+    /// @see write_each
+    /// @see register_component_storage
+    ///
+    /// If the storage registered for Component is a Storage<Entity, Component>
+    /// the function is called directly by the storage loop and can be inlined.
+    /// Otherwise this falls back to the type-erased for_each.
+    template <
+      template <class, class> class Storage,
+      component_data Component,
+      typename Function>
+    auto read_each(Function&& function) -> auto& {
+        _call_for_each_c_direct<Storage, const Component>(function);
+        return *this;
+    }
+
+    /// @brief Calls function on each Component in statically known Storage.
+    /// @see read_each
+    /// @see register_component_storage
+    template <
+      template <class, class> class Storage,
+      component_data Component,
+      typename Function>
+    auto write_each(Function&& function) -> auto& {
+        _call_for_each_c_direct<Storage, Component>(function);
+        return *this;
+    }
+
     template <relation_data Relation>
     auto for_each_having(
       const callable_ref<void(entity_param, entity_param)>& func) -> auto& {
@@ -505,6 +871,43 @@ public:
         return *this;
     }
 
+    /// @brief Calls func with each object with which the subject has Relation.
+    /// @see for_each_subject_of
+    ///
+    /// The function gets the subject and the object.
+    template <relation_data Relation>
+    auto for_each_object_of(
+      entity_param subject,
+      const callable_ref<void(entity_param, entity_param)>& func) -> auto& {
+        _apply_on_stg<Relation, data_kind::relation>(
+          [&](auto& r_storage) -> tribool {
+              r_storage->for_each(func, subject);
+              return true;
+          })
+          .or_false();
+        return *this;
+    }
+
+    /// @brief Calls func with each subject having Relation with the object.
+    /// @see flat_map_indexed_rel_storage
+    /// @see for_each_object_of
+    /// @see is
+    ///
+    /// The function gets the subject and the object. Relation storages with
+    /// a reverse index find the subjects without scanning all relations.
+    template <relation_data Relation>
+    auto for_each_subject_of(
+      entity_param object,
+      const callable_ref<void(entity_param, entity_param)>& func) -> auto& {
+        _apply_on_stg<Relation, data_kind::relation>(
+          [&](auto& r_storage) -> tribool {
+              r_storage->for_each_subject_of(func, object);
+              return true;
+          })
+          .or_false();
+        return *this;
+    }
+
     template <relation_data Relation>
     auto for_each(
       const callable_ref<
@@ -555,15 +958,196 @@ public:
             construct_from, func});
     }
 
+    /// @brief Calls function on contiguous blocks of the specified Components.
+    /// @see for_each_with
+    ///
+    /// The function gets a span of entities and for each of Components a span
+    /// of the same length, with the components of these entities.
+    /// Storages keeping components contiguously hand out their memory directly,
+    /// others pass staged copies or single-element blocks. Trivially copyable
+    /// components joined from several storages, other than archetype tables,
+    /// are staged in blocks too. Components cannot be removed during a batch
+    /// pass.
+    template <component_data... Components, typename Function>
+    auto for_each_batch(Function&& function) -> auto& {
+        _call_for_each_batch<Components...>(
+          callable_ref<void(std::span<const Entity>, std::span<Components>...)>{
+            construct_from, function});
+        return *this;
+    }
+
+    /// @brief Swaps the current and next buffers of all double-buffered storages.
+    /// @see double_buffer_cmp_storage
+    /// @see storage_caps::can_swap_buffers
+    auto swap_buffers() -> auto& {
+        for(auto& entry : _cmp_storages) {
+            auto& storage{std::get<1>(entry)};
+            if(storage and storage->capabilities().can_swap_buffers()) {
+                storage->swap_buffers();
+            }
+        }
+        for(auto& entry : _views) {
+            std::get<1>(entry)->invalidate();
+        }
+        return *this;
+    }
+
+    /// @brief Indicates if Component instances are stored in archetype tables.
+    /// @see register_archetype_storages
+    ///
+    /// Components in archetype tables share one store, so removals through
+    /// one of them move rows in the tables of the others.
+    template <component_data Component>
+    [[nodiscard]] auto uses_archetype_storage() noexcept -> bool {
+        return _archetypes and knows_component_type<Component>() and
+               _is_archetype_stg<Component>();
+    }
+
+    /// @brief Sets the pool of threads used by the parallel passes.
+    /// @see workers
+    /// @see parallel_for_each
+    auto use_workers(shared_holder<worker_pool> pool) noexcept -> auto& {
+        _workers = std::move(pool);
+        return *this;
+    }
+
+    /// @brief Returns the pool of threads used by the parallel passes.
+    /// @see use_workers
+    ///
+    /// If no pool was set, one using all hardware threads is created.
+    auto workers() -> worker_pool& {
+        if(not _workers) {
+            _workers = {hold<worker_pool>};
+        }
+        return *_workers;
+    }
+
+    /// @brief Calls function on each entity having all Components, in parallel.
+    /// @see for_each_with
+    /// @see parallel_read_each
+    /// @see parallel_write_each
+    ///
+    /// The entities are split into blocks processed concurrently by workers().
+    /// Storages keeping the components in arrays are split directly, archetype
+    /// tables are split by tables, the components of other storages and of
+    /// the other joins are gathered first. The function must only access
+    /// the components passed to it.
+    /// Removals requested through the manipulators are applied after all
+    /// blocks are done, in the order in which for_each_with would apply them.
+    template <component_data... Components, typename Function>
+    auto parallel_for_each(Function&& function) -> auto& {
+        _call_parallel_for_each<Components...>(
+          callable_ref<void(entity_param, manipulator<Components>&...)>{
+            construct_from, function});
+        return *this;
+    }
+
+    /// @brief Calls function on each Component for reading, in parallel.
+    /// @see parallel_for_each
+    template <component_data Component, typename Function>
+    auto parallel_read_each(Function&& function) -> auto& {
+        return parallel_for_each<const Component>(function);
+    }
+
+    /// @brief Calls function on each Component for writing, in parallel.
+    /// @see parallel_for_each
+    template <component_data Component, typename Function>
+    auto parallel_write_each(Function&& function) -> auto& {
+        return parallel_for_each<Component>(function);
+    }
+
+    /// @brief Applies the changes recorded in a command buffer and clears it.
+    /// @see command_buffer
+    ///
+    /// Typically used after iterating the components or after a parallel
+    /// pass, where each worker thread recorded changes into its own buffer.
+    auto apply(command_buffer<Entity>& commands) -> auto& {
+        commands.replay(
+          [this]() { return spawn(); },
+          [this](entity_param ent) { forget(ent); },
+          [this](identifier_t cid) {
+              return _get_base_stg<data_kind::component>(cid);
+          },
+          [this](identifier_t cid) {
+              return _get_base_stg<data_kind::relation>(cid);
+          });
+        return *this;
+    }
+
+    /// @brief Applies the changes recorded in multiple command buffers.
+    /// @see command_buffer
+    ///
+    /// The buffers are applied in the order in which they are specified.
+    auto apply(std::span<command_buffer<Entity>> buffers) -> auto& {
+        for(auto& commands : buffers) {
+            apply(commands);
+        }
+        return *this;
+    }
+
+    /// @brief Saves the entities, components and relations into a snapshot.
+    /// @see load_snapshot
+    /// @see snapshot_header
+    /// @see snapshot_data
+    ///
+    /// Each storage is saved in a separate section, with the entities sorted
+    /// and with trivially copyable data saved as aligned arrays. Hidden
+    /// components are saved after the visible ones and are hidden again when
+    /// loaded. The storages of types that are not snapshot_data are not saved.
+    /// Returns false if the snapshot could not be written.
+    auto save_snapshot(std::ostream& output) -> bool;
+
+    /// @brief Loads a snapshot written by save_snapshot.
+    /// @see save_snapshot
+    ///
+    /// The components and relations are stored into the registered storages,
+    /// in ascending order of the entities. Sections of unregistered types
+    /// are skipped. The state of the entity allocator is restored, so that
+    /// spawn does not return the loaded entities. Returns false if
+    /// the snapshot is not compatible, if the layout of some saved type
+    /// differs from the registered one or if its data are not valid.
+    ///
+    /// The storages are not cleared before loading: the loaded components
+    /// replace the stored ones of the same entities and the components
+    /// of other entities are kept. Load into an empty manager, or call clear
+    /// and register the storages again, to get exactly the saved state.
+    /// The section data are read in bounded chunks, so a truncated stream
+    /// fails without allocating the whole declared size.
+    auto load_snapshot(std::istream& input) -> bool;
+
     template <component_data... Components>
     [[nodiscard]] auto select()
       -> component_relation<Entity, mp_list<mp_list<Components...>>> {
         return {*this};
     }
 
+    /// @brief Returns a cached view of the entities having all Components.
+    /// @see basic_view
+    /// @see for_each_with
+    ///
+    /// The first call creates the cache, which is then kept up to date
+    /// by the component storages. Later calls with the same set of
+    /// component types, in any order or constness, share the cache.
+    template <component_data... Components>
+    [[nodiscard]] auto view() -> basic_view<Entity, Components...> {
+        return {*this, _get_view<std::remove_const_t<Components>...>()};
+    }
+
     auto clear() noexcept -> basic_manager& {
+        _indexed_storages.clear();
         _cmp_storages.clear();
+        if(_signatures) {
+            _signatures->clear();
+        }
+        if(_changes) {
+            _changes->clear();
+        }
+        for(auto& entry : _views) {
+            std::get<1>(entry)->invalidate();
+        }
+        _indexed_rel_storages.clear();
         _rel_storages.clear();
+        _archetypes = {};
         return *this;
     }
 
@@ -571,10 +1155,141 @@ private:
     using _base_cmp_storage_t = base_component_storage<Entity>;
     using _base_cmp_storage_ptr_t = shared_holder<_base_cmp_storage_t>;
 
-    Entity _entity_sequence{entity_traits<Entity>::first()};
+    typename entity_traits<Entity>::allocator_type _entities{};
+
+    // declared before the storages, which notify them until destroyed
+    storage_observer_list<Entity> _observers{};
+    shared_holder<entity_signatures<Entity>> _signatures{};
+    shared_holder<change_tracker<Entity>> _changes{};
+    shared_holder<component_signal_dispatcher<Entity>> _cmp_signals{};
+    flat_map<std::vector<std::size_t>, unique_holder<entity_view<Entity>>>
+      _views{};
 
     component_uid_map<_base_cmp_storage_ptr_t> _cmp_storages{};
 
+    // component storages indexed by component_index
+    std::vector<_base_cmp_storage_t*> _indexed_storages{};
+
+    void _index_storage(std::size_t index, _base_cmp_storage_t* storage) {
+        if(_indexed_storages.size() <= index) {
+            _indexed_storages.resize(index + 1U, nullptr);
+        }
+        if(not _observers.empty()) {
+            if(auto prev{_indexed_storages[index]}) {
+                prev->set_observer(nullptr, index);
+                if(_signatures) {
+                    _signatures->clear_bit(index);
+                }
+                if(_changes) {
+                    _changes->clear(index);
+                }
+            }
+            if(storage) {
+                storage->set_observer(&_observers, index);
+                if(_changes) {
+                    _changes->track(index, data_kind::component);
+                }
+            }
+        }
+        for(auto& entry : _views) {
+            if(std::get<1>(entry)->observes(index)) {
+                std::get<1>(entry)->invalidate();
+            }
+        }
+        _indexed_storages[index] = storage;
+    }
+
+    void _fill_signatures() {
+        assert(_signatures);
+        for(std::size_t i = 0; i < _indexed_storages.size(); ++i) {
+            if(auto storage{_indexed_storages[i]}) {
+                auto iter{storage->new_iterator(storage_buffer::read)};
+                for(; not iter.done(); iter.next()) {
+                    if(storage->is_hidden(iter)) {
+                        _signatures->on_hidden(i, iter.current());
+                    } else {
+                        _signatures->on_stored(i, iter.current());
+                    }
+                }
+                storage->delete_iterator(std::move(iter));
+            }
+        }
+    }
+
+    void _add_observer(storage_observer<Entity>& observer) {
+        if(_observers.empty()) {
+            for(std::size_t i = 0; i < _indexed_storages.size(); ++i) {
+                if(_indexed_storages[i]) {
+                    _indexed_storages[i]->set_observer(&_observers, i);
+                }
+            }
+            for(std::size_t i = 0; i < _indexed_rel_storages.size(); ++i) {
+                if(_indexed_rel_storages[i]) {
+                    _indexed_rel_storages[i]->set_observer(&_observers, i);
+                }
+            }
+        }
+        _observers.add(observer);
+    }
+
+    template <typename... Components>
+    auto _get_view() -> entity_view<Entity>& {
+        std::vector<std::size_t> indices{component_index<Components>()...};
+        std::sort(indices.begin(), indices.end());
+        indices.erase(
+          std::unique(indices.begin(), indices.end()), indices.end());
+        auto pos{_views.find(indices)};
+        if(pos == _views.end()) {
+            unique_holder<entity_view<Entity>> cache{
+              hold<entity_view<Entity>>, indices};
+            _add_observer(*cache);
+            pos = _views.emplace(std::move(indices), std::move(cache)).first;
+        }
+        return *pos->second;
+    }
+
+    template <typename... Components>
+    void _refresh_view(entity_view<Entity>& cache) {
+        if(not(... and knows_component_type<Components>())) {
+            cache.assign({}, false);
+            cache.invalidate();
+        } else if(not cache.needs_rebuild()) {
+            cache.refresh([this](entity_param e) {
+                if(_signatures) {
+                    return _signatures->has_all(
+                      e, std::array{component_index<Components>()...});
+                }
+                return (
+                  ... and
+                  _has_visible(_find_cmp_storage<Components>(), e));
+            });
+        } else {
+            std::vector<Entity> entities;
+            const auto gather{
+              [&](entity_param e, manipulator<const Components>&...) {
+                  entities.push_back(e);
+              }};
+            const callable_ref<void(
+              entity_param, manipulator<const Components>&...)>
+              gather_ref{construct_from, gather};
+            if constexpr(sizeof...(Components) == 1) {
+                _call_for_each_c<const Components...>(gather_ref);
+            } else {
+                _call_for_each_c_m_r<const Components...>(gather_ref);
+            }
+            cache.assign(
+              std::move(entities), (... or _is_table_stg<Components>()));
+        }
+    }
+
+    template <typename Storage>
+    static auto _has_visible(Storage& storage, entity_param e) -> bool {
+        return storage.has(e) and not storage.is_hidden(e);
+    }
+
+    template <typename, typename...>
+    friend class basic_view;
+
     auto _get_storages(
       std::integral_constant<data_kind, data_kind::component>) noexcept
       -> auto& {
@@ -591,6 +1306,30 @@ private:
 
     component_uid_map<_base_rel_storage_ptr_t> _rel_storages{};
 
+    // relation storages indexed by component_index
+    std::vector<_base_rel_storage_t*> _indexed_rel_storages{};
+
+    void _index_rel_storage(std::size_t index, _base_rel_storage_t* storage) {
+        if(_indexed_rel_storages.size() <= index) {
+            _indexed_rel_storages.resize(index + 1U, nullptr);
+        }
+        if(not _observers.empty()) {
+            if(auto prev{_indexed_rel_storages[index]}) {
+                prev->set_observer(nullptr, index);
+                if(_changes) {
+                    _changes->clear(index);
+                }
+            }
+            if(storage) {
+                storage->set_observer(&_observers, index);
+                if(_changes) {
+                    _changes->track(index, data_kind::relation);
+                }
+            }
+        }
+        _indexed_rel_storages[index] = storage;
+    }
+
     auto _get_storages(
       std::integral_constant<data_kind, data_kind::relation>) noexcept
       -> auto& {
@@ -602,6 +1341,9 @@ private:
         return _rel_storages;
     }
 
+    shared_holder<archetype_registry<Entity>> _archetypes{};
+    shared_holder<worker_pool> _workers{};
+
     template <data_kind kind>
     auto _get_storages() noexcept -> auto& {
         return _get_storages(std::integral_constant<data_kind, kind>());
@@ -657,6 +1399,15 @@ private:
         return _get_storages<kind>().find(cid).has_value();
     }
 
+    template <data_kind kind>
+    auto _get_base_stg(identifier_t cid) noexcept
+      -> base_storage<Entity, kind>* {
+        if(const auto found{_get_storages<kind>().find(cid)}) {
+            return found->get();
+        }
+        return nullptr;
+    }
+
     template <data_kind, typename Func>
     auto _apply_on_base_stg(
       const Func&,
@@ -696,6 +1447,12 @@ private:
     auto _do_add_c(entity_param, Component&& component)
       -> optional_reference<Component>;
 
+    template <
+      template <class, class> class Storage,
+      typename Component,
+      typename Key>
+    auto _do_ensure_c(const Key&) -> optional_reference<Component>;
+
     template <typename Relation>
     auto _do_add_r(entity_param, entity_param, Relation&& relation)
       -> optional_reference<Relation>;
@@ -748,6 +1505,39 @@ private:
     template <typename C, typename Func>
     void _call_for_each_c(const Func&);
 
+    template <
+      template <class, class> class Storage,
+      typename C,
+      typename Func>
+    void _call_for_each_c_direct(Func&);
+
+    template <typename... C, typename Func>
+    void _call_for_each_batch(const Func&);
+
+    template <typename... C, typename Func, std::size_t... I>
+    void _staged_batches(const Func&, std::index_sequence<I...>);
+
+    template <typename C>
+    static auto _batch_of(manipulator<C>&) noexcept -> std::span<C>;
+
+    template <typename... C, typename Func>
+    void _call_parallel_for_each(const Func&);
+
+    template <typename... C, typename Func, std::size_t... I>
+    static void _parallel_block(
+      const Func&,
+      std::span<const std::tuple<Entity, C*...>>,
+      std::array<std::vector<Entity>, sizeof...(C)>&,
+      std::index_sequence<I...>);
+
+    template <typename... C, typename Func, std::size_t... I>
+    static void _parallel_run(
+      const Func&,
+      std::span<const Entity>,
+      const std::tuple<std::span<C>...>&,
+      std::array<std::vector<Entity>, sizeof...(C)>&,
+      std::index_sequence<I...>);
+
     template <typename R, typename Func>
     void _call_for_each_r(const Func&);
 
@@ -757,6 +1547,45 @@ private:
     template <typename... C, typename Func>
     void _call_for_each_c_m_r(const Func&);
 
+    template <typename... C, typename Func>
+    void _call_for_each_c_m_v(std::span<const Entity>, const Func&);
+
+    template <typename... C, typename Func>
+    void _call_for_each_c_m_v(
+      entity_view<Entity>&,
+      std::span<const Entity>,
+      const Func&);
+
+    template <typename C>
+    void _view_row_done(
+      const concrete_manipulator<C>& m,
+      std::vector<Entity>& removed,
+      entity_param e);
+
+    template <typename... C, typename Func, std::size_t... I>
+    void _view_rows_pass(
+      const Func&,
+      entity_view<Entity>&,
+      std::span<const Entity>,
+      std::span<void* const>,
+      const std::array<std::size_t, sizeof...(C)>&,
+      std::index_sequence<I...>);
+
+    template <typename... C>
+    auto _has_unordered_stg() noexcept -> bool;
+
+    template <typename... C>
+    auto _unordered_join(bool all) -> std::vector<Entity>;
+
+    template <typename C>
+    auto _is_archetype_stg() noexcept -> bool;
+
+    template <typename C>
+    auto _is_table_stg() noexcept -> bool;
+
+    template <typename... C>
+    auto _common_archetypes() noexcept -> archetype_registry<Entity>*;
+
     template <typename T, typename C>
     auto _do_get_c(T C::*const, entity_param, T) -> T;
 };
@@ -902,6 +1731,30 @@ auto basic_manager<Entity>::_do_add_c(
 }
 //------------------------------------------------------------------------------
 template <typename Entity>
+template <
+  template <class, class> class Storage,
+  typename Component,
+  typename Key>
+auto basic_manager<Entity>::_do_ensure_c(const Key& key)
+  -> optional_reference<Component> {
+    return _apply_on_base_stg<data_kind::component>(
+      [&key](auto& b_storage) -> optional_reference<Component> {
+          using S = Storage<Entity, Component>;
+          if constexpr(requires(S& s) { s.ensure(key); }) {
+              if(const auto ct_storage{dynamic_cast<S*>(b_storage.get())}) {
+                  return ct_storage->ensure(key);
+              }
+          }
+          using B = component_storage<Entity, Component>;
+          B* c_storage = dynamic_cast<B*>(b_storage.get());
+          assert(c_storage);
+          return c_storage->store(Entity(key), Component{});
+      },
+      Component::uid(),
+      _cmp_name_getter<Component>());
+}
+//------------------------------------------------------------------------------
+template <typename Entity>
 template <typename Relation>
 auto basic_manager<Entity>::_do_add_r(
   entity_param subj,
@@ -1065,6 +1918,294 @@ void basic_manager<Entity>::_call_for_each_c(const Func& func) {
 }
 //------------------------------------------------------------------------------
 template <typename Entity>
+template <
+  template <class, class> class Storage,
+  typename Component,
+  typename Func>
+void basic_manager<Entity>::_call_for_each_c_direct(Func& func) {
+    using C = std::remove_const_t<Component>;
+    _apply_on_base_stg<data_kind::component>(
+      [&func](auto& b_storage) -> tribool {
+          using S = Storage<Entity, C>;
+          if(const auto ct_storage{dynamic_cast<S*>(b_storage.get())}) {
+              ct_storage->template for_each_direct<Component>(func);
+          } else {
+              using B = component_storage<Entity, C>;
+              B* c_storage = dynamic_cast<B*>(b_storage.get());
+              assert(c_storage);
+              c_storage->for_each(
+                callable_ref<void(entity_param, manipulator<Component>&)>{
+                  construct_from, func});
+          }
+          return true;
+      },
+      C::uid(),
+      _cmp_name_getter<C>());
+}
+//------------------------------------------------------------------------------
+template <typename Entity>
+template <typename... Component, typename Func>
+void basic_manager<Entity>::_call_for_each_batch(const Func& func) {
+    if constexpr(sizeof...(Component) == 1) {
+        _apply_on_stg<std::remove_const_t<Component>..., data_kind::component>(
+          [&func](auto& c_storage) -> tribool {
+              c_storage->for_each_batch(func);
+              return true;
+          });
+    } else {
+        if(const auto archetypes{
+             _common_archetypes<std::remove_const_t<Component>...>()}) {
+            archetypes->template for_each_batch<Component...>(func);
+            return;
+        }
+        constexpr const bool copyable{
+          (... and std::is_trivially_copyable_v<_bare_t<Component>>)};
+        if constexpr(copyable) {
+            _staged_batches<Component...>(
+              func, std::index_sequence_for<Component...>{});
+        } else {
+            const auto wrap{
+              [&func](entity_param e, manipulator<Component>&... m) {
+                  const Entity ent{e};
+                  func(std::span<const Entity>{&ent, 1U}, _batch_of(m)...);
+              }};
+            _call_for_each_c_m_r<Component...>(
+              callable_ref<void(entity_param, manipulator<Component>&...)>{
+                construct_from, wrap});
+        }
+    }
+}
+//------------------------------------------------------------------------------
+// The addresses of the components of the joined entities are gathered
+// in blocks of about one memory page. The components are copied into arrays
+// passed to the function and the written ones are copied back, before
+// the join continues.
+template <typename Entity>
+template <typename... Component, typename Func, std::size_t... I>
+void basic_manager<Entity>::_staged_batches(
+  const Func& func,
+  std::index_sequence<I...>) {
+    const std::size_t batch_size{std::max<std::size_t>(
+      4096U / std::max({sizeof(_bare_t<Component>)...}), 1U)};
+    std::vector<Entity> entities;
+    std::tuple<std::vector<Component*>...> sources;
+    std::tuple<std::vector<_bare_t<Component>>...> staged;
+    entities.reserve(batch_size);
+    (..., std::get<I>(sources).reserve(batch_size));
+    (..., std::get<I>(staged).reserve(batch_size));
+
+    const auto stage{[](const auto& from, auto& to) {
+        to.clear();
+        for(const auto* ptr : from) {
+            to.push_back(*ptr);
+        }
+    }};
+    const auto write_back{[](const auto& to, const auto& from) {
+        using T = typename std::remove_cvref_t<decltype(to)>::value_type;
+        if constexpr(not std::is_const_v<std::remove_pointer_t<T>>) {
+            for(std::size_t i = 0; i < from.size(); ++i) {
+                *to[i] = from[i];
+            }
+        }
+    }};
+    const auto flush{[&] {
+        if(entities.empty()) {
+            return;
+        }
+        (..., stage(std::get<I>(sources), std::get<I>(staged)));
+        func(
+          std::span<const Entity>{entities},
+          std::span<Component>{std::get<I>(staged)}...);
+        (..., write_back(std::get<I>(sources), std::get<I>(staged)));
+        entities.clear();
+        (..., std::get<I>(sources).clear());
+    }};
+    const auto gather{[&](entity_param e, manipulator<Component>&... m) {
+        entities.push_back(e);
+        (..., std::get<I>(sources).push_back(_batch_of(m).data()));
+        if(entities.size() == batch_size) {
+            flush();
+        }
+    }};
+    _call_for_each_c_m_r<Component...>(
+      callable_ref<void(entity_param, manipulator<Component>&...)>{
+        construct_from, gather});
+    flush();
+}
+//------------------------------------------------------------------------------
+template <typename Entity>
+template <typename C>
+auto basic_manager<Entity>::_batch_of(manipulator<C>& m) noexcept
+  -> std::span<C> {
+    if constexpr(std::is_const_v<C>) {
+        return {&m.read(), 1U};
+    } else {
+        return {&m.write(), 1U};
+    }
+}
+//------------------------------------------------------------------------------
+// The storages keeping their components in arrays are split into blocks,
+// the archetype tables are visited one table per block. The components
+// in other storages are gathered first and the gathered rows are split.
+// The modifications are notified after all blocks are visited.
+template <typename Entity>
+template <typename... Component, typename Func>
+void basic_manager<Entity>::_call_parallel_for_each(const Func& func) {
+    auto& pool{workers()};
+    const auto block_size_for{[&pool](std::size_t size) {
+        return std::max<std::size_t>(size / (pool.thread_count() * 8U), 256U);
+    }};
+    const bool notify{
+      not _observers.empty() and (... or not std::is_const_v<Component>)};
+    std::vector<std::array<std::vector<Entity>, sizeof...(Component)>> removed;
+    std::vector<std::vector<Entity>> visited;
+    const auto run_blocks{[&](std::size_t block_count, const auto& visit) {
+        removed.resize(block_count);
+        visited.resize(notify ? block_count : 0U);
+        const auto process{[&](std::size_t b) {
+            visit(b, [&](std::span<const Entity> entities, auto... components) {
+                _parallel_run<Component...>(
+                  func,
+                  entities,
+                  std::tuple<std::span<Component>...>{components...},
+                  removed[b],
+                  std::index_sequence_for<Component...>{});
+                if(notify) {
+                    visited[b].insert(
+                      visited[b].end(), entities.begin(), entities.end());
+                }
+            });
+        }};
+        pool.for_each_index(
+          block_count,
+          callable_ref<void(std::size_t)>{construct_from, process});
+    }};
+
+    bool done{false};
+    if(const auto archetypes{_common_archetypes<_bare_t<Component>...>()}) {
+        run_blocks(archetypes->table_count(), [&](auto b, const auto& run) {
+            archetypes->template for_each_batch_in<Component...>(b, run);
+        });
+        done = true;
+    } else if constexpr(sizeof...(Component) == 1) {
+        done = _apply_on_stg<_bare_t<Component>..., data_kind::component>(
+                 [&](auto& c_storage) -> tribool {
+                     const auto size{block_size_for(c_storage->size())};
+                     const auto count{c_storage->block_count(size)};
+                     if(count == 0U) {
+                         return false;
+                     }
+                     run_blocks(count, [&](auto b, const auto& run) {
+                         c_storage->for_each_in_block(
+                           b,
+                           size,
+                           callable_ref<void(
+                             std::span<const Entity>,
+                             std::span<Component>...)>{construct_from, run});
+                     });
+                     return true;
+                 })
+                 .or_false();
+    }
+    if(not done) {
+        using row_t = std::tuple<Entity, Component*...>;
+        std::vector<row_t> rows;
+        const auto gather{
+          [&rows](entity_param e, manipulator<Component>&... m) {
+              rows.emplace_back(e, _batch_of(m).data()...);
+          }};
+        const callable_ref<void(entity_param, manipulator<Component>&...)>
+          gather_ref{construct_from, gather};
+        if constexpr(sizeof...(Component) == 1) {
+            _call_for_each_c<Component...>(gather_ref);
+        } else {
+            _call_for_each_c_m_r<Component...>(gather_ref);
+        }
+        // modifications are notified by the storages during the gathering
+        visited.clear();
+        const auto size{block_size_for(rows.size())};
+        removed.resize((rows.size() + size - 1U) / size);
+        const auto process{[&](std::size_t b) {
+            const auto first{b * size};
+            const auto count{std::min(size, rows.size() - first)};
+            _parallel_block<Component...>(
+              func,
+              std::span<const row_t>{rows.data() + first, count},
+              removed[b],
+              std::index_sequence_for<Component...>{});
+        }};
+        pool.for_each_index(
+          removed.size(),
+          callable_ref<void(std::size_t)>{construct_from, process});
+    }
+
+    const std::array<std::size_t, sizeof...(Component)> indices{
+      component_index<_bare_t<Component>>()...};
+    constexpr const std::array<bool, sizeof...(Component)> written{
+      not std::is_const_v<Component>...};
+    for(const auto& block : visited) {
+        for(std::size_t i = 0; i < indices.size(); ++i) {
+            if(written[i]) {
+                for(const auto& e : block) {
+                    _observers.on_modified(indices[i], e);
+                }
+            }
+        }
+    }
+
+    const std::array<identifier_t, sizeof...(Component)> cids{
+      _bare_t<Component>::uid()...};
+    const std::array<std::string (*)() noexcept, sizeof...(Component)> names{
+      _cmp_name_getter<_bare_t<Component>>()...};
+    for(auto& block : removed) {
+        for(std::size_t i = 0; i < cids.size(); ++i) {
+            for(const auto& e : block[i]) {
+                _do_rem_c(e, cids[i], names[i]);
+            }
+        }
+    }
+}
+//------------------------------------------------------------------------------
+template <typename Entity>
+template <typename... Component, typename Func, std::size_t... I>
+void basic_manager<Entity>::_parallel_block(
+  const Func& func,
+  std::span<const std::tuple<Entity, Component*...>> rows,
+  std::array<std::vector<Entity>, sizeof...(Component)>& removed,
+  std::index_sequence<I...>) {
+    for(const auto& row : rows) {
+        std::tuple<concrete_manipulator<Component>...> ms{
+          concrete_manipulator<Component>{
+            std::get<I + 1U>(row), true /*can_remove*/}...};
+        func(std::get<0>(row), std::get<I>(ms)...);
+        (...,
+         (std::get<I>(ms).remove_requested()
+            ? removed[I].push_back(std::get<0>(row))
+            : void()));
+    }
+}
+//------------------------------------------------------------------------------
+template <typename Entity>
+template <typename... Component, typename Func, std::size_t... I>
+void basic_manager<Entity>::_parallel_run(
+  const Func& func,
+  std::span<const Entity> entities,
+  const std::tuple<std::span<Component>...>& components,
+  std::array<std::vector<Entity>, sizeof...(Component)>& removed,
+  std::index_sequence<I...>) {
+    for(std::size_t r = 0; r < entities.size(); ++r) {
+        std::tuple<concrete_manipulator<Component>...> ms{
+          concrete_manipulator<Component>{
+            &std::get<I>(components)[r], true /*can_remove*/}...};
+        func(entities[r], std::get<I>(ms)...);
+        (...,
+         (std::get<I>(ms).remove_requested()
+            ? removed[I].push_back(entities[r])
+            : void()));
+    }
+}
+//------------------------------------------------------------------------------
+template <typename Entity>
 template <typename Relation, typename Func>
 void basic_manager<Entity>::_call_for_each_r(const Func& func) {
     _apply_on_stg<std::remove_const_t<Relation>, data_kind::relation>(
@@ -1075,14 +2216,50 @@ void basic_manager<Entity>::_call_for_each_r(const Func& func) {
       .or_false();
 }
 //------------------------------------------------------------------------------
+template <typename Entity, std::size_t N>
+class _manager_for_each_c_m_r_plan;
+//------------------------------------------------------------------------------
+template <typename Entity>
+class _manager_for_each_iter_base {
+protected:
+    component_storage_iterator<Entity> _iter;
+    Entity _curr;
+    std::size_t _size;
+
+    _manager_for_each_iter_base(
+      component_storage_iterator<Entity>&& iter,
+      std::size_t size) noexcept
+      : _iter{std::move(iter)}
+      , _curr{_iter.done() ? Entity() : _iter.current()}
+      , _size{size} {}
+
+    auto _done() -> bool {
+        return _iter.done();
+    }
+
+    auto _current() -> entity_param_t<Entity> {
+        return _curr;
+    }
+
+    auto _seek(entity_param_t<Entity> e) -> bool {
+        if(_iter.seek(e)) {
+            _curr = _iter.current();
+            return true;
+        }
+        return false;
+    }
+
+    template <typename, std::size_t>
+    friend class _manager_for_each_c_m_r_plan;
+};
+//------------------------------------------------------------------------------
 template <typename Entity, typename C>
-class _manager_for_each_c_m_base {
+class _manager_for_each_c_m_base : public _manager_for_each_iter_base<Entity> {
 private:
     component_storage<Entity, std::remove_const_t<C>>& _storage;
 
 protected:
-    component_storage_iterator<Entity> _iter;
-    Entity _curr;
+    using _manager_for_each_iter_base<Entity>::_iter;
 
     static constexpr auto _storage_buffer() noexcept {
         return storage_buffer_from_constness(std::is_const_v<C>);
@@ -1090,9 +2267,10 @@ protected:
 
     _manager_for_each_c_m_base(
       component_storage<Entity, std::remove_const_t<C>>& strg)
-      : _storage(strg)
-      , _iter(_storage.new_iterator(_storage_buffer()))
-      , _curr(_iter.done() ? Entity() : _iter.current()) {
+      : _manager_for_each_iter_base<Entity>{
+          strg.new_iterator(_storage_buffer()),
+          strg.size()}
+      , _storage(strg) {
         assert(std::is_const<C>::value or _storage.capabilities().can_modify());
     }
 
@@ -1100,14 +2278,6 @@ protected:
         _storage.delete_iterator(std::move(_iter));
     }
 
-    auto _done() -> bool {
-        return _iter.done();
-    }
-
-    auto _current() -> entity_param_t<Entity> {
-        return _curr;
-    }
-
     void _apply(
       const callable_ref<void(entity_param_t<Entity>, manipulator<C>&)>& func) {
         _storage.for_single(func, _iter);
@@ -1180,6 +2350,10 @@ public:
         return this->_current();
     }
 
+    void seek(entity_param_t<Entity> m) {
+        this->_seek(m);
+    }
+
     void apply(entity_param_t<Entity> m, manipulator<CL>&... clm) {
         if(this->_done() or (m < this->_current())) {
             std::remove_const_t<C> cadd;
@@ -1245,6 +2419,11 @@ public:
         next_if_min(min_entity());
     }
 
+    void seek(entity_param_t<Entity> m) {
+        _rest.seek(m);
+        this->_seek(m);
+    }
+
     void apply(
       [[maybe_unused]] entity_param_t<Entity> m,
       manipulator<CL>&... clm) {
@@ -1282,6 +2461,13 @@ template <typename... Component, typename Func>
 void basic_manager<Entity>::_call_for_each_c_m_p(const Func& func) {
     _manager_for_each_c_m_p_helper<Entity, Component...> hlp(
       func, _find_cmp_storage<_bare_t<Component>>()...);
+    if(_has_unordered_stg<_bare_t<Component>...>()) {
+        for(const auto& e : _unordered_join<_bare_t<Component>...>(false)) {
+            hlp.seek(e);
+            hlp.apply(e);
+        }
+        return;
+    }
     while(not hlp.done()) {
         hlp.apply();
         hlp.next();
@@ -1302,7 +2488,7 @@ protected:
     using _manager_for_each_c_m_base<Entity, C>::_current;
 
     auto _next() -> bool {
-        if(_current() >= _iter.current()) {
+        if(not _iter.done() and (_current() >= _iter.current())) {
             _iter.next();
         }
         if(not _iter.done()) {
@@ -1311,14 +2497,6 @@ protected:
         }
         return false;
     }
-
-    auto _find(entity_param_t<Entity> e) -> bool {
-        if(_iter.find(e)) {
-            _curr = _iter.current();
-            return true;
-        }
-        return false;
-    }
 };
 //------------------------------------------------------------------------------
 template <typename Entity, typename LL, typename LR>
@@ -1344,12 +2522,9 @@ public:
         return this->_done();
     }
 
-    auto sync_to(entity_param_t<Entity> m) -> bool {
-        return this->_find(m);
-    }
-
-    auto max_entity() -> Entity {
-        return this->_current();
+    void plan(std::span<_manager_for_each_iter_base<Entity>*> cursors) {
+        assert(cursors.size() == 1U);
+        cursors.front() = this;
     }
 
     auto next() -> bool {
@@ -1391,19 +2566,10 @@ public:
         return this->_done() or _rest.done();
     }
 
-    auto sync_to(entity_param_t<Entity> m) -> bool {
-        return _rest.sync_to(m) and this->_find(m);
-    }
-
-    auto max_entity() -> Entity {
-        Entity m = _rest.max_entity();
-        Entity c = this->_current();
-        return (m > c) ? m : c;
-    }
-
-    auto sync() -> bool {
-        static_assert(sizeof...(CL) == 0);
-        return sync_to(max_entity());
+    void plan(std::span<_manager_for_each_iter_base<Entity>*> cursors) {
+        assert(not cursors.empty());
+        cursors.front() = this;
+        _rest.plan(cursors.subspan(1));
     }
 
     auto next() -> bool {
@@ -1420,39 +2586,311 @@ public:
         };
         this->_apply({construct_from, hlpr});
     }
-
-    void apply() {
-        static_assert(sizeof...(CL) == 0);
-        assert(not done());
-
-        apply(max_entity());
-    }
 };
 //------------------------------------------------------------------------------
 template <typename Entity, typename... C>
 using _manager_for_each_c_m_r_helper =
   _manager_for_each_c_m_r_unit<Entity, mp_list<>, mp_list<C...>>;
 //------------------------------------------------------------------------------
+// Join planner: the iterator of the smallest storage drives the join,
+// the others are probed in the order of increasing size, so that most
+// of the candidates are rejected by the most selective storage first.
+// When a probe skips past the candidate, the driver seeks (leapfrogs)
+// to the entity where the probe stopped. The units are not reordered,
+// so the function still gets the components in the declared order.
+template <typename Entity, std::size_t N>
+class _manager_for_each_c_m_r_plan {
+public:
+    template <typename Helper>
+    _manager_for_each_c_m_r_plan(Helper& hlp) {
+        hlp.plan(_cursors);
+        std::stable_sort(
+          _cursors.begin(), _cursors.end(), [](auto* l, auto* r) {
+              return l->_size < r->_size;
+          });
+    }
+
+    /// @brief Moves all iterators to the next entity present in all storages.
+    auto sync() -> bool {
+        auto& driver{*_cursors.front()};
+        while(not driver._done()) {
+            const Entity m{driver._current()};
+            bool found{true};
+            for(std::size_t i = 1; i < N; ++i) {
+                auto& probe{*_cursors[i]};
+                if(not probe._seek(m)) {
+                    return false;
+                }
+                if(probe._current() != m) {
+                    if(not driver._seek(probe._current())) {
+                        return false;
+                    }
+                    found = false;
+                    break;
+                }
+            }
+            if(found) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// @brief Moves all iterators to the specified entity, if all have it.
+    auto seek_all(entity_param_t<Entity> e) -> bool {
+        for(auto* cursor : _cursors) {
+            if(not cursor->_seek(e) or (cursor->_current() != e)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// @brief Returns the entity at which all iterators are synchronized.
+    auto current() -> Entity {
+        return _cursors.front()->_current();
+    }
+
+private:
+    std::array<_manager_for_each_iter_base<Entity>*, N> _cursors{};
+};
+//------------------------------------------------------------------------------
+template <typename Entity>
+template <typename C>
+auto basic_manager<Entity>::_is_archetype_stg() noexcept -> bool {
+    using S = archetype_cmp_storage<Entity, C>;
+    if(const auto ct_storage{dynamic_cast<S*>(&_find_cmp_storage<C>())}) {
+        return &ct_storage->registry() == _archetypes.get();
+    }
+    return false;
+}
+//------------------------------------------------------------------------------
+template <typename Entity>
+template <typename C>
+auto basic_manager<Entity>::_is_table_stg() noexcept -> bool {
+    using S = archetype_cmp_storage<Entity, C>;
+    return dynamic_cast<S*>(&_find_cmp_storage<C>()) != nullptr;
+}
+//------------------------------------------------------------------------------
+template <typename Entity>
+template <typename... C>
+auto basic_manager<Entity>::_common_archetypes() noexcept
+  -> archetype_registry<Entity>* {
+    if(_archetypes and (... and _is_archetype_stg<C>())) {
+        return _archetypes.get();
+    }
+    return nullptr;
+}
+//------------------------------------------------------------------------------
+template <typename Entity>
+template <typename... C>
+auto basic_manager<Entity>::_has_unordered_stg() noexcept -> bool {
+    return (... or not _find_cmp_storage<C>().capabilities().is_ordered());
+}
+//------------------------------------------------------------------------------
+// Hash join: the sorted-merge join needs iterators visiting the entities
+// in order. If some storage is unordered, the entities of the smallest
+// storage that are found in all the others by direct lookup (or the entities
+// of all storages if not all are required) are gathered first. These are
+// sorted if needed, so that the iterators of ordered storages seek forward.
+template <typename Entity>
+template <typename... C>
+auto basic_manager<Entity>::_unordered_join(bool all) -> std::vector<Entity> {
+    std::array<base_component_storage<Entity>*, sizeof...(C)> storages{
+      &_find_cmp_storage<C>()...};
+    const auto is_ordered{[](auto* storage) {
+        return storage->capabilities().is_ordered();
+    }};
+    std::vector<Entity> result;
+    const auto gather{[&](auto* storage, const auto& accept) {
+        auto iter{storage->new_iterator(storage_buffer::read)};
+        for(; not iter.done(); iter.next()) {
+            const Entity e{iter.current()};
+            if(accept(e)) {
+                result.push_back(e);
+            }
+        }
+        storage->delete_iterator(std::move(iter));
+    }};
+
+    if(all) {
+        std::sort(storages.begin(), storages.end(), [](auto* l, auto* r) {
+            return l->size() < r->size();
+        });
+        auto* driver{storages.front()};
+        result.reserve(driver->size());
+        gather(driver, [&](entity_param_t<Entity> e) {
+            return std::all_of(
+              std::next(storages.begin()), storages.end(), [&](auto* other) {
+                  return other->has(e);
+              });
+        });
+        if(
+          not is_ordered(driver) and
+          std::any_of(storages.begin(), storages.end(), is_ordered)) {
+            std::sort(result.begin(), result.end());
+        }
+    } else {
+        for(auto* storage : storages) {
+            gather(storage, [](entity_param_t<Entity>) { return true; });
+        }
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+    }
+    return result;
+}
+//------------------------------------------------------------------------------
 template <typename Entity>
 template <typename... Component, typename Func>
 void basic_manager<Entity>::_call_for_each_c_m_r(const Func& func) {
+    if(const auto archetypes{_common_archetypes<_bare_t<Component>...>()}) {
+        archetypes->template for_each_all<Component...>(func);
+        return;
+    }
+    if(_has_unordered_stg<_bare_t<Component>...>()) {
+        _call_for_each_c_m_v<Component...>(
+          _unordered_join<_bare_t<Component>...>(true), func);
+        return;
+    }
     _manager_for_each_c_m_r_helper<Entity, Component...> hlp(
       func, _find_cmp_storage<_bare_t<Component>>()...);
-    if(hlp.sync()) {
-        while(not hlp.done()) {
-            hlp.apply();
-            if(not hlp.next()) {
-                break;
-            }
-            if(not hlp.sync()) {
-                break;
-            }
+    _manager_for_each_c_m_r_plan<Entity, sizeof...(Component)> plan{hlp};
+    while(plan.sync()) {
+        hlp.apply(plan.current());
+        if(not hlp.next()) {
+            break;
+        }
+    }
+}
+//------------------------------------------------------------------------------
+template <typename Entity>
+template <typename... Component, typename Func>
+void basic_manager<Entity>::_call_for_each_c_m_v(
+  std::span<const Entity> entities,
+  const Func& func) {
+    _manager_for_each_c_m_r_helper<Entity, Component...> hlp(
+      func, _find_cmp_storage<_bare_t<Component>>()...);
+    _manager_for_each_c_m_r_plan<Entity, sizeof...(Component)> plan{hlp};
+    for(const auto& e : entities) {
+        if(plan.seek_all(e)) {
+            hlp.apply(e);
+        }
+    }
+}
+//------------------------------------------------------------------------------
+template <typename Entity>
+template <typename... Component, typename Func>
+void basic_manager<Entity>::_call_for_each_c_m_v(
+  entity_view<Entity>& view,
+  std::span<const Entity> entities,
+  const Func& func) {
+    static_assert(sizeof...(Component) <= 64U);
+    const std::array<std::size_t, sizeof...(Component)> positions{
+      view.position(component_index<_bare_t<Component>>())...};
+    constexpr const std::array<bool, sizeof...(Component)> written{
+      not std::is_const_v<Component>...};
+    // identifies the positions of the written components
+    std::uint64_t key{0U};
+    for(std::size_t i = 0; i < positions.size(); ++i) {
+        if(written[i]) {
+            key |= std::uint64_t(1U) << positions[i];
+        }
+    }
+
+    if(const auto rows{view.rows(key)}; not rows.empty()) {
+        _view_rows_pass<Component...>(
+          func,
+          view,
+          entities,
+          rows,
+          positions,
+          std::index_sequence_for<Component...>{});
+        return;
+    }
+
+    std::vector<void*> row(view.width(), nullptr);
+    const auto gather{[&](entity_param e, manipulator<Component>&... m) {
+        std::size_t i{0U};
+        (...,
+         (row[positions[i++]] =
+            const_cast<_bare_t<Component>*>(_batch_of(m).data())));
+        view.add_row(row);
+        func(e, m...);
+    }};
+    _manager_for_each_c_m_r_helper<Entity, Component...> hlp(
+      callable_ref<void(entity_param, manipulator<Component>&...)>{
+        construct_from, gather},
+      _find_cmp_storage<_bare_t<Component>>()...);
+    _manager_for_each_c_m_r_plan<Entity, sizeof...(Component)> plan{hlp};
+    view.gather_rows(key);
+    for(const auto& e : entities) {
+        if(plan.seek_all(e)) {
+            hlp.apply(e);
         }
     }
+    view.finish_rows();
+}
+//------------------------------------------------------------------------------
+template <typename Entity>
+template <typename... Component, typename Func, std::size_t... I>
+void basic_manager<Entity>::_view_rows_pass(
+  const Func& func,
+  entity_view<Entity>& view,
+  std::span<const Entity> entities,
+  std::span<void* const> rows,
+  const std::array<std::size_t, sizeof...(Component)>& positions,
+  std::index_sequence<I...>) {
+    const auto width{view.width()};
+    std::array<std::vector<Entity>, sizeof...(Component)> removed;
+    std::size_t done{0U};
+    for(; done < entities.size(); ++done) {
+        // the function changed some of the storages
+        if(not view.rows_valid()) {
+            break;
+        }
+        const auto& e{entities[done]};
+        const auto row{rows.subspan(done * width, width)};
+        std::tuple<concrete_manipulator<Component>...> ms{
+          concrete_manipulator<Component>{
+            static_cast<Component*>(row[positions[I]]),
+            true /*can_remove*/}...};
+        func(e, std::get<I>(ms)...);
+        (..., _view_row_done(std::get<I>(ms), removed[I], e));
+    }
+    if(done < entities.size()) {
+        _call_for_each_c_m_v<Component...>(entities.subspan(done), func);
+    }
+
+    const std::array<identifier_t, sizeof...(Component)> cids{
+      _bare_t<Component>::uid()...};
+    const std::array<std::string (*)() noexcept, sizeof...(Component)> names{
+      _cmp_name_getter<_bare_t<Component>>()...};
+    for(std::size_t i = 0; i < cids.size(); ++i) {
+        for(const auto& e : removed[i]) {
+            _do_rem_c(e, cids[i], names[i]);
+        }
+    }
+}
+//------------------------------------------------------------------------------
+template <typename Entity>
+template <typename C>
+void basic_manager<Entity>::_view_row_done(
+  const concrete_manipulator<C>& m,
+  std::vector<Entity>& removed,
+  entity_param_t<Entity> e) {
+    if(m.remove_requested()) {
+        removed.push_back(e);
+    } else if constexpr(not std::is_const_v<C>) {
+        // done by the storages when accessed through them
+        _observers.on_modified(component_index<_bare_t<C>>(), e);
+    }
 }
 //------------------------------------------------------------------------------
 template <typename Entity>
 auto basic_manager<Entity>::knows(entity_param_t<Entity> ent) noexcept -> bool {
+    if(_signatures) {
+        return _signatures->knows(ent);
+    }
     for(auto& entry : _cmp_storages) {
         auto& storage{std::get<1>(entry)};
         if(storage and storage->has(ent)) {
@@ -1464,26 +2902,209 @@ auto basic_manager<Entity>::knows(entity_param_t<Entity> ent) noexcept -> bool {
 //------------------------------------------------------------------------------
 template <typename Entity>
 auto basic_manager<Entity>::spawn() noexcept -> Entity {
-    do {
-        _entity_sequence = entity_traits<Entity>::next(_entity_sequence);
-    } while(knows(_entity_sequence));
-    this->entity_spawned(_entity_sequence);
-    return _entity_sequence;
+    const Entity ent{_entities.allocate(
+      [this](entity_param_t<Entity> e) { return knows(e); })};
+    this->entity_spawned(ent);
+    return ent;
 }
 //------------------------------------------------------------------------------
 template <typename Entity>
 void basic_manager<Entity>::forget(entity_param_t<Entity> ent) {
     if(ent) {
-        for(auto& entry : _cmp_storages) {
-            auto& storage{std::get<1>(entry)};
-            if(storage) {
-                if(storage->capabilities().can_remove()) {
-                    storage->remove(ent);
+        if(_signatures) {
+            for(const auto index : _signatures->stored(ent)) {
+                if(auto storage{_indexed_storages[index]}) {
+                    if(storage->capabilities().can_remove()) {
+                        storage->remove(ent);
+                    }
+                }
+            }
+        } else {
+            for(auto& entry : _cmp_storages) {
+                auto& storage{std::get<1>(entry)};
+                if(storage) {
+                    if(storage->capabilities().can_remove()) {
+                        storage->remove(ent);
+                    }
                 }
             }
         }
+        _entities.release(ent);
         this->entity_forgotten(ent);
     }
 }
 //------------------------------------------------------------------------------
+template <typename Entity>
+auto basic_manager<Entity>::save_snapshot(std::ostream& output) -> bool {
+    if constexpr(snapshot_data<Entity>) {
+        snapshot_header header{};
+        if constexpr(std::is_trivially_copyable_v<Entity>) {
+            header.entity_size = sizeof(Entity);
+        }
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        std::size_t offset{sizeof(header)};
+
+        const auto write_section{[&](
+                                   snapshot_section kind,
+                                   identifier_t uid,
+                                   snapshot_layout layout,
+                                   const auto& save) {
+            snapshot_writer writer{offset + sizeof(snapshot_section_header)};
+            if(save(writer)) {
+                writer.align(8U);
+                const auto data{writer.data()};
+                const snapshot_section_header section{
+                  .kind = kind,
+                  .uid = uid,
+                  .size = data.size(),
+                  .layout = layout};
+                output.write(
+                  reinterpret_cast<const char*>(&section), sizeof(section));
+                output.write(
+                  reinterpret_cast<const char*>(data.data()),
+                  std::streamsize(data.size()));
+                offset += sizeof(section) + data.size();
+            }
+        }};
+
+        if constexpr(requires(snapshot_writer& w) {
+                         _entities.save_snapshot(w);
+                     }) {
+            write_section(
+              snapshot_section::entities,
+              0U,
+              snapshot_layout::of<Entity>(),
+              [this](snapshot_writer& writer) {
+                  _entities.save_snapshot(writer);
+                  return true;
+              });
+        }
+        for(auto& entry : _cmp_storages) {
+            if(auto& storage{std::get<1>(entry)}) {
+                write_section(
+                  snapshot_section::component,
+                  std::get<0>(entry),
+                  storage->data_layout(),
+                  [&](snapshot_writer& writer) {
+                      return storage->save_snapshot(writer);
+                  });
+            }
+        }
+        for(auto& entry : _rel_storages) {
+            if(auto& storage{std::get<1>(entry)}) {
+                write_section(
+                  snapshot_section::relation,
+                  std::get<0>(entry),
+                  storage->data_layout(),
+                  [&](snapshot_writer& writer) {
+                      return storage->save_snapshot(writer);
+                  });
+            }
+        }
+        const snapshot_section_header end{};
+        output.write(reinterpret_cast<const char*>(&end), sizeof(end));
+        return output.good();
+    } else {
+        return false;
+    }
+}
+//------------------------------------------------------------------------------
+template <typename Entity>
+auto basic_manager<Entity>::load_snapshot(std::istream& input) -> bool {
+    if constexpr(snapshot_data<Entity>) {
+        snapshot_header expected{};
+        if constexpr(std::is_trivially_copyable_v<Entity>) {
+            expected.entity_size = sizeof(Entity);
+        }
+        snapshot_header header{};
+        if(
+          not input.read(reinterpret_cast<char*>(&header), sizeof(header)) or
+          not header.is_compatible(expected)) {
+            return false;
+        }
+        std::size_t offset{sizeof(header)};
+
+        std::vector<std::byte> data;
+        while(true) {
+            snapshot_section_header section{};
+            if(not input.read(
+                 reinterpret_cast<char*>(&section), sizeof(section))) {
+                return false;
+            }
+            offset += sizeof(section);
+            if(section.kind == snapshot_section::end) {
+                return true;
+            }
+            // the size is not trusted, the data grow only as they are read
+            data.clear();
+            for(auto left{section.size}; left > 0U;) {
+                const auto done{data.size()};
+                const auto chunk{
+                  std::size_t(std::min(left, std::uint64_t(1U) << 20U))};
+                data.resize(done + chunk);
+                if(not input.read(
+                     reinterpret_cast<char*>(data.data() + done),
+                     std::streamsize(chunk))) {
+                    return false;
+                }
+                left -= chunk;
+            }
+            snapshot_reader reader{data, offset};
+            offset += data.size();
+
+            bool loaded{true};
+            switch(section.kind) {
+                case snapshot_section::entities:
+                    if constexpr(requires(snapshot_reader& r) {
+                                     _entities.load_snapshot(r);
+                                 }) {
+                        loaded =
+                          (section.layout == snapshot_layout::of<Entity>()) and
+                          _entities.load_snapshot(reader);
+                    }
+                    break;
+                case snapshot_section::component:
+                    if(auto storage{
+                         _get_base_stg<data_kind::component>(section.uid)}) {
+                        loaded = (section.layout == storage->data_layout()) and
+                                 storage->load_snapshot(reader);
+                    }
+                    break;
+                case snapshot_section::relation:
+                    if(auto storage{
+                         _get_base_stg<data_kind::relation>(section.uid)}) {
+                        loaded = (section.layout == storage->data_layout()) and
+                                 storage->load_snapshot(reader);
+                    }
+                    break;
+                case snapshot_section::end:
+                    break;
+            }
+            if(not loaded) {
+                return false;
+            }
+        }
+    } else {
+        return false;
+    }
+}
+//------------------------------------------------------------------------------
+/// @brief Saves the entities, components and relations of manager into output.
+/// @ingroup ecs
+/// @see basic_manager::save_snapshot
+export template <typename Entity>
+auto save_snapshot(basic_manager<Entity>& manager, std::ostream& output)
+  -> bool {
+    return manager.save_snapshot(output);
+}
+//------------------------------------------------------------------------------
+/// @brief Loads the entities, components and relations of manager from input.
+/// @ingroup ecs
+/// @see basic_manager::load_snapshot
+export template <typename Entity>
+auto load_snapshot(std::istream& input, basic_manager<Entity>& manager)
+  -> bool {
+    return manager.load_snapshot(input);
+}
+//------------------------------------------------------------------------------
 } // namespace eagine::ecs
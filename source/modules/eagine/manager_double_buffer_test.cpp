@@ -0,0 +1,199 @@
+/// @file
+///
+/// Distributed under the Boost Software License, Version 1.0.
+/// See accompanying file LICENSE_1_0.txt or copy at
+/// https://www.boost.org/LICENSE_1_0.txt
+///
+
+#include <eagine/testing/unit_begin_ctx.hpp>
+import std;
+import eagine.core;
+import eagine.ecs;
+//------------------------------------------------------------------------------
+struct position : eagine::ecs::component<"Position"> {
+    float value{0.F};
+};
+
+struct velocity : eagine::ecs::component<"Velocity"> {
+    float value{0.F};
+};
+//------------------------------------------------------------------------------
+static void populate(
+  eagine::ecs::basic_manager<eagine::identifier_t>& mgr,
+  eagine::identifier_t count) {
+    mgr.register_component_storage<
+      eagine::ecs::double_buffer_cmp_storage,
+      position>();
+    mgr
+      .register_component_storage<eagine::ecs::flat_map_cmp_storage, velocity>();
+    for(eagine::identifier_t e = 1; e <= count; ++e) {
+        position p;
+        p.value = float(e);
+        velocity v;
+        v.value = 1.F;
+        mgr.add(e, std::move(p), std::move(v));
+    }
+}
+//------------------------------------------------------------------------------
+// capabilities
+//------------------------------------------------------------------------------
+void manager_double_buffer_caps_1(auto& s) {
+    eagitest::case_ test{s, 1, "capabilities"};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    populate(mgr, 10U);
+
+    test.check(
+      mgr.component_storage_caps<position>().can_swap_buffers(), "position");
+    test.check(
+      not mgr.component_storage_caps<velocity>().can_swap_buffers(),
+      "velocity");
+}
+//------------------------------------------------------------------------------
+// read / write
+//------------------------------------------------------------------------------
+void manager_double_buffer_read_write_1(auto& s) {
+    eagitest::case_ test{s, 2, "read/write"};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    populate(mgr, 100U);
+
+    mgr.write_each<position>([](const auto, auto& p) {
+        p.write().value += 10.F;
+    });
+
+    bool current{true};
+    mgr.read_each<position>([&](const auto e, auto& p) {
+        current = current and (p.read().value == float(e));
+    });
+    test.check(current, "current before swap");
+
+    mgr.write_each<position>([](const auto, auto& p) {
+        p.write().value += 10.F;
+    });
+    mgr.swap_buffers();
+
+    bool next{true};
+    mgr.read_each<position>([&](const auto e, auto& p) {
+        next = next and (p.read().value == float(e) + 20.F);
+    });
+    test.check(next, "next after swap");
+
+    mgr.swap_buffers();
+    bool kept{true};
+    mgr.read_each<position>([&](const auto e, auto& p) {
+        kept = kept and (p.read().value == float(e) + 20.F);
+    });
+    test.check(kept, "kept after second swap");
+}
+//------------------------------------------------------------------------------
+// join
+//------------------------------------------------------------------------------
+void manager_double_buffer_join_1(auto& s) {
+    eagitest::case_ test{s, 3, "join"};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    populate(mgr, 100U);
+
+    int count{0};
+    mgr.for_each_with<position, const velocity>(
+      [&](const auto, auto& p, auto& v) {
+          p.write().value += v.read().value;
+          ++count;
+      });
+    test.check_equal(count, 100, "count");
+
+    bool ok{true};
+    mgr.for_each_with<const position, const velocity>(
+      [&](const auto e, auto& p, auto&) {
+          ok = ok and (p.read().value == float(e));
+      });
+    test.check(ok, "current");
+
+    mgr.swap_buffers();
+    mgr.for_each_with<const position, const velocity>(
+      [&](const auto e, auto& p, auto&) {
+          ok = ok and (p.read().value == float(e) + 1.F);
+      });
+    test.check(ok, "next");
+}
+//------------------------------------------------------------------------------
+// remove / hide
+//------------------------------------------------------------------------------
+void manager_double_buffer_remove_hide_1(auto& s) {
+    eagitest::case_ test{s, 4, "remove/hide"};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    populate(mgr, 10U);
+
+    mgr.write_each<position>([](const auto e, auto& p) {
+        if(e % 2U == 0U) {
+            p.remove();
+        }
+    });
+    test.check(mgr.has<position>(2U), "deferred");
+    mgr.swap_buffers();
+    test.check(not mgr.has<position>(2U), "removed 2");
+    test.check(mgr.has<position>(3U), "kept 3");
+
+    mgr.remove<position>(3U);
+    test.check(not mgr.has<position>(3U), "removed 3");
+
+    mgr.hide<position>(5U);
+    test.check(not mgr.has<position>(5U), "hidden 5");
+    mgr.show<position>(5U);
+    test.check(mgr.has<position>(5U), "shown 5");
+
+    int count{0};
+    mgr.read_each<position>([&](const auto, auto&) { ++count; });
+    test.check_equal(count, 4, "count");
+}
+//------------------------------------------------------------------------------
+// scheduler
+//------------------------------------------------------------------------------
+void manager_double_buffer_scheduler_1(auto& s) {
+    eagitest::case_ test{s, 5, "scheduler"};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    mgr.use_workers({eagine::hold<eagine::ecs::worker_pool>, 3U});
+    populate(mgr, 2000U);
+
+    std::atomic<int> wrong{0};
+    eagine::ecs::basic_scheduler<eagine::identifier_t> sched{mgr};
+    sched.add<position, const velocity>([](const auto, auto& p, auto& v) {
+        p.write().value += v.read().value;
+    });
+    sched.add<const position>([&](const auto e, auto& p) {
+        if(p.read().value != float(e)) {
+            wrong.fetch_add(1);
+        }
+    });
+    sched.update();
+    test.check_equal(sched.stage_count(), std::size_t(1U), "stages");
+    test.check_equal(wrong.load(), 0, "readers see current");
+
+    mgr.swap_buffers();
+    bool ok{true};
+    mgr.read_each<position>([&](const auto e, auto& p) {
+        ok = ok and (p.read().value == float(e) + 1.F);
+    });
+    test.check(ok, "next");
+}
+//------------------------------------------------------------------------------
+// main
+//------------------------------------------------------------------------------
+auto test_main(eagine::test_ctx& ctx) -> int {
+    eagitest::ctx_suite test{ctx, "manager double buffer", 5};
+    test.once(manager_double_buffer_caps_1);
+    test.once(manager_double_buffer_read_write_1);
+    test.once(manager_double_buffer_join_1);
+    test.once(manager_double_buffer_remove_hide_1);
+    test.once(manager_double_buffer_scheduler_1);
+    return test.exit_code();
+}
+//------------------------------------------------------------------------------
+auto main(int argc, const char** argv) -> int {
+    return eagine::test_main_impl(argc, argv, test_main);
+}
+//------------------------------------------------------------------------------
+#include <eagine/testing/unit_end_ctx.hpp>
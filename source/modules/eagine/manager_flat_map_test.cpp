@@ -48,11 +48,36 @@ struct greeting : eagine::ecs::component<"Greeting"> {
     std::string expression;
 };
 //------------------------------------------------------------------------------
+struct counter : eagine::ecs::component<"Counter"> {
+    int value{0};
+};
+//------------------------------------------------------------------------------
+// same uid as counter, saved with a different layout
+struct wide_counter : eagine::ecs::component<"Counter"> {
+    std::int64_t value{0};
+    std::int64_t limit{0};
+};
+//------------------------------------------------------------------------------
+struct weight : eagine::ecs::component<"Weight"> {
+    int value{1};
+};
+//------------------------------------------------------------------------------
 namespace eagine::ecs {
 template <bool Const>
 struct get_manipulator<::person, Const> {
     using type = ::person_manipulator<Const>;
 };
+
+template <>
+struct snapshot_traits<::greeting> {
+    static void save(snapshot_writer& writer, const ::greeting& g) {
+        writer.write_string(g.expression);
+    }
+
+    static auto load(snapshot_reader& reader, ::greeting& g) -> bool {
+        return reader.read_string(g.expression);
+    }
+};
 } // namespace eagine::ecs
 //------------------------------------------------------------------------------
 // register / unregister
@@ -1238,10 +1263,1178 @@ void manager_component_select_cross_1(auto& s) {
     run_tests(11, 110, 8, "H");
 }
 //------------------------------------------------------------------------------
+// for-each direct
+//------------------------------------------------------------------------------
+void manager_component_for_each_direct_1(auto& s) {
+    using eagine::id_v;
+    eagitest::case_ test{s, 25, "for-each direct"};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    mgr.register_component_storage<eagine::ecs::flat_map_cmp_storage, person>();
+    mgr
+      .register_component_storage<eagine::ecs::std_map_cmp_storage, greeting>();
+
+    mgr.add(id_v("John"), person("John", "Doe"), greeting("Hi"));
+    mgr.add(id_v("Jane"), person("Jane", "Roe"), greeting("Hey"));
+    mgr.add(id_v("Jack"), person("Jack", "Daniels"), greeting("Howdy"));
+
+    int count{0};
+    mgr.read_each<eagine::ecs::flat_map_cmp_storage, person>(
+      [&](const auto e, auto& p) {
+          test.check(p.read().name == eagine::identifier(e).name().str(), "1");
+          ++count;
+      });
+    test.check_equal(count, 3, "A");
+
+    mgr.write_each<eagine::ecs::flat_map_cmp_storage, person>(
+      [&](const auto e, auto& p) {
+          if(e == id_v("Jack")) {
+              p.remove();
+          } else {
+              p.write().family_name = "Smith";
+          }
+      });
+    test.check(not mgr.has<person>(id_v("Jack")), "2");
+    test.check(mgr.has<person>(id_v("John")), "3");
+    test.check(mgr.ensure<person>(id_v("Jane")).has_name("Jane", "Smith"), "4");
+
+    // storage type mismatch, falls back to the type-erased path
+    count = 0;
+    mgr.write_each<eagine::ecs::flat_map_cmp_storage, greeting>(
+      [&](const auto, auto& g) {
+          g.write().expression = "Hello";
+          ++count;
+      });
+    test.check_equal(count, 3, "B");
+    test.check(
+      mgr.ensure<greeting>(id_v("Jack")).read().expression == "Hello", "5");
+}
+//------------------------------------------------------------------------------
+// for-each batch
+//------------------------------------------------------------------------------
+void manager_component_for_each_batch_1(auto& s) {
+    using eagine::id_v;
+    eagitest::case_ test{s, 26, "for-each batch"};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    mgr.register_component_storage<eagine::ecs::flat_map_cmp_storage, person>();
+    mgr
+      .register_component_storage<eagine::ecs::flat_map_cmp_storage, counter>();
+
+    for(eagine::identifier_t e = 1; e <= 5000; ++e) {
+        mgr.ensure<counter>(e).write().value = int(e);
+    }
+
+    std::size_t total{0U};
+    mgr.for_each_batch<counter>([&](auto entities, auto counters) {
+        test.check_equal(entities.size(), counters.size(), "same size");
+        for(auto& c : counters) {
+            c.value *= 2;
+        }
+        total += entities.size();
+    });
+    test.check_equal(total, std::size_t(5000U), "A");
+
+    mgr.for_each_batch<const counter>([&](auto entities, auto counters) {
+        for(std::size_t i = 0; i < entities.size(); ++i) {
+            test.check_equal(counters[i].value, int(entities[i] * 2U), "1");
+        }
+    });
+
+    mgr.clear();
+    mgr.register_component_storage<eagine::ecs::flat_map_cmp_storage, person>();
+    mgr
+      .register_component_storage<eagine::ecs::flat_map_cmp_storage, counter>();
+
+    mgr.add(id_v("John"), person("John", "Doe"), counter{});
+    mgr.add(id_v("Jane"), person("Jane", "Roe"), counter{});
+    mgr.add(id_v("Jack"), person("Jack", "Daniels"));
+
+    total = 0U;
+    mgr.for_each_batch<const person, counter>(
+      [&](auto entities, auto persons, auto counters) {
+          test.check_equal(entities.size(), persons.size(), "same size");
+          test.check_equal(entities.size(), counters.size(), "same size");
+          for(std::size_t i = 0; i < entities.size(); ++i) {
+              test.check(
+                persons[i].name == eagine::identifier(entities[i]).name().str(),
+                "2");
+              counters[i].value = -1;
+          }
+          total += entities.size();
+      });
+    test.check_equal(total, std::size_t(2U), "B");
+    test.check_equal(
+      mgr.ensure<counter>(id_v("Jane")).read().value, -1, "C");
+    test.check(not mgr.has<counter>(id_v("Jack")), "D");
+
+    mgr.register_component_storage<eagine::ecs::flat_map_cmp_storage, weight>();
+    for(eagine::identifier_t e = 1; e <= 1000; ++e) {
+        mgr.ensure<counter>(e).write().value = 0;
+        if(e % 2U == 0U) {
+            mgr.ensure<weight>(e).write().value = int(e);
+        }
+    }
+
+    total = 0U;
+    std::size_t longest{0U};
+    mgr.for_each_batch<counter, const weight>(
+      [&](auto entities, auto counters, auto weights) {
+          test.check_equal(entities.size(), weights.size(), "same size");
+          for(std::size_t i = 0; i < entities.size(); ++i) {
+              counters[i].value = weights[i].value;
+          }
+          longest = std::max(longest, entities.size());
+          total += entities.size();
+      });
+    test.check_equal(total, std::size_t(500U), "E");
+    test.check(longest > 1U, "joined batches");
+    test.check_equal(mgr.ensure<counter>(998U).read().value, 998, "F");
+    test.check_equal(mgr.ensure<counter>(999U).read().value, 0, "G");
+}
+//------------------------------------------------------------------------------
+// spawn / forget
+//------------------------------------------------------------------------------
+void manager_component_spawn_forget_1(auto& s) {
+    eagitest::case_ test{s, 27, "spawn & forget"};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    mgr.register_component_storage<eagine::ecs::flat_map_cmp_storage, counter>();
+
+    std::set<eagine::identifier_t> spawned;
+    for(int i = 0; i < 100; ++i) {
+        const auto e{mgr.spawn()};
+        test.check(e != 0U, "not null");
+        test.check(bool(mgr.is_alive(e)), "alive");
+        spawned.insert(e);
+        mgr.add(e, counter{});
+    }
+    test.check_equal(spawned.size(), std::size_t(100U), "unique");
+
+    const auto stale{*spawned.begin()};
+    mgr.forget(stale);
+    test.check(not bool(mgr.is_alive(stale)), "forgotten");
+    test.check(not mgr.has<counter>(stale), "no counter");
+
+    const auto recycled{mgr.spawn()};
+    test.check(recycled != stale, "new generation");
+    test.check(not spawned.contains(recycled), "not reused");
+    test.check(bool(mgr.is_alive(recycled)), "recycled alive");
+    mgr.add(recycled, counter{});
+    test.check(not bool(mgr.is_alive(stale)), "stale");
+
+    mgr.forget(stale);
+    test.check(bool(mgr.is_alive(recycled)), "stale forget ignored");
+
+    for(const auto e : spawned) {
+        mgr.forget(e);
+    }
+    std::size_t count{0U};
+    mgr.read_each<counter>([&](const auto, auto&) { ++count; });
+    test.check_equal(count, std::size_t(1U), "remaining");
+}
+//------------------------------------------------------------------------------
+// signatures
+//------------------------------------------------------------------------------
+void manager_component_signatures_1(auto& s) {
+    eagitest::case_ test{s, 28, "signatures"};
+    using eagine::id_v;
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    mgr.use_signatures();
+    test.check(mgr.uses_signatures(), "uses");
+    mgr.register_component_storage<eagine::ecs::flat_map_cmp_storage, person>();
+    mgr.register_component_storage<eagine::ecs::sparse_set_cmp_storage, greeting>();
+    mgr.register_archetype_storages<counter>();
+
+    mgr.add(id_v("bart"), person("Bart", "Simpson"), greeting("Ay caramba"));
+    mgr.add(id_v("homer"), person("Homer", "Simpson"), counter{});
+    mgr.add(id_v("lisa"), counter{});
+
+    test.check(mgr.knows(id_v("bart")), "knows bart");
+    test.check(not mgr.knows(id_v("maggie")), "knows maggie");
+    test.check(mgr.has_all<person, greeting>(id_v("bart")), "bart 1");
+    test.check(not mgr.has_all<person, counter>(id_v("bart")), "bart 2");
+    test.check(mgr.has_all<person, counter>(id_v("homer")), "homer 1");
+    test.check(mgr.has<counter>(id_v("lisa")), "lisa 1");
+
+    mgr.hide<person>(id_v("homer"));
+    test.check(not mgr.has<person>(id_v("homer")), "homer 2");
+    test.check(mgr.has<counter>(id_v("homer")), "homer 3");
+    mgr.show<person>(id_v("homer"));
+    test.check(mgr.has_all<person, counter>(id_v("homer")), "homer 4");
+
+    mgr.hide<counter>(id_v("lisa"));
+    test.check(not mgr.knows(id_v("lisa")), "lisa 2");
+    mgr.forget(id_v("lisa"));
+    test.check(not mgr.is_hidden<counter>(id_v("lisa")), "lisa 3");
+
+    mgr.write_each<greeting>([](const auto, auto& g) { g.remove(); });
+    test.check(not mgr.has<greeting>(id_v("bart")), "bart 3");
+    test.check(mgr.has<person>(id_v("bart")), "bart 4");
+
+    mgr.forget(id_v("homer"));
+    test.check(not mgr.knows(id_v("homer")), "homer 5");
+    test.check(not mgr.has<counter>(id_v("homer")), "homer 6");
+
+    mgr.unregister_component_type<person>();
+    test.check(not mgr.knows(id_v("bart")), "bart 5");
+
+    eagine::ecs::basic_manager<std::string> late;
+    late.register_component_storage<eagine::ecs::flat_map_cmp_storage, person>();
+    late.register_component_storage<eagine::ecs::std_map_cmp_storage, counter>();
+    late.add("marge", person("Marge", "Simpson"), counter{});
+    late.add("maggie", counter{});
+    late.hide<counter>("maggie");
+    late.use_signatures();
+    test.check(late.has_all<person, counter>("marge"), "marge 1");
+    test.check(not late.knows("maggie"), "maggie 1");
+    late.show<counter>("maggie");
+    test.check(late.knows("maggie"), "maggie 2");
+    late.remove<person, counter>("marge");
+    test.check(not late.knows("marge"), "marge 2");
+}
+//------------------------------------------------------------------------------
+// relation / subjects of
+//------------------------------------------------------------------------------
+void manager_component_relation_subjects_1(auto& s) {
+    eagitest::case_ test{s, 29, "relation/subjects of"};
+
+    eagine::ecs::basic_manager<std::string> mgr;
+    mgr.register_relation_storage<
+      eagine::ecs::flat_map_indexed_rel_storage,
+      father>();
+    mgr.register_relation_storage<eagine::ecs::flat_map_rel_storage, mother>();
+
+    mgr.ensure<father>("luke", "vader");
+    mgr.ensure<father>("leia", "vader");
+    mgr.ensure<father>("vader", "force");
+    mgr.ensure<father>("angryguy", "hans");
+    mgr.ensure<mother>("luke", "padme");
+    mgr.ensure<mother>("leia", "padme");
+    mgr.ensure<mother>("vader", "shmi");
+
+    const auto subjects_of = [&]<typename Relation>(
+                               std::type_identity<Relation>,
+                               const std::string& object) {
+        std::vector<std::string> result;
+        mgr.for_each_subject_of<Relation>(
+          object,
+          {eagine::construct_from,
+           [&](const std::string& subject, const std::string& obj) {
+               test.check(obj == object, "object");
+               result.push_back(subject);
+           }});
+        std::sort(result.begin(), result.end());
+        return result;
+    };
+
+    using children = std::vector<std::string>;
+    const std::type_identity<father> f;
+    const std::type_identity<mother> m;
+    test.check(subjects_of(f, "vader") == children{"leia", "luke"}, "vader 1");
+    test.check(subjects_of(f, "force") == children{"vader"}, "force");
+    test.check(subjects_of(f, "luke").empty(), "luke");
+    test.check(subjects_of(m, "padme") == children{"leia", "luke"}, "padme");
+    test.check(subjects_of(m, "shmi") == children{"vader"}, "shmi");
+
+    mgr.remove_relation<father>("leia", "vader");
+    test.check(subjects_of(f, "vader") == children{"luke"}, "vader 2");
+
+    const auto remove_hans{
+      [](const std::string&, const std::string& obj, auto& rel) {
+          if(obj == "hans") {
+              rel.remove();
+          }
+      }};
+    mgr.for_each<father>(
+      eagine::callable_ref<void(
+        const std::string&,
+        const std::string&,
+        eagine::ecs::manipulator<father>&)>{
+        eagine::construct_from, remove_hans});
+    test.check(subjects_of(f, "hans").empty(), "hans");
+    test.check(subjects_of(f, "vader") == children{"luke"}, "vader 3");
+}
+//------------------------------------------------------------------------------
+// sparse join
+//------------------------------------------------------------------------------
+void manager_component_sparse_join_1(auto& s) {
+    eagitest::case_ test{s, 30, "sparse join"};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    mgr.register_component_storage<eagine::ecs::flat_map_cmp_storage, counter>();
+    mgr.register_component_storage<eagine::ecs::std_map_cmp_storage, greeting>();
+    mgr.register_component_storage<eagine::ecs::sparse_set_cmp_storage, person>();
+
+    for(eagine::identifier_t e = 1; e <= 10000; ++e) {
+        mgr.add(e, counter{});
+        if(e % 100U == 0U) {
+            mgr.add(e, greeting{"hi"});
+        }
+        if((e % 300U == 0U) or (e % 450U == 0U)) {
+            mgr.add(e, person{"Some", "One"});
+        }
+    }
+    // entities missing in the dense storage
+    mgr.add(eagine::identifier_t(20001), greeting{"hey"});
+    mgr.add(eagine::identifier_t(20002), person{"No", "One"});
+
+    std::vector<eagine::identifier_t> visited;
+    mgr.for_each_with<counter, const greeting>(
+      [&](const auto e, auto& c, auto& g) {
+          test.check(g.read().expression == "hi", "greeting");
+          c.write().value += 1;
+          visited.push_back(e);
+      });
+    test.check_equal(visited.size(), std::size_t(100U), "count 2");
+    test.check(std::is_sorted(visited.begin(), visited.end()), "sorted 2");
+
+    visited.clear();
+    mgr.for_each_with<const greeting, counter, const person>(
+      [&](const auto e, auto&, auto& c, auto&) {
+          c.write().value += 1;
+          visited.push_back(e);
+      });
+    test.check_equal(visited.size(), std::size_t(33U), "count 3");
+    for(const auto e : visited) {
+        test.check_equal(e % 300U, eagine::identifier_t(0U), "entity");
+    }
+
+    int sum{0};
+    mgr.read_each<counter>([&](const auto, auto& c) { sum += c.read().value; });
+    test.check_equal(sum, 133, "sum");
+
+    mgr.for_each_with<counter, const greeting>(
+      [&](const auto e, auto& c, auto&) {
+          if(e % 200U == 0U) {
+              c.remove();
+          }
+      });
+    visited.clear();
+    mgr.for_each_with<const counter, const greeting>(
+      [&](const auto e, auto&, auto&) { visited.push_back(e); });
+    test.check_equal(visited.size(), std::size_t(50U), "count after remove");
+}
+//------------------------------------------------------------------------------
+// view
+//------------------------------------------------------------------------------
+void manager_component_view_1(auto& s) {
+    eagitest::case_ test{s, 31, "view"};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    mgr.register_component_storage<eagine::ecs::flat_map_cmp_storage, counter>();
+    mgr.register_component_storage<eagine::ecs::std_map_cmp_storage, greeting>();
+
+    for(eagine::identifier_t e = 1; e <= 100; ++e) {
+        mgr.add(e, counter{});
+        if(e % 2U == 0U) {
+            mgr.add(e, greeting{"hi"});
+        }
+    }
+
+    auto v{mgr.view<counter, const greeting>()};
+    test.check_equal(v.size(), std::size_t(50U), "initial");
+    test.check(v.contains(2U), "contains 2");
+    test.check(not v.contains(3U), "not contains 3");
+
+    mgr.add(eagine::identifier_t(3U), greeting{"hey"});
+    test.check(v.contains(3U), "added 3");
+    mgr.hide<greeting>(4U);
+    test.check(not v.contains(4U), "hidden 4");
+    mgr.show<greeting>(4U);
+    test.check(v.contains(4U), "shown 4");
+    mgr.remove<counter>(6U);
+    test.check(not v.contains(6U), "removed 6");
+    mgr.forget(8U);
+    test.check(not v.contains(8U), "forgotten 8");
+    test.check_equal(v.size(), std::size_t(49U), "changed");
+
+    const auto ents{v.entities()};
+    test.check(std::is_sorted(ents.begin(), ents.end()), "sorted");
+
+    int count{0};
+    v.for_each([&](const auto e, auto& c, auto& g) {
+        test.check(not g.read().expression.empty(), "greeting");
+        c.write().value += 1;
+        if(e % 10U == 0U) {
+            c.remove();
+        }
+        ++count;
+    });
+    test.check_equal(count, 49, "count");
+    test.check_equal(v.size(), std::size_t(39U), "after remove");
+
+    auto w{mgr.view<const greeting, const counter>()};
+    test.check_equal(w.size(), std::size_t(39U), "shared");
+    int sum{0};
+    w.for_each([&](const auto, auto&, auto& c) { sum += c.read().value; });
+    test.check_equal(sum, 39, "sum");
+
+    for(int i = 0; i < 3; ++i) {
+        v.for_each([](const auto, auto& c, auto&) { c.write().value += 1; });
+    }
+    sum = 0;
+    w.for_each([&](const auto, auto&, auto& c) { sum += c.read().value; });
+    test.check_equal(sum, 39 * 4, "repeated");
+
+    count = 0;
+    v.for_each([&](const auto e, auto& c, auto&) {
+        if(count++ == 0) {
+            mgr.add(eagine::identifier_t(1001U), counter{});
+        }
+        if(e % 4U == 0U) {
+            c.remove();
+        }
+    });
+    test.check_equal(count, 39, "changed in pass");
+    test.check(v.contains(2U), "kept 2");
+    test.check(not v.contains(4U), "removed 4");
+    test.check(not v.contains(12U), "removed 12");
+
+    const auto before{v.size()};
+    for(eagine::identifier_t e = 2001; e <= 2200; ++e) {
+        mgr.add(e, counter{});
+        mgr.add(e, greeting{"hi"});
+    }
+    test.check_equal(v.size(), before + 200U, "many added");
+    test.check(v.contains(2200U), "contains 2200");
+
+    mgr.unregister_component_type<greeting>();
+    test.check_equal(v.size(), std::size_t(0U), "unregistered");
+    mgr.register_component_storage<eagine::ecs::std_map_cmp_storage, greeting>();
+    mgr.add(eagine::identifier_t(5U), greeting{"hello"});
+    test.check_equal(v.size(), std::size_t(1U), "registered");
+    test.check(v.contains(5U), "re-added 5");
+}
+//------------------------------------------------------------------------------
+// change tracking
+//------------------------------------------------------------------------------
+void manager_component_changes_1(auto& s) {
+    eagitest::case_ test{s, 32, "change tracking"};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    mgr.register_component_storage<eagine::ecs::flat_map_cmp_storage, counter>();
+    mgr
+      .register_component_storage<eagine::ecs::sparse_set_cmp_storage, greeting>();
+    mgr.track_changes();
+    test.check(mgr.tracks_changes(), "tracks");
+
+    for(eagine::identifier_t e = 1; e <= 100; ++e) {
+        mgr.add(e, counter{}, greeting{"hi"});
+    }
+    const auto changed_since = [&]<typename Component>(
+                                 std::type_identity<Component>,
+                                 eagine::ecs::change_tick_t tick) {
+        std::vector<eagine::identifier_t> result;
+        mgr.for_each_changed_since<const Component>(
+          tick, [&](const auto e, auto&) { result.push_back(e); });
+        return result;
+    };
+    const std::type_identity<counter> c;
+    const std::type_identity<greeting> g;
+
+    auto tick{mgr.change_tick()};
+    test.check_equal(changed_since(c, tick).size(), std::size_t(100U), "added");
+    tick = mgr.advance_change_tick();
+    test.check(changed_since(c, tick).empty(), "none");
+
+    mgr.read_each<counter>([](const auto, auto&) {});
+    test.check(changed_since(c, tick).empty(), "read");
+
+    mgr.for_each_with<counter, const greeting>(
+      [](const auto e, auto& cm, auto&) {
+          if(e % 10U == 0U) {
+              cm.write().value += 1;
+          }
+      });
+    test.check_equal(changed_since(c, tick).size(), std::size_t(100U), "join");
+    test.check(changed_since(g, tick).empty(), "const join");
+
+    tick = mgr.advance_change_tick();
+    mgr.mark_changed<greeting>(7U);
+    mgr.mark_changed<greeting>(3U);
+    mgr.write_each<counter>([](const auto e, auto& cm) {
+        if(e > 90U) {
+            cm.remove();
+        }
+    });
+    const auto greetings{changed_since(g, tick)};
+    test.check(
+      greetings == std::vector<eagine::identifier_t>{3U, 7U}, "marked");
+    test.check_equal(changed_since(c, tick).size(), std::size_t(90U), "write");
+
+    tick = mgr.advance_change_tick();
+    mgr.hide<counter>(5U);
+    test.check(changed_since(c, tick).empty(), "hidden");
+    mgr.show<counter>(5U);
+    test.check(
+      changed_since(c, tick) == std::vector<eagine::identifier_t>{5U}, "shown");
+
+    for(int i = 0; i < 50; ++i) {
+        tick = mgr.advance_change_tick();
+        mgr.write_each<greeting>([](const auto, auto&) {});
+    }
+    test.check_equal(changed_since(g, tick).size(), std::size_t(100U), "many");
+    test.check_equal(changed_since(g, 0U).size(), std::size_t(100U), "all");
+
+    tick = mgr.advance_change_tick();
+    mgr.mark_changed<counter>(2U);
+    mgr.for_each_changed_since<counter>(
+      0U, [](const auto, auto& cm) { cm.write().value += 1; });
+    test.check(
+      changed_since(c, tick) == std::vector<eagine::identifier_t>{2U},
+      "not re-recorded");
+
+    mgr.register_relation_storage<eagine::ecs::flat_map_rel_storage, father>();
+    mgr.ensure<father>(1U, 2U);
+    mgr.ensure<father>(3U, 2U);
+    mgr.ensure<father>(3U, 4U);
+    tick = mgr.advance_change_tick();
+    std::vector<eagine::identifier_t> subjects;
+    const auto changed_subjects{[&](
+                                  const eagine::identifier_t subject,
+                                  const eagine::identifier_t,
+                                  auto&) { subjects.push_back(subject); }};
+    mgr.for_each_changed_since<father>(tick, changed_subjects);
+    test.check(subjects.empty(), "relations unchanged");
+
+    const auto remove_first{[](
+                              const eagine::identifier_t subject,
+                              const eagine::identifier_t,
+                              auto& rel) {
+        if(subject == 1U) {
+            rel.remove();
+        }
+    }};
+    mgr.for_each<father>(
+      eagine::callable_ref<void(
+        const eagine::identifier_t,
+        const eagine::identifier_t,
+        eagine::ecs::manipulator<father>&)>{
+        eagine::construct_from, remove_first});
+    mgr.for_each_changed_since<father>(tick, changed_subjects);
+    test.check(
+      subjects == std::vector<eagine::identifier_t>{3U, 3U},
+      "relations changed");
+}
+//------------------------------------------------------------------------------
+// component signals
+//------------------------------------------------------------------------------
+void manager_component_signals_1(auto& s) {
+    eagitest::case_ test{s, 33, "component signals"};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    mgr.register_component_storage<eagine::ecs::flat_map_cmp_storage, counter>();
+    mgr
+      .register_component_storage<eagine::ecs::sparse_set_cmp_storage, greeting>();
+
+    std::set<eagine::identifier_t> present;
+    int calls{0};
+    const auto on_added{[&](eagine::identifier_t e) noexcept {
+        present.insert(e);
+        ++calls;
+    }};
+    const auto on_removed{[&](eagine::identifier_t e) noexcept {
+        present.erase(e);
+        ++calls;
+    }};
+    auto& counter_signals{mgr.component_signals<counter>()};
+    counter_signals.added.connect({eagine::construct_from, on_added});
+    counter_signals.removed.connect({eagine::construct_from, on_removed});
+    counter_signals.hidden.connect({eagine::construct_from, on_removed});
+    counter_signals.shown.connect({eagine::construct_from, on_added});
+    test.check(not counter_signals.is_batched(), "not batched");
+
+    for(eagine::identifier_t e = 1; e <= 50; ++e) {
+        mgr.add(e, counter{}, greeting{"hi"});
+    }
+    test.check_equal(present.size(), std::size_t(50U), "added");
+    test.check_equal(calls, 50, "added calls");
+    mgr.remove<counter>(3U);
+    mgr.hide<counter>(5U);
+    mgr.show<greeting>(5U);
+    mgr.write_each<counter>([](const auto e, auto& cm) {
+        if(e % 10U == 0U) {
+            cm.remove();
+        }
+    });
+    test.check_equal(present.size(), std::size_t(43U), "removed");
+    test.check(not present.contains(3U), "3 removed");
+    test.check(not present.contains(5U), "5 hidden");
+    mgr.show<counter>(5U);
+    test.check(present.contains(5U), "5 shown");
+
+    std::set<eagine::identifier_t> greeted;
+    std::vector<eagine::identifier_t> events;
+    int batches{0};
+    const auto on_added_batch{
+      [&](std::span<const eagine::identifier_t> entities) noexcept {
+          greeted.insert(entities.begin(), entities.end());
+          events.insert(events.end(), entities.begin(), entities.end());
+          ++batches;
+      }};
+    const auto on_removed_batch{
+      [&](std::span<const eagine::identifier_t> entities) noexcept {
+          for(const auto e : entities) {
+              greeted.erase(e);
+          }
+          events.insert(events.end(), entities.begin(), entities.end());
+          ++batches;
+      }};
+    auto& greeting_signals{mgr.component_signals<const greeting>().batched()};
+    greeting_signals.added_batch.connect(
+      {eagine::construct_from, on_added_batch});
+    greeting_signals.removed_batch.connect(
+      {eagine::construct_from, on_removed_batch});
+    test.check(greeting_signals.is_batched(), "batched");
+
+    for(eagine::identifier_t e = 51; e <= 60; ++e) {
+        mgr.add(e, greeting{"hello"});
+    }
+    mgr.remove<greeting>(55U);
+    mgr.remove<greeting>(56U);
+    mgr.add(55U, greeting{"again"});
+    test.check_equal(batches, 0, "pending");
+    test.check(greeted.empty(), "not delivered");
+
+    mgr.flush_component_signals();
+    test.check_equal(batches, 3, "batches");
+    test.check_equal(events.size(), std::size_t(13U), "events");
+    test.check_equal(greeted.size(), std::size_t(9U), "delivered");
+    test.check(greeted.contains(55U), "55 re-added");
+    test.check(not greeted.contains(56U), "56 removed");
+    test.check_equal(present.size(), std::size_t(44U), "other unaffected");
+
+    mgr.flush_component_signals();
+    test.check_equal(batches, 3, "nothing pending");
+}
+//------------------------------------------------------------------------------
+// command buffer
+//------------------------------------------------------------------------------
+void manager_command_buffer_1(auto& s) {
+    eagitest::case_ test{s, 34, "command buffer"};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    mgr.register_component_storage<eagine::ecs::flat_map_cmp_storage, counter>();
+    mgr
+      .register_component_storage<eagine::ecs::sparse_set_cmp_storage, greeting>();
+    mgr.register_relation_storage<eagine::ecs::flat_map_rel_storage, father>();
+
+    const auto count{[&]<typename Component>(std::type_identity<Component>) {
+        std::size_t result{0U};
+        mgr.read_each<Component>([&](const auto, auto&) { ++result; });
+        return result;
+    }};
+    const std::type_identity<counter> c;
+    const std::type_identity<greeting> g;
+
+    std::vector<eagine::identifier_t> entities;
+    for(int i = 0; i < 20; ++i) {
+        entities.push_back(mgr.spawn());
+        mgr.add(entities.back(), counter{});
+    }
+
+    eagine::ecs::command_buffer<eagine::identifier_t> commands;
+    test.check(commands.empty(), "empty");
+    mgr.read_each<counter>([&](const auto e, auto&) {
+        if(e % 2U == 0U) {
+            commands.remove<counter>(e);
+        } else {
+            commands.add(e, greeting{"hi"});
+        }
+        const auto child{commands.spawn()};
+        commands.add(child, counter{}).add(child, e, father{});
+    });
+    test.check_equal(commands.size(), std::size_t(80U), "recorded");
+    test.check_equal(count(c), std::size_t(20U), "not applied");
+
+    mgr.apply(commands);
+    test.check(commands.empty(), "cleared");
+    test.check_equal(count(c), std::size_t(30U), "counters");
+    test.check_equal(count(g), std::size_t(10U), "greetings");
+    std::size_t children{0U};
+    const auto check_child{[&](
+                             const eagine::identifier_t child,
+                             const eagine::identifier_t parent,
+                             auto&) {
+        test.check(mgr.has<counter>(child), "child counter");
+        test.check(not mgr.has<greeting>(child), "child greeting");
+        test.check(
+          std::find(entities.begin(), entities.end(), parent) !=
+            entities.end(),
+          "father");
+        ++children;
+    }};
+    mgr.for_each<father>(
+      eagine::callable_ref<void(
+        const eagine::identifier_t,
+        const eagine::identifier_t,
+        eagine::ecs::manipulator<father>&)>{
+        eagine::construct_from, check_child});
+    test.check_equal(children, std::size_t(20U), "children");
+
+    const auto e{entities.front()};
+    commands.add(e, counter{}).hide<counter>(e).forget(e).add(e, greeting{"a"});
+    commands.add(e, greeting{"b"}).remove<greeting>(e).show<counter>(e);
+    mgr.apply(commands);
+    test.check(not mgr.has<counter>(e), "forgotten");
+    test.check(not mgr.is_hidden<counter>(e), "not hidden");
+    test.check(not mgr.has<greeting>(e), "removed");
+    test.check_equal(count(c), std::size_t(29U), "counters after forget");
+
+    std::vector<eagine::ecs::command_buffer<eagine::identifier_t>> buffers(4U);
+    {
+        std::vector<std::thread> threads;
+        for(std::size_t t = 0; t < buffers.size(); ++t) {
+            threads.emplace_back([&buffers, t] {
+                for(int i = 0; i < 250; ++i) {
+                    const auto spawned{buffers[t].spawn()};
+                    buffers[t].add(
+                      spawned, counter{}, greeting{std::to_string(t)});
+                }
+            });
+        }
+        for(auto& thread : threads) {
+            thread.join();
+        }
+    }
+    mgr.apply(buffers);
+    test.check_equal(count(c), std::size_t(1029U), "parallel counters");
+    test.check_equal(count(g), std::size_t(1009U), "parallel greetings");
+}
+//------------------------------------------------------------------------------
+// snapshot
+//------------------------------------------------------------------------------
+void manager_snapshot_1(auto& s) {
+    eagitest::case_ test{s, 35, "snapshot"};
+
+    const auto register_storages{
+      [](eagine::ecs::basic_manager<eagine::identifier_t>& mgr) {
+          mgr.register_component_storage<
+            eagine::ecs::flat_map_cmp_storage,
+            counter>();
+          mgr.register_component_storage<
+            eagine::ecs::sparse_set_cmp_storage,
+            greeting>();
+          mgr.register_component_storage<
+            eagine::ecs::std_map_cmp_storage,
+            person>();
+          mgr.register_relation_storage<
+            eagine::ecs::flat_map_rel_storage,
+            father>();
+      }};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> original;
+    register_storages(original);
+    std::vector<eagine::identifier_t> entities;
+    for(int i = 0; i < 100; ++i) {
+        const auto e{original.spawn()};
+        counter c{};
+        c.value = i;
+        original.add(e, std::move(c), person{"Jane", "Doe"});
+        if(i % 2 == 0) {
+            original.add(e, greeting{std::to_string(i)});
+        }
+        if(not entities.empty()) {
+            original.add(e, entities.back(), father{});
+        }
+        entities.push_back(e);
+    }
+    original.forget(entities[10]);
+    original.hide<counter>(entities[20]);
+    original.hide<greeting>(entities[30]);
+
+    std::stringstream snapshot;
+    test.check(original.save_snapshot(snapshot), "saved");
+    const std::string data{snapshot.str()};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> loaded;
+    register_storages(loaded);
+    test.check(eagine::ecs::load_snapshot(snapshot, loaded), "loaded");
+
+    std::size_t counters{0U};
+    loaded.read_each<counter>([&](const auto e, auto& c) {
+        test.check_equal(
+          e, entities[std::size_t(c.read().value)], "counter entity");
+        ++counters;
+    });
+    test.check_equal(counters, std::size_t(98U), "counters");
+    test.check(not loaded.has<counter>(entities[10]), "forgotten");
+    test.check(loaded.is_hidden<counter>(entities[20]), "hidden");
+    loaded.show<counter>(entities[20]);
+    test.check_equal(
+      loaded.get(&counter::value, entities[20]), 20, "shown counter");
+
+    std::size_t greetings{0U};
+    loaded.read_each<greeting>([&](const auto e, auto& g) {
+        const auto i{std::stoi(g.read().expression)};
+        test.check_equal(e, entities[std::size_t(i)], "greeting entity");
+        ++greetings;
+    });
+    test.check_equal(greetings, std::size_t(48U), "greetings");
+    test.check(loaded.is_hidden<greeting>(entities[30]), "hidden greeting");
+    loaded.show<greeting>(entities[30]);
+    test.check(
+      loaded.get(&greeting::expression, entities[30]) == "30",
+      "shown greeting");
+    test.check(not loaded.has<person>(entities[1]), "not snapshot data");
+
+    std::size_t fathers{0U};
+    const auto check_father{[&](
+                              const eagine::identifier_t child,
+                              const eagine::identifier_t parent,
+                              auto&) {
+        test.check(original.has<father>(child, parent), "father");
+        ++fathers;
+    }};
+    loaded.for_each<father>(
+      eagine::callable_ref<void(
+        const eagine::identifier_t,
+        const eagine::identifier_t,
+        eagine::ecs::manipulator<father>&)>{
+        eagine::construct_from, check_father});
+    test.check_equal(fathers, std::size_t(99U), "fathers");
+
+    test.check_equal(loaded.spawn(), original.spawn(), "spawn");
+    test.check(not bool(loaded.is_alive(entities[10])), "not alive");
+    test.check(bool(loaded.is_alive(entities[11])), "alive");
+
+    eagine::ecs::basic_manager<eagine::identifier_t> partial;
+    partial.register_component_storage<eagine::ecs::flat_map_cmp_storage, counter>();
+    std::stringstream complete{data};
+    test.check(partial.load_snapshot(complete), "partial");
+    std::size_t partial_counters{0U};
+    partial.read_each<counter>([&](const auto, auto&) { ++partial_counters; });
+    test.check_equal(partial_counters, std::size_t(98U), "partial counters");
+
+    eagine::ecs::basic_manager<eagine::identifier_t> widened;
+    widened.register_component_storage<
+      eagine::ecs::flat_map_cmp_storage,
+      wide_counter>();
+    std::stringstream narrow{data};
+    test.check(not widened.load_snapshot(narrow), "other layout");
+
+    eagine::ecs::basic_manager<eagine::identifier_t> truncated;
+    register_storages(truncated);
+    std::stringstream incomplete{data.substr(0U, data.size() / 2U)};
+    test.check(not truncated.load_snapshot(incomplete), "truncated");
+    std::stringstream garbage{std::string(64U, 'x')};
+    test.check(not truncated.load_snapshot(garbage), "garbage");
+
+    std::string oversized{data.substr(0U, sizeof(eagine::ecs::snapshot_header))};
+    const eagine::ecs::snapshot_section_header huge{
+      .kind = eagine::ecs::snapshot_section::entities,
+      .uid = 0U,
+      .size = std::uint64_t(1U) << 60U};
+    oversized.append(reinterpret_cast<const char*>(&huge), sizeof(huge));
+    oversized.append(64U, 'x');
+    std::stringstream lying{oversized};
+    test.check(not truncated.load_snapshot(lying), "oversized");
+
+    std::stringstream again{data};
+    test.check(partial.load_snapshot(again), "reloaded");
+    partial_counters = 0U;
+    partial.read_each<counter>([&](const auto, auto&) { ++partial_counters; });
+    test.check_equal(partial_counters, std::size_t(98U), "kept counters");
+}
+//------------------------------------------------------------------------------
+// mapped storage
+//------------------------------------------------------------------------------
+void manager_mapped_storage_1(auto& s) {
+    eagitest::case_ test{s, 36, "mapped storage"};
+
+    const auto path{
+      std::filesystem::temp_directory_path() / "eagine-ecs-mapped-test.bin"};
+    {
+        eagine::ecs::basic_manager<eagine::identifier_t> original;
+        original.register_component_storage<
+          eagine::ecs::flat_map_cmp_storage,
+          counter>();
+        for(eagine::identifier_t e = 1; e <= 1000; ++e) {
+            if(e % 3U == 0U) {
+                counter c{};
+                c.value = int(e);
+                original.add(e, std::move(c));
+            }
+        }
+        std::ofstream output{path, std::ios::binary};
+        test.check(original.save_snapshot(output), "saved");
+    }
+
+    eagine::shared_holder<eagine::ecs::snapshot_mapping> mapping{
+      eagine::hold<eagine::ecs::snapshot_mapping>, path};
+    test.check(mapping->is_open(), "mapped");
+    eagine::ecs::mapped_cmp_storage<eagine::identifier_t, wide_counter> wide{
+      mapping};
+    test.check(not wide.is_valid(), "other layout");
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    mgr.register_component_storage<eagine::ecs::mapped_cmp_storage, counter>(
+      mapping);
+    mgr.register_component_storage<eagine::ecs::std_map_cmp_storage, greeting>();
+    test.check(
+      not mgr.component_storage_can<counter>(
+        eagine::ecs::storage_cap_bit::store),
+      "cannot store");
+
+    test.check(mgr.has<counter>(eagine::identifier_t(3U)), "has 3");
+    test.check(mgr.has<counter>(eagine::identifier_t(999U)), "has 999");
+    test.check(not mgr.has<counter>(eagine::identifier_t(4U)), "has not 4");
+
+    int sum{0};
+    std::size_t count{0U};
+    mgr.read_each<counter>([&](const auto e, auto& c) {
+        test.check_equal(eagine::identifier_t(c.read().value), e, "value");
+        sum += c.read().value;
+        ++count;
+    });
+    test.check_equal(count, std::size_t(333U), "count");
+    test.check_equal(sum, 166833, "sum");
+
+    for(eagine::identifier_t e = 1; e <= 1000; ++e) {
+        if(e % 5U == 0U) {
+            mgr.add(e, greeting{"hi"});
+        }
+    }
+    std::vector<eagine::identifier_t> visited;
+    mgr.for_each_with<const counter, const greeting>(
+      [&](const auto e, auto& c, auto&) {
+          test.check_equal(eagine::identifier_t(c.read().value), e, "joined");
+          visited.push_back(e);
+      });
+    test.check_equal(visited.size(), std::size_t(66U), "join count");
+    test.check(std::is_sorted(visited.begin(), visited.end()), "sorted");
+
+    mgr.add(eagine::identifier_t(4U), counter{});
+    test.check(not mgr.has<counter>(eagine::identifier_t(4U)), "not stored");
+    mgr.remove<counter>(eagine::identifier_t(3U));
+    test.check(mgr.has<counter>(eagine::identifier_t(3U)), "not removed");
+
+    std::stringstream resaved;
+    test.check(mgr.save_snapshot(resaved), "resaved");
+    eagine::ecs::basic_manager<eagine::identifier_t> loaded;
+    loaded.register_component_storage<
+      eagine::ecs::flat_map_cmp_storage,
+      counter>();
+    test.check(loaded.load_snapshot(resaved), "loaded");
+    std::size_t loaded_count{0U};
+    loaded.read_each<counter>([&](const auto, auto&) { ++loaded_count; });
+    test.check_equal(loaded_count, std::size_t(333U), "loaded count");
+
+    std::filesystem::remove(path);
+}
+//------------------------------------------------------------------------------
+// add bulk
+//------------------------------------------------------------------------------
+void manager_add_bulk_1(auto& s) {
+    eagitest::case_ test{s, 37, "add bulk"};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    mgr.register_component_storage<eagine::ecs::flat_map_cmp_storage, counter>();
+    mgr.register_component_storage<eagine::ecs::std_map_cmp_storage, greeting>();
+
+    for(eagine::identifier_t e = 10; e <= 1000; e += 10) {
+        counter c{};
+        c.value = -1;
+        mgr.add(e, std::move(c), greeting{"old"});
+    }
+    mgr.hide<counter>(eagine::identifier_t(500U));
+
+    std::vector<eagine::identifier_t> entities;
+    std::vector<counter> counters;
+    std::vector<greeting> greetings;
+    for(eagine::identifier_t i = 0; i < 1000; ++i) {
+        const auto e{eagine::identifier_t((i * 7919U) % 1000U + 1U)};
+        entities.push_back(e);
+        counter c{};
+        c.value = int(e);
+        counters.push_back(c);
+        greetings.emplace_back("new");
+    }
+    entities.push_back(eagine::identifier_t(1U));
+    counters.emplace_back();
+    greetings.emplace_back("repeated");
+
+    mgr.add_bulk<counter>(entities, counters);
+    mgr.add_bulk<greeting>(entities, greetings);
+
+    std::size_t count{0U};
+    eagine::identifier_t prev{0U};
+    mgr.read_each<counter>([&](const auto e, auto& c) {
+        test.check(prev < e, "sorted");
+        if((e % 10U == 0U) and (e != 500U)) {
+            test.check_equal(c.read().value, -1, "kept");
+        } else {
+            test.check_equal(eagine::identifier_t(c.read().value), e, "added");
+        }
+        prev = e;
+        ++count;
+    });
+    test.check_equal(count, std::size_t(1000U), "counters");
+    test.check(not mgr.is_hidden<counter>(eagine::identifier_t(500U)), "shown");
+
+    count = 0U;
+    mgr.read_each<greeting>([&](const auto e, auto& g) {
+        if(e % 10U == 0U) {
+            test.check(g.read().expression == "old", "kept greeting");
+        } else {
+            test.check(g.read().expression == "new", "added greeting");
+        }
+        ++count;
+    });
+    test.check_equal(count, std::size_t(1000U), "greetings");
+
+    std::size_t joined{0U};
+    mgr.for_each_with<const counter, const greeting>(
+      [&](const auto, auto&, auto&) { ++joined; });
+    test.check_equal(joined, std::size_t(1000U), "joined");
+}
+//------------------------------------------------------------------------------
+// removal during iteration
+//------------------------------------------------------------------------------
+void manager_deferred_removal_1(auto& s) {
+    eagitest::case_ test{s, 38, "removal during iteration"};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    mgr.register_component_storage<eagine::ecs::flat_map_cmp_storage, counter>();
+    mgr.register_relation_storage<
+      eagine::ecs::flat_map_indexed_rel_storage,
+      father>();
+
+    for(eagine::identifier_t e = 1; e <= 10000; ++e) {
+        counter c{};
+        c.value = int(e);
+        mgr.add(e, std::move(c));
+        mgr.add(e, e % 10U + 1U, father{});
+    }
+    mgr.hide<counter>(eagine::identifier_t(5000U));
+
+    std::size_t removed{0U};
+    mgr.write_each<counter>([&](const auto e, auto& c) {
+        test.check_equal(eagine::identifier_t(c.read().value), e, "value");
+        c.write().value += 1;
+        if(e % 10U < 3U) {
+            c.remove();
+            ++removed;
+        }
+    });
+    test.check_equal(removed, std::size_t(2999U), "removed");
+
+    std::size_t kept{0U};
+    eagine::identifier_t prev{0U};
+    mgr.read_each<counter>([&](const auto e, auto& c) {
+        test.check(e % 10U >= 3U, "kept");
+        test.check(prev < e, "sorted");
+        test.check_equal(
+          eagine::identifier_t(c.read().value), e + 1U, "modified");
+        prev = e;
+        ++kept;
+    });
+    test.check_equal(kept, std::size_t(7000U), "kept count");
+    test.check(not mgr.has<counter>(eagine::identifier_t(10U)), "has not");
+    test.check(mgr.has<counter>(eagine::identifier_t(13U)), "has");
+    test.check(mgr.is_hidden<counter>(eagine::identifier_t(5000U)), "hidden");
+
+    const auto remove_odd{[](
+                            const eagine::identifier_t subject,
+                            const eagine::identifier_t,
+                            auto& rel) {
+        if(subject % 2U == 1U) {
+            rel.remove();
+        }
+    }};
+    mgr.for_each<father>(
+      eagine::callable_ref<void(
+        const eagine::identifier_t,
+        const eagine::identifier_t,
+        eagine::ecs::manipulator<father>&)>{
+        eagine::construct_from, remove_odd});
+
+    std::size_t fathers{0U};
+    const auto count_fathers{[&](
+                               const eagine::identifier_t subject,
+                               const eagine::identifier_t object,
+                               auto&) {
+        test.check_equal(subject % 2U, eagine::identifier_t(0U), "even");
+        test.check_equal(object, subject % 10U + 1U, "object");
+        ++fathers;
+    }};
+    mgr.for_each<father>(
+      eagine::callable_ref<void(
+        const eagine::identifier_t,
+        const eagine::identifier_t,
+        eagine::ecs::manipulator<const father>&)>{
+        eagine::construct_from, count_fathers});
+    test.check_equal(fathers, std::size_t(5000U), "fathers");
+
+    std::size_t subjects{0U};
+    mgr.for_each_subject_of<father>(
+      eagine::identifier_t(1U),
+      {eagine::construct_from,
+       [&](const eagine::identifier_t subject, const eagine::identifier_t) {
+           test.check_equal(subject % 10U, eagine::identifier_t(0U), "subject");
+           ++subjects;
+       }});
+    test.check_equal(subjects, std::size_t(1000U), "subjects");
+    std::size_t odd_subjects{0U};
+    mgr.for_each_subject_of<father>(
+      eagine::identifier_t(2U),
+      {eagine::construct_from,
+       [&](const eagine::identifier_t, const eagine::identifier_t) {
+           ++odd_subjects;
+       }});
+    test.check_equal(odd_subjects, std::size_t(0U), "unindexed");
+}
+//------------------------------------------------------------------------------
+// spawn / explicit entities
+//------------------------------------------------------------------------------
+void manager_component_spawn_known_1(auto& s) {
+    eagitest::case_ test{s, 39, "spawn skips known"};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    mgr.register_component_storage<eagine::ecs::flat_map_cmp_storage, counter>();
+
+    std::set<eagine::identifier_t> stored;
+    for(eagine::identifier_t e = 1U; e <= 5U; ++e) {
+        mgr.add(e, counter{});
+        stored.insert(e);
+    }
+    mgr.add(eagine::id_v("luke"), counter{});
+    stored.insert(eagine::id_v("luke"));
+
+    for(int i = 0; i < 20; ++i) {
+        const auto e{mgr.spawn()};
+        test.check(not mgr.knows(e), "not known");
+        test.check(not stored.contains(e), "not stored");
+        mgr.add(e, counter{});
+        stored.insert(e);
+    }
+    std::size_t count{0U};
+    mgr.read_each<counter>([&](const auto, auto&) { ++count; });
+    test.check_equal(count, std::size_t(26U), "count");
+
+    eagine::ecs::generational_entity_allocator<std::uint32_t, 16> alloc;
+    std::size_t probes{0U};
+    const auto probe{[&](std::uint32_t e) {
+        ++probes;
+        return e == 2U;
+    }};
+    const auto e1{alloc.allocate(probe)};
+    const auto e3{alloc.allocate(probe)};
+    test.check_equal(e1, std::uint32_t(1U), "first");
+    test.check_equal(e3, std::uint32_t(3U), "skipped 2");
+    test.check_equal(probes, std::size_t(3U), "probed new");
+    alloc.release(e1);
+    alloc.allocate(probe);
+    alloc.allocate(probe);
+    test.check_equal(probes, std::size_t(3U), "recycled not probed");
+}
+//------------------------------------------------------------------------------
 // main
 //------------------------------------------------------------------------------
 auto test_main(eagine::test_ctx& ctx) -> int {
-    eagitest::ctx_suite test{ctx, "manager", 24};
+    eagitest::ctx_suite test{ctx, "manager", 39};
     test.once(manager_component_register_1);
     test.once(manager_component_register_2);
     test.once(manager_component_write_has_1);
@@ -1266,6 +2459,21 @@ auto test_main(eagine::test_ctx& ctx) -> int {
     test.once(manager_component_remove_relation_1);
     test.once(manager_component_clear_1);
     test.once(manager_component_select_cross_1);
+    test.once(manager_component_for_each_direct_1);
+    test.once(manager_component_for_each_batch_1);
+    test.once(manager_component_spawn_forget_1);
+    test.once(manager_component_signatures_1);
+    test.once(manager_component_relation_subjects_1);
+    test.once(manager_component_sparse_join_1);
+    test.once(manager_component_view_1);
+    test.once(manager_component_changes_1);
+    test.once(manager_component_signals_1);
+    test.once(manager_command_buffer_1);
+    test.once(manager_snapshot_1);
+    test.once(manager_mapped_storage_1);
+    test.once(manager_add_bulk_1);
+    test.once(manager_deferred_removal_1);
+    test.once(manager_component_spawn_known_1);
     return test.exit_code();
 }
 //------------------------------------------------------------------------------
@@ -0,0 +1,355 @@
+/// @file
+///
+/// Distributed under the Boost Software License, Version 1.0.
+/// See accompanying file LICENSE_1_0.txt or copy at
+/// https://www.boost.org/LICENSE_1_0.txt
+///
+
+#include <eagine/testing/unit_begin_ctx.hpp>
+import std;
+import eagine.core;
+import eagine.ecs;
+//------------------------------------------------------------------------------
+struct position : eagine::ecs::component<"Position"> {
+    float value{0.F};
+};
+
+struct velocity : eagine::ecs::component<"Velocity"> {
+    float value{0.F};
+};
+//------------------------------------------------------------------------------
+static void populate(
+  eagine::ecs::basic_manager<eagine::identifier_t>& mgr,
+  eagine::identifier_t count) {
+    mgr
+      .register_component_storage<eagine::ecs::flat_map_cmp_storage, position>();
+    mgr
+      .register_component_storage<eagine::ecs::flat_map_cmp_storage, velocity>();
+    for(eagine::identifier_t e = 1; e <= count; ++e) {
+        mgr.ensure<position>(e).write().value = float(e);
+        if(e % 3U == 0U) {
+            mgr.ensure<velocity>(e).write().value = 2.F;
+        }
+    }
+}
+//------------------------------------------------------------------------------
+// worker pool
+//------------------------------------------------------------------------------
+void manager_parallel_worker_pool_1(auto& s) {
+    eagitest::case_ test{s, 1, "worker pool"};
+
+    eagine::ecs::worker_pool pool{3U};
+    test.check_equal(pool.thread_count(), std::size_t(4U), "thread count");
+
+    for(std::size_t count : {0U, 1U, 7U, 1000U}) {
+        std::vector<std::atomic<int>> hits(count);
+        const auto func{[&](std::size_t i) {
+            hits[i].fetch_add(1);
+        }};
+        pool.for_each_index(
+          count, eagine::callable_ref<void(std::size_t)>{
+                   eagine::construct_from, func});
+        for(const auto& hit : hits) {
+            test.check_equal(hit.load(), 1, "each once");
+        }
+    }
+
+    bool thrown{false};
+    try {
+        const auto func{[](std::size_t i) {
+            if(i == 42U) {
+                throw std::runtime_error("failed");
+            }
+        }};
+        pool.for_each_index(
+          100U, eagine::callable_ref<void(std::size_t)>{
+                  eagine::construct_from, func});
+    } catch(const std::runtime_error&) {
+        thrown = true;
+    }
+    test.check(thrown, "rethrown");
+}
+//------------------------------------------------------------------------------
+// read / write each
+//------------------------------------------------------------------------------
+void manager_parallel_read_write_1(auto& s) {
+    eagitest::case_ test{s, 2, "read/write each"};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    mgr.use_workers({eagine::hold<eagine::ecs::worker_pool>, 3U});
+    populate(mgr, 10000U);
+
+    mgr.parallel_write_each<position>([](const auto e, auto& p) {
+        p.write().value += float(e);
+    });
+
+    std::atomic<int> count{0};
+    std::atomic<int> wrong{0};
+    mgr.parallel_read_each<position>([&](const auto e, auto& p) {
+        if(p.read().value != float(2U * e)) {
+            wrong.fetch_add(1);
+        }
+        count.fetch_add(1);
+    });
+    test.check_equal(count.load(), 10000, "count");
+    test.check_equal(wrong.load(), 0, "values");
+}
+//------------------------------------------------------------------------------
+// removal
+//------------------------------------------------------------------------------
+void manager_parallel_remove_1(auto& s) {
+    eagitest::case_ test{s, 3, "remove"};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> par;
+    par.use_workers({eagine::hold<eagine::ecs::worker_pool>, 3U});
+    populate(par, 5000U);
+
+    eagine::ecs::basic_manager<eagine::identifier_t> seq;
+    populate(seq, 5000U);
+
+    const auto func{[](const auto e, auto& p) {
+        if(e % 7U == 0U) {
+            p.remove();
+        } else {
+            p.write().value *= 3.F;
+        }
+    }};
+    par.parallel_write_each<position>(func);
+    seq.write_each<position>(func);
+
+    for(eagine::identifier_t e = 1; e <= 5000U; ++e) {
+        test.check_equal(par.has<position>(e), seq.has<position>(e), "has");
+        if(seq.has<position>(e)) {
+            test.check_equal(
+              par.ensure<position>(e).read().value,
+              seq.ensure<position>(e).read().value,
+              "value");
+        }
+    }
+}
+//------------------------------------------------------------------------------
+// join
+//------------------------------------------------------------------------------
+void manager_parallel_join_1(auto& s) {
+    eagitest::case_ test{s, 4, "join"};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    mgr.use_workers({eagine::hold<eagine::ecs::worker_pool>, 3U});
+    mgr
+      .register_component_storage<eagine::ecs::flat_map_cmp_storage, position>();
+    mgr
+      .register_component_storage<eagine::ecs::flat_map_cmp_storage, velocity>();
+    for(eagine::identifier_t e = 1; e <= 3000U; ++e) {
+        mgr.ensure<position>(e).write().value = float(e);
+        mgr.ensure<velocity>(e).write().value = 2.F;
+    }
+
+    std::atomic<int> count{0};
+    mgr.parallel_for_each<position, const velocity>(
+      [&](const auto, auto& p, auto& v) {
+          p.write().value += v.read().value;
+          count.fetch_add(1);
+      });
+    test.check_equal(count.load(), 3000, "count");
+
+    bool ok{true};
+    mgr.read_each<position>([&](const auto e, auto& p) {
+        ok = ok and (p.read().value == float(e) + 2.F);
+    });
+    test.check(ok, "values");
+}
+//------------------------------------------------------------------------------
+// scheduler
+//------------------------------------------------------------------------------
+void manager_parallel_scheduler_stages_1(auto& s) {
+    eagitest::case_ test{s, 5, "scheduler stages"};
+
+    eagine::ecs::system_access rp;
+    rp.add<const position>();
+    eagine::ecs::system_access rp2;
+    rp2.add<const position>().add<velocity>();
+    eagine::ecs::system_access wp;
+    wp.add<position>();
+    eagine::ecs::system_access rv;
+    rv.add<const velocity>();
+
+    test.check(not rp.conflicts_with(rp2), "read/read");
+    test.check(rp.conflicts_with(wp), "read/write");
+    test.check(wp.conflicts_with(rp), "write/read");
+    test.check(rp2.conflicts_with(rv), "write/read 2");
+    test.check(not wp.conflicts_with(rv), "disjoint");
+
+    eagine::ecs::system_access ta;
+    ta.add<const position>().uses_archetypes(false);
+    eagine::ecs::system_access tb;
+    tb.add<velocity>().uses_archetypes(true);
+    test.check(ta.conflicts_with(tb), "archetypes");
+
+    eagine::ecs::system_access ba;
+    ba.add<const position>().buffered(position::uid());
+    eagine::ecs::system_access bb;
+    bb.add<position>().buffered(position::uid());
+    test.check(not ba.conflicts_with(bb), "buffered read/write");
+    test.check(bb.conflicts_with(bb), "buffered write/write");
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    mgr.use_workers({eagine::hold<eagine::ecs::worker_pool>, 3U});
+    populate(mgr, 100U);
+
+    eagine::ecs::basic_scheduler<eagine::identifier_t> sched{mgr};
+    const auto noop{[](const auto, auto&...) {}};
+    sched.add<const position>(noop);
+    sched.add<const position, const velocity>(noop);
+    sched.add<velocity>(noop);
+    sched.add<position>(noop);
+    sched.add<const velocity>(noop);
+    test.check_equal(sched.system_count(), std::size_t(5U), "systems");
+    sched.update();
+    test.check_equal(sched.stage_count(), std::size_t(3U), "stages");
+}
+//------------------------------------------------------------------------------
+void manager_parallel_scheduler_update_1(auto& s) {
+    eagitest::case_ test{s, 6, "scheduler update"};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    mgr.use_workers({eagine::hold<eagine::ecs::worker_pool>, 3U});
+    populate(mgr, 3000U);
+
+    std::atomic<int> reads{0};
+    eagine::ecs::basic_scheduler<eagine::identifier_t> sched{mgr};
+    sched.add<position, const velocity>([](const auto, auto& p, auto& v) {
+        p.write().value += v.read().value;
+    });
+    sched.add<const position>([&](const auto, auto&) { reads.fetch_add(1); });
+    sched.add<velocity>([](const auto, auto& v) { v.write().value *= 2.F; });
+    sched.add<const velocity>([&](const auto, auto&) { reads.fetch_add(1); });
+
+    sched.update();
+    sched.update();
+
+    test.check_equal(reads.load(), 2 * (3000 + 1000), "reads");
+
+    bool ok{true};
+    mgr.read_each<position>([&](const auto e, auto& p) {
+        const float expected{float(e) + ((e % 3U == 0U) ? 2.F + 4.F : 0.F)};
+        ok = ok and (p.read().value == expected);
+    });
+    test.check(ok, "values");
+}
+//------------------------------------------------------------------------------
+void manager_parallel_scheduler_readers_1(auto& s) {
+    eagitest::case_ test{s, 7, "scheduler readers"};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    mgr.use_workers({eagine::hold<eagine::ecs::worker_pool>, 3U});
+    populate(mgr, 300U);
+
+    eagine::ecs::basic_scheduler<eagine::identifier_t> sched{mgr};
+    sched.add<const position>([](const auto, auto& p) { p.remove(); });
+    sched.add<const position, const velocity>(
+      [](const auto, auto& p, auto& v) {
+          p.remove();
+          v.remove();
+      });
+    sched.add<velocity>([](const auto e, auto& v) {
+        if(e % 2U == 0U) {
+            v.remove();
+        }
+    });
+    sched.update();
+
+    std::size_t positions{0U};
+    mgr.read_each<position>([&](const auto, auto&) { ++positions; });
+    test.check_equal(positions, std::size_t(300U), "readers do not remove");
+
+    std::size_t velocities{0U};
+    mgr.read_each<velocity>([&](const auto, auto&) { ++velocities; });
+    test.check_equal(velocities, std::size_t(50U), "writers remove");
+}
+//------------------------------------------------------------------------------
+// storage blocks
+//------------------------------------------------------------------------------
+template <template <class, class> class Storage>
+static void check_blocks(auto& test, bool archetypes) {
+    eagine::ecs::basic_manager<eagine::identifier_t> mgr;
+    mgr.use_workers({eagine::hold<eagine::ecs::worker_pool>, 3U});
+    if(archetypes) {
+        mgr.register_archetype_storages<position, velocity>();
+    } else {
+        mgr.register_component_storage<Storage, position>();
+        mgr.register_component_storage<Storage, velocity>();
+    }
+    mgr.track_changes();
+    for(eagine::identifier_t e = 1; e <= 2000U; ++e) {
+        mgr.ensure<position>(e).write().value = float(e);
+        if(e % 2U == 0U) {
+            mgr.ensure<velocity>(e).write().value = 2.F;
+        }
+    }
+    mgr.hide<position>(eagine::identifier_t(3U));
+    const auto tick{mgr.advance_change_tick()};
+
+    std::atomic<int> count{0};
+    mgr.parallel_write_each<position>([&](const auto e, auto& p) {
+        p.write().value += 1.F;
+        if(e % 5U == 0U) {
+            p.remove();
+        }
+        count.fetch_add(1);
+    });
+    test.check_equal(count.load(), 1999, "count");
+
+    count = 0;
+    mgr.parallel_for_each<position, const velocity>(
+      [&](const auto, auto& p, auto& v) {
+          p.write().value += v.read().value;
+          count.fetch_add(1);
+      });
+    test.check_equal(count.load(), 800, "join count");
+
+    bool ok{true};
+    std::size_t remaining{0U};
+    mgr.read_each<position>([&](const auto e, auto& p) {
+        const auto expected{float(e) + (e % 2U == 0U ? 3.F : 1.F)};
+        ok = ok and (e % 5U != 0U) and (p.read().value == expected);
+        ++remaining;
+    });
+    test.check(ok, "values");
+    test.check_equal(remaining, std::size_t(1599U), "removed");
+
+    std::size_t changed{0U};
+    mgr.for_each_changed_since<position>(
+      tick, [&](const auto, auto&) { ++changed; });
+    test.check_equal(changed, std::size_t(1599U), "changes recorded");
+}
+
+void manager_parallel_blocks_1(auto& s) {
+    eagitest::case_ test{s, 8, "storage blocks"};
+
+    check_blocks<eagine::ecs::flat_map_cmp_storage>(test, false);
+    check_blocks<eagine::ecs::sparse_set_cmp_storage>(test, false);
+    check_blocks<eagine::ecs::chunk_map_cmp_storage>(test, false);
+    check_blocks<eagine::ecs::std_map_cmp_storage>(test, false);
+    check_blocks<eagine::ecs::flat_map_cmp_storage>(test, true);
+}
+//------------------------------------------------------------------------------
+// main
+//------------------------------------------------------------------------------
+auto test_main(eagine::test_ctx& ctx) -> int {
+    eagitest::ctx_suite test{ctx, "manager parallel", 8};
+    test.once(manager_parallel_worker_pool_1);
+    test.once(manager_parallel_read_write_1);
+    test.once(manager_parallel_remove_1);
+    test.once(manager_parallel_join_1);
+    test.once(manager_parallel_scheduler_stages_1);
+    test.once(manager_parallel_scheduler_update_1);
+    test.once(manager_parallel_scheduler_readers_1);
+    test.once(manager_parallel_blocks_1);
+    return test.exit_code();
+}
+//------------------------------------------------------------------------------
+auto main(int argc, const char** argv) -> int {
+    return eagine::test_main_impl(argc, argv, test_main);
+}
+//------------------------------------------------------------------------------
+#include <eagine/testing/unit_end_ctx.hpp>
@@ -0,0 +1,314 @@
+/// @file
+///
+/// Distributed under the Boost Software License, Version 1.0.
+/// See accompanying file LICENSE_1_0.txt or copy at
+/// https://www.boost.org/LICENSE_1_0.txt
+///
+
+#include <eagine/testing/unit_begin_ctx.hpp>
+import std;
+import eagine.core;
+import eagine.ecs;
+//------------------------------------------------------------------------------
+struct person : eagine::ecs::component<"Person"> {
+    person() noexcept = default;
+    person(std::string n, std::string fn) noexcept
+      : name{std::move(n)}
+      , family_name{std::move(fn)} {}
+
+    std::string name;
+    std::string family_name;
+};
+//------------------------------------------------------------------------------
+struct father : eagine::ecs::relation<"Father"> {};
+struct mother : eagine::ecs::relation<"Mother"> {};
+//------------------------------------------------------------------------------
+struct greeting : eagine::ecs::component<"Greeting"> {
+    greeting() noexcept = default;
+    greeting(std::string e) noexcept
+      : expression{std::move(e)} {}
+
+    std::string expression;
+};
+//------------------------------------------------------------------------------
+struct counter : eagine::ecs::component<"Counter"> {
+    int value{0};
+};
+//------------------------------------------------------------------------------
+using static_manager = eagine::ecs::static_manager<
+  eagine::identifier_t,
+  eagine::ecs::component_list<
+    person,
+    eagine::ecs::stored_in<eagine::ecs::sparse_set_cmp_storage, greeting>,
+    eagine::ecs::stored_in<eagine::ecs::std_map_cmp_storage, counter>>,
+  eagine::ecs::relation_list<father>>;
+//------------------------------------------------------------------------------
+// types
+//------------------------------------------------------------------------------
+void static_manager_types_1(auto& s) {
+    eagitest::case_ test{s, 1, "types"};
+
+    static_manager mgr;
+
+    test.check(mgr.knows_component_type<person>(), "person");
+    test.check(mgr.knows_component_type<greeting>(), "greeting");
+    test.check(mgr.knows_component_type<counter>(), "counter");
+    test.check(mgr.knows_relation_type<father>(), "father");
+    test.check(not mgr.knows_relation_type<mother>(), "mother");
+
+    static_assert(static_manager::knows_component_type<const person>());
+
+    test.check(
+      mgr.component_storage_can<greeting>(eagine::ecs::storage_cap_bit::store),
+      "can store");
+    test.check(
+      mgr.relation_storage_can<father>(eagine::ecs::storage_cap_bit::remove),
+      "can remove");
+}
+//------------------------------------------------------------------------------
+// add / has / remove
+//------------------------------------------------------------------------------
+void static_manager_add_has_remove_1(auto& s) {
+    eagitest::case_ test{s, 2, "add/has/remove"};
+
+    static_manager mgr;
+
+    const auto luke = eagine::id_v("luke");
+    const auto leia = eagine::id_v("leia");
+
+    test.check(not mgr.knows(luke), "not known");
+    mgr.add(luke, person{"Luke", "Skywalker"}, greeting{"Hi"});
+    mgr.ensure<counter>(leia).write().value = 42;
+
+    test.check(mgr.knows(luke), "known luke");
+    test.check(mgr.knows(leia), "known leia");
+    test.check((mgr.has_all<person, greeting>(luke)), "luke has all");
+    test.check(not mgr.has<counter>(luke), "luke has not counter");
+    test.check(mgr.has<counter>(leia), "leia has counter");
+    test.check(not mgr.has<person>(leia), "leia has not person");
+
+    test.check(mgr.get(&person::name, luke) == "Luke", "get name");
+    test.check(mgr.get(&counter::value, leia) == 42, "get value");
+    test.check(mgr.get(&counter::value, luke, -1) == -1, "get default");
+
+    mgr.copy<person>(luke, leia).write().name = "Leia";
+    test.check(mgr.get(&person::name, leia) == "Leia", "copied");
+    test.check(mgr.get(&person::name, luke) == "Luke", "original");
+
+    mgr.remove<person, greeting>(luke);
+    test.check(not mgr.has<person>(luke), "removed person");
+    test.check(not mgr.has<greeting>(luke), "removed greeting");
+    test.check(not mgr.knows(luke), "forgotten");
+}
+//------------------------------------------------------------------------------
+// read / write each
+//------------------------------------------------------------------------------
+void static_manager_each_1(auto& s) {
+    eagitest::case_ test{s, 3, "read/write each"};
+
+    static_manager mgr;
+
+    for(int i = 1; i <= 10; ++i) {
+        mgr.ensure<counter>(eagine::identifier_t(i)).write().value = i;
+    }
+
+    mgr.write_each<counter>([](const auto, auto& c) { c.write().value *= 2; });
+
+    int sum{0};
+    mgr.read_each<counter>([&](const auto e, auto& c) {
+        test.check_equal(c.read().value, int(e) * 2, "value");
+        sum += c.read().value;
+    });
+    test.check_equal(sum, 110, "sum");
+
+    mgr.write_each<counter>([](const auto e, auto& c) {
+        if(e % 2U == 0U) {
+            c.remove();
+        }
+    });
+
+    std::size_t count{0U};
+    mgr.for_each_with<const counter>([&](const auto e, auto&) {
+        test.check(e % 2U != 0U, "odd");
+        ++count;
+    });
+    test.check_equal(count, std::size_t(5U), "count");
+}
+//------------------------------------------------------------------------------
+// for each with
+//------------------------------------------------------------------------------
+void static_manager_for_each_with_1(auto& s) {
+    eagitest::case_ test{s, 4, "for-each-with"};
+    eagitest::track trck{test, 0, 2};
+
+    static_manager mgr;
+
+    for(int i = 1; i <= 20; ++i) {
+        const auto e{eagine::identifier_t(i)};
+        mgr.add(e, counter{});
+        if(i % 2 == 0) {
+            mgr.add(e, person{std::to_string(i), "Even"});
+        }
+        if(i % 3 == 0) {
+            mgr.add(e, greeting{"Fizz"});
+        }
+    }
+
+    std::set<eagine::identifier_t> visited;
+    mgr.for_each_with<counter, const person, const greeting>(
+      [&](const auto e, auto& c, auto& p, auto& g) {
+          test.check(p.read().name == std::to_string(e), "name");
+          test.check(g.read().expression == "Fizz", "expression");
+          c.write().value += 1;
+          visited.insert(e);
+          trck.checkpoint(1);
+      });
+    test.check(
+      (visited == std::set<eagine::identifier_t>{6U, 12U, 18U}), "visited");
+
+    mgr.for_each_with<const greeting, counter>(
+      [&](const auto e, auto& g, auto& c) {
+          test.check(g.read().expression == "Fizz", "greeting");
+          test.check_equal(c.read().value, e % 2U == 0U ? 1 : 0, "counter");
+          trck.checkpoint(2);
+      });
+
+    mgr.write<person, counter>(12U, [&](const auto, auto& p, auto& c) {
+        p.write().family_name = "Dozen";
+        c.write().value = 12;
+    });
+    bool found{false};
+    mgr.read<counter, person>(12U, [&](const auto, auto& c, auto& p) {
+        test.check(p.read().family_name == "Dozen", "family name");
+        test.check_equal(c.read().value, 12, "value");
+        found = true;
+    });
+    test.check(found, "found");
+
+    mgr.read<counter, person>(13U, [&](const auto, auto&, auto&) {
+        test.fail("no person");
+    });
+}
+//------------------------------------------------------------------------------
+// relations
+//------------------------------------------------------------------------------
+void static_manager_relation_1(auto& s) {
+    eagitest::case_ test{s, 5, "relations"};
+
+    static_manager mgr;
+
+    const auto luke = eagine::id_v("luke");
+    const auto leia = eagine::id_v("leia");
+    const auto vader = eagine::id_v("vader");
+
+    mgr.ensure<father>(luke, vader);
+    mgr.ensure<father>(leia, vader);
+
+    test.check(mgr.has<father>(luke, vader), "luke");
+    test.check(mgr.is<father>(vader, leia), "leia");
+    test.check(not mgr.has<father>(vader, luke), "vader");
+
+    std::size_t count{0U};
+    mgr.for_each_subject_of<father>(
+      vader,
+      {eagine::construct_from,
+       [&](eagine::identifier_t, eagine::identifier_t o) {
+           test.check(o == vader, "object");
+           ++count;
+       }});
+    test.check_equal(count, std::size_t(2U), "children");
+
+    mgr.remove_relation<father>(luke, vader);
+    test.check(not mgr.has<father>(luke, vader), "removed");
+    test.check(mgr.has<father>(leia, vader), "kept");
+}
+//------------------------------------------------------------------------------
+// spawn / forget
+//------------------------------------------------------------------------------
+void static_manager_spawn_forget_1(auto& s) {
+    eagitest::case_ test{s, 6, "spawn & forget"};
+
+    static_manager mgr;
+
+    const auto e1{mgr.spawn()};
+    const auto e2{mgr.spawn()};
+    test.check(e1 != e2, "unique");
+    mgr.add(e1, counter{}, greeting{"Hi"});
+    mgr.add(e2, counter{});
+
+    mgr.forget(e1);
+    test.check(not bool(mgr.is_alive(e1)), "forgotten");
+    test.check(not mgr.knows(e1), "not known");
+    test.check(mgr.has<counter>(e2), "kept");
+
+    const auto e3{mgr.spawn()};
+    test.check(e3 != e1, "new generation");
+    test.check(not mgr.has<counter>(e3), "not inherited");
+}
+//------------------------------------------------------------------------------
+// same code with both managers
+//------------------------------------------------------------------------------
+auto count_greeted(auto& mgr) -> int {
+    int result{0};
+    mgr.template for_each_with<const person, counter>(
+      [&](const auto e, auto& p, auto& c) {
+          c.write().value += 1;
+          result += int(p.read().name.size());
+          if(mgr.template has<greeting>(e)) {
+              ++result;
+          }
+      });
+    return result;
+}
+
+void static_manager_shared_api_1(auto& s) {
+    eagitest::case_ test{s, 7, "shared API"};
+
+    const auto populate{[](auto& mgr) {
+        mgr.add(eagine::id_v("a"), person{"Ann", "A"}, counter{});
+        mgr.add(eagine::id_v("b"), person{"Bob", "B"});
+        mgr.add(eagine::id_v("c"), counter{}, greeting{"Hi"});
+        mgr.add(eagine::id_v("d"), person{"Dorothy", "D"}, counter{});
+        mgr.add(eagine::id_v("d"), greeting{"Hello"});
+    }};
+
+    eagine::ecs::basic_manager<eagine::identifier_t> dyn_mgr;
+    dyn_mgr
+      .register_component_storage<eagine::ecs::flat_map_cmp_storage, person>();
+    dyn_mgr.register_component_storage<
+      eagine::ecs::sparse_set_cmp_storage,
+      greeting>();
+    dyn_mgr
+      .register_component_storage<eagine::ecs::std_map_cmp_storage, counter>();
+    populate(dyn_mgr);
+
+    static_manager sta_mgr;
+    populate(sta_mgr);
+
+    test.check_equal(count_greeted(dyn_mgr), 11, "dynamic");
+    test.check_equal(count_greeted(sta_mgr), 11, "static");
+    test.check_equal(
+      dyn_mgr.get(&counter::value, eagine::id_v("d")),
+      sta_mgr.get(&counter::value, eagine::id_v("d")),
+      "same");
+}
+//------------------------------------------------------------------------------
+// main
+//------------------------------------------------------------------------------
+auto test_main(eagine::test_ctx& ctx) -> int {
+    eagitest::ctx_suite test{ctx, "static manager", 7};
+    test.once(static_manager_types_1);
+    test.once(static_manager_add_has_remove_1);
+    test.once(static_manager_each_1);
+    test.once(static_manager_for_each_with_1);
+    test.once(static_manager_relation_1);
+    test.once(static_manager_spawn_forget_1);
+    test.once(static_manager_shared_api_1);
+    return test.exit_code();
+}
+//------------------------------------------------------------------------------
+auto main(int argc, const char** argv) -> int {
+    return eagine::test_main_impl(argc, argv, test_main);
+}
+//------------------------------------------------------------------------------
+#include <eagine/testing/unit_end_ctx.hpp>
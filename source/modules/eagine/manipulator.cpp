@@ -273,8 +273,12 @@ public:
         return _can_remove and this->has_value();
     }
 
+    /// @brief Requests the removal of the component after the callback.
+    /// @see can_removeove
+    ///
+    /// Does nothing if the manipulator does not allow removal.
     void remove() noexcept {
-        _removed = true;
+        _removed = _can_remove;
     }
 
 protected:
@@ -22,6 +22,148 @@ import :storage;
 
 namespace eagine::ecs {
 //------------------------------------------------------------------------------
+// Maps store entity/component pairs, so trivially copyable components
+// are staged in blocks of about one memory page and written back after
+// the call, other components are passed one at a time.
+template <typename Entity, typename C, typename Map, typename Func>
+void map_cmp_for_each_batch(Map& components, const Func& func) {
+    using Component = std::remove_const_t<C>;
+    if constexpr(std::is_trivially_copyable_v<Component>) {
+        const std::size_t batch_size{
+          std::max<std::size_t>(4096U / sizeof(Component), 1U)};
+        std::vector<Entity> entities;
+        std::vector<Component> staged;
+        entities.reserve(batch_size);
+        staged.reserve(batch_size);
+        auto p = components.begin();
+        while(p != components.end()) {
+            auto first = p;
+            entities.clear();
+            staged.clear();
+            while((p != components.end()) and (entities.size() < batch_size)) {
+                entities.push_back(p->first);
+                staged.push_back(p->second);
+                ++p;
+            }
+            func(std::span<const Entity>{entities}, std::span<C>{staged});
+            if constexpr(not std::is_const_v<C>) {
+                for(const auto& component : staged) {
+                    first->second = component;
+                    ++first;
+                }
+            }
+        }
+    } else {
+        for(auto& [entity, component] : components) {
+            func(
+              std::span<const Entity>{&entity, 1U},
+              std::span<C>{&component, 1U});
+        }
+    }
+}
+//------------------------------------------------------------------------------
+// Maps with a hasher, like hash_map or std::unordered_map, are not ordered.
+template <typename Map>
+constexpr const bool map_is_unordered = requires { typename Map::hasher; };
+
+// Maps with a transparent hasher or comparator find the entries by keys
+// of other types comparable with the entities, like std::string_view.
+template <typename Map, typename Key>
+concept map_heterogeneous_key =
+  (requires { typename Map::hasher::is_transparent; } or
+   requires { typename Map::key_compare::is_transparent; }) and
+  requires(Map& m, const Key& k) { m.find(k); };
+//------------------------------------------------------------------------------
+// Moves the iterator forward to the first key not less than e. Maps with
+// random-access iterators are searched by galloping from the current
+// position, which keeps the cost logarithmic in the distance skipped.
+// Other maps use their own lower_bound. Unordered maps find e directly.
+template <typename Map, typename Key>
+void map_seek(Map& m, typename Map::iterator& i, const Key& e) {
+    if constexpr(map_is_unordered<Map>) {
+        i = m.find(e);
+    } else if((i != m.end()) and (i->first < e)) {
+        using iter_t = typename Map::iterator;
+        if constexpr(std::random_access_iterator<iter_t>) {
+            const auto less{[](const auto& p, const Key& k) {
+                return p.first < k;
+            }};
+            auto lo{i};
+            std::iter_difference_t<iter_t> step{1};
+            while(
+              (step < std::distance(lo, m.end())) and (lo[step].first < e)) {
+                lo += step;
+                step *= 2;
+            }
+            const auto hi{
+              step < std::distance(lo, m.end()) ? std::next(lo, step)
+                                                : m.end()};
+            i = std::lower_bound(lo, hi, e, less);
+        } else if constexpr(requires { m.lower_bound(e); }) {
+            i = m.lower_bound(e);
+        } else {
+            while((i != m.end()) and (i->first < e)) {
+                ++i;
+            }
+        }
+    }
+}
+//------------------------------------------------------------------------------
+// Calls visit on the entries of the map starting at pos, while they satisfy
+// the more predicate. Entries for which visit returns true are passed to
+// erased and are removed from the map. Maps with random-access iterators
+// would move their tail on each removal, so there the removed entries are
+// marked during the pass and erased in a single sweep after it.
+template <typename Map, typename More, typename Visit, typename Erased>
+void map_sweep(
+  Map& m,
+  typename Map::iterator pos,
+  const More& more,
+  const Visit& visit,
+  const Erased& erased) {
+    using iter_t = typename Map::iterator;
+    if constexpr(std::random_access_iterator<iter_t>) {
+        std::vector<std::size_t> removed;
+        for(; (pos != m.end()) and more(*pos); ++pos) {
+            if(visit(*pos)) {
+                removed.push_back(std::size_t(std::distance(m.begin(), pos)));
+            }
+        }
+        if(removed.empty()) {
+            return;
+        }
+        auto next_removed{removed.begin()};
+        auto write{std::next(m.begin(), removed.front())};
+        for(auto read{write}; read != m.end(); ++read) {
+            if(
+              (next_removed != removed.end()) and
+              (std::size_t(std::distance(m.begin(), read)) == *next_removed)) {
+                erased(*read);
+                ++next_removed;
+            } else {
+                *write = std::move(*read);
+                ++write;
+            }
+        }
+        m.erase(write, m.end());
+    } else {
+        while((pos != m.end()) and more(*pos)) {
+            if(visit(*pos)) {
+                erased(*pos);
+                pos = m.erase(pos);
+            } else {
+                ++pos;
+            }
+        }
+    }
+}
+//------------------------------------------------------------------------------
+// Maps keeping their entries in arrays, like flat_map or chunk_map, are split
+// into blocks visited concurrently by the parallel passes. Node-based maps
+// are not split, their components are gathered by the manager instead.
+template <typename Map>
+constexpr const bool map_has_blocks = not requires { typename Map::node_type; };
+//------------------------------------------------------------------------------
 export template <typename Entity, typename Component, class Map>
 class basic_map_cmp_storage;
 
@@ -50,23 +192,14 @@ public:
         ++_i;
     }
 
-    auto find(entity_param_t<Entity> e) -> bool final {
-        if(done()) {
-            return false;
-        }
-        if(e == _i->first) {
-            return true;
-        }
-        if(e < _i->first) {
-            return false;
-        }
+    auto seek(entity_param_t<Entity> e) -> bool final {
+        assert(_map);
+        map_seek(*_map, _i, e);
+        return not done();
+    }
 
-        while(++_i != _map->end()) {
-            if(_i->first == e) {
-                return true;
-            }
-        }
-        return false;
+    auto find(entity_param_t<Entity> e) -> bool final {
+        return seek(e) and (_i->first == e);
     }
 
     auto current() -> Entity final {
@@ -89,19 +222,35 @@ public:
     using iterator_t = component_storage_iterator<Entity>;
 
     auto capabilities() -> storage_caps final {
-        return storage_caps{
+        const auto caps{
           storage_cap_bit::hide | storage_cap_bit::copy |
           storage_cap_bit::exchange | storage_cap_bit::remove |
           storage_cap_bit::store | storage_cap_bit::modify};
+        if constexpr(map_is_unordered<Map>) {
+            return storage_caps{caps | storage_cap_bit::unordered};
+        } else {
+            return storage_caps{caps};
+        }
     }
 
     void swap_buffers() final {}
 
+    void set_observer(storage_observer<Entity>* observer, std::size_t key)
+      final {
+        _observer.reset(observer, key);
+    }
+
+    auto size() -> std::size_t final {
+        return _components.size();
+    }
+
     auto new_iterator(storage_buffer) -> iterator_t final {
+        const std::unique_lock lock{_iter_mutex};
         return iterator_t(_iterators.make(_components));
     }
 
     void delete_iterator(iterator_t&& i) final {
+        const std::unique_lock lock{_iter_mutex};
         _iterators.eat(i.release());
     }
 
@@ -109,6 +258,27 @@ public:
         return _components.contains(e);
     }
 
+    /// @brief Indicates if the entity with the specified key has a component.
+    /// @see ensure
+    template <map_heterogeneous_key<Map> Key>
+    auto has(const Key& key) -> bool {
+        return _components.find(key) != _components.end();
+    }
+
+    /// @brief Returns the component of the entity with the specified key.
+    /// @see basic_manager::ensure
+    ///
+    /// The key is any type comparable with the entities, for example
+    /// std::string_view for std::string entities. The entity is constructed
+    /// from the key only if a default-constructed component is stored.
+    template <map_heterogeneous_key<Map> Key>
+    auto ensure(const Key& key) -> Component* {
+        if(const auto pos{_components.find(key)}; pos != _components.end()) {
+            return &pos->second;
+        }
+        return store(Entity(key), Component{});
+    }
+
     auto is_hidden(entity_param e) -> bool final {
         return _hidden.contains(e);
     }
@@ -122,6 +292,7 @@ public:
         if(auto found{find(_components, e)}) {
             _hidden.emplace(found.release());
             _components.erase(found.position());
+            _observer.hidden(e);
             return true;
         }
         return false;
@@ -130,14 +301,17 @@ public:
     void hide(iterator_t& i) final {
         assert(not i.done());
         auto pos{_iter_cast(i)._i};
+        const Entity e{pos->first};
         _hidden.emplace(std::move(*pos));
         _components.erase(pos);
+        _observer.hidden(e);
     }
 
     auto show(entity_param e) -> bool final {
         if(auto found{find(_hidden, e)}) {
             _components.emplace(found.release());
             _hidden.erase(found.position());
+            _observer.shown(e);
             return true;
         }
         return false;
@@ -168,19 +342,23 @@ public:
     }
 
     auto remove(entity_param e) -> bool final {
-        _hidden.erase(e);
-        return _components.erase(e) > 0;
+        const bool was_hidden{_hidden.erase(e) > 0};
+        const bool was_shown{_components.erase(e) > 0};
+        if(was_hidden or was_shown) {
+            _observer.removed(e);
+        }
+        return was_shown;
     }
 
     void remove(iterator_t& i) final {
         assert(not i.done());
-        _hidden.erase(_iter_entity(i));
-        _iter_cast(i)._i = _components.erase(_iter_cast(i)._i);
+        _iter_cast(i)._i = _remove(_iter_cast(i)._i);
     }
 
     auto store(entity_param e, Component&& c) -> Component* final {
         _hidden.erase(e);
         const auto pos{_components.emplace(e, std::move(c)).first};
+        _observer.stored(e);
         return &pos->second;
     }
 
@@ -189,9 +367,42 @@ public:
         _hidden.erase(e);
         auto& pos{_iter_cast(i)._i};
         pos = _components.emplace_hint(pos, e, std::move(c));
+        _observer.stored(e);
         return &pos->second;
     }
 
+    /// @brief Sorts the batch and merges it into the components in one pass.
+    ///
+    /// Maps with random-access iterators, like flat_map, would move the tail
+    /// of the stored components on each insertion, so they are rebuilt with
+    /// the merged components instead. Other maps insert the sorted batch.
+    void store_bulk(
+      std::span<const Entity> entities,
+      std::span<Component> components) final {
+        assert(entities.size() == components.size());
+        std::vector<std::size_t> order(entities.size());
+        std::iota(order.begin(), order.end(), std::size_t(0U));
+        std::stable_sort(
+          order.begin(), order.end(), [&](std::size_t l, std::size_t r) {
+              return entities[l] < entities[r];
+          });
+        if constexpr(std::random_access_iterator<typename Map::iterator>) {
+            _merge(entities, components, order);
+        } else {
+            auto pos{_components.begin()};
+            for(const auto index : order) {
+                pos = _components.emplace_hint(
+                  pos, entities[index], std::move(components[index]));
+            }
+        }
+        for(const auto index : order) {
+            if(not _hidden.empty()) {
+                _hidden.erase(entities[index]);
+            }
+            _observer.stored(entities[index]);
+        }
+    }
+
     void for_single(
       const callable_ref<void(entity_param, manipulator<const Component>&)> func,
       entity_param e) final {
@@ -222,11 +433,12 @@ public:
       const callable_ref<void(entity_param, manipulator<Component>&)> func,
       entity_param e) final {
         if(auto found{eagine::find(_components, e)}) {
-            // TODO: modify notification
             concrete_manipulator<Component> m(*found, true /*can_remove*/);
             func(e, m);
             if(m.remove_requested()) {
                 _remove(found.position());
+            } else {
+                _observer.modified(e);
             }
         }
     }
@@ -237,70 +449,136 @@ public:
         assert(not i.done());
         auto& p = _iter_cast(i)._i;
         assert(p != _components.end());
-        // TODO: modify notification
         concrete_manipulator<Component> m(
           p->second, true /*can_remove*/
         );
         func(p->first, m);
         if(m.remove_requested()) {
             p = _remove(p);
+        } else {
+            _observer.modified(p->first);
         }
     }
 
     void for_each(
       const callable_ref<void(entity_param, manipulator<const Component>&)>
         func) final {
-        concrete_manipulator<const Component> m(true /*can_remove*/);
-        auto p = _components.begin();
-        while(p != _components.end()) {
-            m.reset(p->second);
-            func(p->first, m);
-            if(m.remove_requested()) {
-                p = _remove(p);
-            } else {
-                ++p;
-            }
-        }
+        for_each_direct<const Component>(func);
     }
 
     void for_each(
       const callable_ref<void(entity_param, manipulator<Component>&)> func)
       final {
-        concrete_manipulator<Component> m(true /*can_remove*/);
-        auto p = _components.begin();
-        while(p != _components.end()) {
-            // TODO: modify notification
-            m.reset(p->second);
-            func(p->first, m);
-            if(m.remove_requested()) {
-                p = _remove(p);
-            } else {
-                ++p;
+        for_each_direct<Component>(func);
+    }
+
+    void for_each(const callable_ref<void(manipulator<Component>&)> func) final {
+        for_each_direct<Component>(
+          [&func](entity_param, manipulator<Component>& m) { func(m); });
+    }
+
+    void for_each_batch(
+      const callable_ref<
+        void(std::span<const Entity>, std::span<const Component>)> func) final {
+        map_cmp_for_each_batch<Entity, const Component>(_components, func);
+    }
+
+    void for_each_batch(
+      const callable_ref<void(std::span<const Entity>, std::span<Component>)>
+        func) final {
+        map_cmp_for_each_batch<Entity, Component>(_components, func);
+        if(_observer) {
+            for(const auto& entry : _components) {
+                _observer.modified(entry.first);
             }
         }
     }
 
-    void for_each(const callable_ref<void(manipulator<Component>&)> func) final {
-        concrete_manipulator<Component> m(true /*can_remove*/);
-        auto p = _components.begin();
-        while(p != _components.end()) {
-            // TODO: modify notification
-            m.reset(p->second);
-            func(m);
-            if(m.remove_requested()) {
-                p = _remove(p);
-            } else {
-                ++p;
+    auto block_count(std::size_t size) -> std::size_t final {
+        if constexpr(map_has_blocks<Map>) {
+            const auto count{(_components.size() + size - 1U) / size};
+            if constexpr(not std::random_access_iterator<_iter_t>) {
+                // the starts are found once, instead of in each block
+                _block_starts.clear();
+                auto pos{_components.begin()};
+                for(std::size_t b = 0U; b < count; ++b) {
+                    _block_starts.push_back(pos);
+                    pos = std::next(pos, std::ptrdiff_t(_block_size(b, size)));
+                }
             }
+            return count;
+        } else {
+            return 0U;
+        }
+    }
+
+    void for_each_in_block(
+      std::size_t block,
+      std::size_t size,
+      const callable_ref<
+        void(std::span<const Entity>, std::span<const Component>)> func)
+      final {
+        _for_each_in_block<const Component>(block, size, func);
+    }
+
+    void for_each_in_block(
+      std::size_t block,
+      std::size_t size,
+      const callable_ref<void(std::span<const Entity>, std::span<Component>)>
+        func) final {
+        _for_each_in_block<Component>(block, size, func);
+    }
+
+    void for_each_hidden(
+      const callable_ref<void(entity_param, manipulator<const Component>&)> func)
+      final {
+        concrete_manipulator<const Component> m(false /*can_remove*/);
+        for(auto& entry : _hidden) {
+            m.reset(entry.second);
+            func(entry.first, m);
         }
     }
 
+    /// @brief Calls a function on each component without type erasure.
+    /// @see basic_manager::read_each
+    /// @see basic_manager::write_each
+    ///
+    /// C is either Component or const Component. The function is called
+    /// directly and can be inlined into the loop. In flat maps the removals
+    /// requested through the manipulator are applied after the whole pass.
+    template <typename C, typename Function>
+    void for_each_direct(Function&& func) {
+        concrete_manipulator<C> m(true /*can_remove*/);
+        map_sweep(
+          _components,
+          _components.begin(),
+          [](const auto&) { return true; },
+          [&](auto& entry) {
+              m.reset(entry.second);
+              func(entry.first, m);
+              if(m.remove_requested()) {
+                  return true;
+              }
+              if constexpr(not std::is_const_v<C>) {
+                  _observer.modified(entry.first);
+              }
+              return false;
+          },
+          [this](const auto& entry) { _on_remove(entry.first); });
+    }
+
 private:
     using _map_iter_t = basic_map_cmp_storage_iterator<Entity, Component, Map>;
+    using _iter_t = typename Map::iterator;
 
     Map _components{};
     Map _hidden{};
+    // the first entries of the blocks, in maps without random access
+    std::vector<_iter_t> _block_starts{};
     object_pool<_map_iter_t, 2> _iterators{};
+    // joins in systems running concurrently may need iterators at once
+    std::mutex _iter_mutex;
+    storage_observer_ref<Entity> _observer;
 
     auto _iter_cast(component_storage_iterator<Entity>& i) noexcept -> auto& {
         assert(dynamic_cast<_map_iter_t*>(i.ptr()));
@@ -311,14 +589,662 @@ private:
         return _iter_cast(i)._i->first;
     }
 
+    void _on_remove(entity_param e) {
+        _hidden.erase(e);
+        _observer.removed(e);
+    }
+
+    auto _block_size(std::size_t block, std::size_t size) const noexcept
+      -> std::size_t {
+        return std::min(size, _components.size() - block * size);
+    }
+
+    template <typename C, typename Func>
+    void _for_each_in_block(
+      std::size_t block,
+      std::size_t size,
+      const Func& func) {
+        auto pos{[&] {
+            if constexpr(std::random_access_iterator<_iter_t>) {
+                return std::next(
+                  _components.begin(), std::ptrdiff_t(block * size));
+            } else {
+                assert(block < _block_starts.size());
+                return _block_starts[block];
+            }
+        }()};
+        for(auto count{_block_size(block, size)}; count > 0U; --count) {
+            func(
+              std::span<const Entity>{&pos->first, 1U},
+              std::span<C>{&pos->second, 1U});
+            ++pos;
+        }
+    }
+
     auto _remove(typename Map::iterator p) {
         assert(p != _components.end());
-        _hidden.erase(p->first);
+        _on_remove(p->first);
         return _components.erase(p);
     }
+
+    // like emplace, keeps the stored component of an entity if there is one
+    // and the first component of an entity repeated in the batch
+    void _merge(
+      std::span<const Entity> entities,
+      std::span<Component> components,
+      const std::vector<std::size_t>& order) {
+        Map merged{};
+        if constexpr(requires { merged.reserve(std::size_t(0U)); }) {
+            merged.reserve(_components.size() + order.size());
+        }
+        const auto append{[&](const Entity& e, Component& c) {
+            merged.emplace_hint(merged.end(), e, std::move(c));
+        }};
+        auto pos{_components.begin()};
+        for(const auto index : order) {
+            const Entity& e{entities[index]};
+            while((pos != _components.end()) and not(e < pos->first)) {
+                append(pos->first, pos->second);
+                ++pos;
+            }
+            if(merged.empty() or (std::prev(merged.end())->first < e)) {
+                append(e, components[index]);
+            }
+        }
+        for(; pos != _components.end(); ++pos) {
+            append(pos->first, pos->second);
+        }
+        _components = std::move(merged);
+    }
 };
 //------------------------------------------------------------------------------
-export template <typename Entity, typename Relation, class Map>
+// packed sparse set
+//------------------------------------------------------------------------------
+template <typename Entity, typename Data, class Index>
+class basic_sparse_set {
+public:
+    using entity_param = entity_param_t<Entity>;
+
+    [[nodiscard]] auto empty() const noexcept -> bool {
+        return _entities.empty();
+    }
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t {
+        return _entities.size();
+    }
+
+    [[nodiscard]] auto contains(entity_param e) const -> bool {
+        return _index.contains(e);
+    }
+
+    [[nodiscard]] auto can_emplace(entity_param e) const -> bool {
+        if constexpr(requires { _index.can_emplace(e); }) {
+            return _index.can_emplace(e);
+        } else {
+            return true;
+        }
+    }
+
+    [[nodiscard]] auto slot_of(entity_param e) const
+      -> std::optional<std::size_t> {
+        if(const auto pos{_index.find(e)}; pos != _index.end()) {
+            return {pos->second};
+        }
+        return {};
+    }
+
+    [[nodiscard]] auto find(entity_param e) -> Data* {
+        if(const auto slot{slot_of(e)}) {
+            return &_data[*slot];
+        }
+        return nullptr;
+    }
+
+    [[nodiscard]] auto entity(std::size_t slot) const noexcept
+      -> const Entity& {
+        assert(slot < size());
+        return _entities[slot];
+    }
+
+    [[nodiscard]] auto data(std::size_t slot) noexcept -> Data& {
+        assert(slot < size());
+        return _data[slot];
+    }
+
+    [[nodiscard]] auto entities() const noexcept -> const std::vector<Entity>& {
+        return _entities;
+    }
+
+    [[nodiscard]] auto components() noexcept -> std::vector<Data>& {
+        return _data;
+    }
+
+    auto emplace(entity_param e, Data&& d) -> Data* {
+        if(const auto slot{slot_of(e)}) {
+            return &_data[*slot];
+        }
+        if(not _index.emplace(e, size()).second) {
+            return nullptr;
+        }
+        _entities.push_back(e);
+        _data.push_back(std::move(d));
+        return &_data.back();
+    }
+
+    auto release(std::size_t slot) -> Data {
+        Data result{std::move(data(slot))};
+        erase_at(slot);
+        return result;
+    }
+
+    void erase_at(std::size_t slot) {
+        assert(slot < size());
+        const auto last{size() - 1U};
+        _index.erase(_entities[slot]);
+        if(slot != last) {
+            _entities[slot] = std::move(_entities[last]);
+            _data[slot] = std::move(_data[last]);
+            _index[_entities[slot]] = slot;
+        }
+        _entities.pop_back();
+        _data.pop_back();
+    }
+
+    auto erase(entity_param e) -> bool {
+        if(const auto slot{slot_of(e)}) {
+            erase_at(*slot);
+            return true;
+        }
+        return false;
+    }
+
+private:
+    Index _index{};
+    std::vector<Entity> _entities{};
+    std::vector<Data> _data{};
+};
+//------------------------------------------------------------------------------
+/// @brief Entity-to-slot index of a sparse set, addressing an array directly.
+/// @ingroup ecs
+/// @see direct_index_cmp_storage
+///
+/// The position in the array is the index part of the entity given by
+/// entity_traits::index_of, the whole entity is stored beside the slot,
+/// so that entities reusing the index with another generation do not match.
+export template <indexed_entity Entity>
+class direct_entity_index {
+public:
+    using entity_param = entity_param_t<Entity>;
+    using value_type = std::pair<Entity, std::size_t>;
+
+    [[nodiscard]] auto end() const noexcept -> const value_type* {
+        return nullptr;
+    }
+
+    [[nodiscard]] auto find(entity_param e) noexcept -> value_type* {
+        const auto index{_index_of(e)};
+        if(index < _entries.size()) {
+            auto& entry{_entries[index]};
+            if((entry.second != _npos) and (entry.first == e)) {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+    [[nodiscard]] auto find(entity_param e) const noexcept
+      -> const value_type* {
+        return const_cast<direct_entity_index*>(this)->find(e);
+    }
+
+    [[nodiscard]] auto contains(entity_param e) const noexcept -> bool {
+        return find(e) != nullptr;
+    }
+
+    /// @brief Indicates if the entity can be inserted into the index.
+    ///
+    /// Returns false if the position is held by another generation.
+    [[nodiscard]] auto can_emplace(entity_param e) const noexcept -> bool {
+        const auto index{_index_of(e)};
+        if(index < _entries.size()) {
+            const auto& entry{_entries[index]};
+            return (entry.second == _npos) or (entry.first == e);
+        }
+        return true;
+    }
+
+    /// @brief Inserts the entity unless its position is already used.
+    ///
+    /// Does not overwrite the entry of another generation of the entity,
+    /// so that storing through a stale entity does not lose the live one.
+    auto emplace(entity_param e, std::size_t slot)
+      -> std::pair<value_type*, bool> {
+        const auto index{_index_of(e)};
+        if(index >= _entries.size()) {
+            _entries.resize(index + 1U, {Entity{}, _npos});
+        }
+        auto& entry{_entries[index]};
+        if(entry.second != _npos) {
+            return {&entry, false};
+        }
+        entry = {e, slot};
+        return {&entry, true};
+    }
+
+    auto operator[](entity_param e) -> std::size_t& {
+        auto* entry{find(e)};
+        assert(entry);
+        return entry->second;
+    }
+
+    void erase(entity_param e) noexcept {
+        if(auto* entry{find(e)}) {
+            *entry = {Entity{}, _npos};
+        }
+    }
+
+private:
+    static constexpr const std::size_t _npos{~std::size_t(0U)};
+
+    static constexpr auto _index_of(entity_param e) noexcept -> std::size_t {
+        return entity_traits<Entity>::index_of(e);
+    }
+
+    std::vector<value_type> _entries;
+};
+//------------------------------------------------------------------------------
+export template <typename Entity, typename Component, class Index>
+class basic_sparse_set_cmp_storage;
+
+/// @brief Iterator over a sparse-set storage, visiting the packed array.
+/// @ingroup ecs
+/// @note The packed array is unordered, so the storage is unordered too and
+/// the iterator looks the entities up by the index when seeking. Removing
+/// the current entity moves the last one into its slot, which is visited
+/// next.
+export template <typename Entity, typename Component, class Index>
+class basic_sparse_set_cmp_storage_iterator
+  : public component_storage_iterator_intf<Entity> {
+    using _set_t = basic_sparse_set<Entity, Component, Index>;
+
+public:
+    basic_sparse_set_cmp_storage_iterator(_set_t& s)
+      : _set{&s} {
+        assert(_set);
+    }
+
+    void reset() final {
+        _pos = 0U;
+    }
+
+    auto done() -> bool final {
+        return _pos >= _set->size();
+    }
+
+    void next() final {
+        assert(not done());
+        ++_pos;
+    }
+
+    auto seek(entity_param_t<Entity> e) -> bool final {
+        if(done() or (current() != e)) {
+            _pos = _set->slot_of(e).value_or(_set->size());
+        }
+        return not done();
+    }
+
+    auto find(entity_param_t<Entity> e) -> bool final {
+        return seek(e);
+    }
+
+    auto current() -> Entity final {
+        assert(not done());
+        return _set->entity(_pos);
+    }
+
+private:
+    _set_t* _set{nullptr};
+    std::size_t _pos{0U};
+
+    friend class basic_sparse_set_cmp_storage<Entity, Component, Index>;
+};
+//------------------------------------------------------------------------------
+/// @brief Component storage keeping the components in a single packed array.
+/// @ingroup ecs
+/// @see sparse_set_cmp_storage
+///
+/// The entity-to-slot index provides constant-time has, store and remove
+/// (removal moves the last element into the freed slot). Iteration by
+/// for_each walks the packed array linearly in unspecified order. The storage
+/// is unordered, so the multi-component joins look its entities up directly.
+export template <typename Entity, typename Component, class Index>
+class basic_sparse_set_cmp_storage
+  : public component_storage<Entity, Component> {
+
+public:
+    using entity_param = entity_param_t<Entity>;
+    using iterator_t = component_storage_iterator<Entity>;
+
+    auto capabilities() -> storage_caps final {
+        return storage_caps{
+          storage_cap_bit::hide | storage_cap_bit::copy |
+          storage_cap_bit::exchange | storage_cap_bit::remove |
+          storage_cap_bit::store | storage_cap_bit::modify |
+          storage_cap_bit::unordered};
+    }
+
+    void swap_buffers() final {}
+
+    void set_observer(storage_observer<Entity>* observer, std::size_t key)
+      final {
+        _observer.reset(observer, key);
+    }
+
+    auto size() -> std::size_t final {
+        return _components.size();
+    }
+
+    auto new_iterator(storage_buffer) -> iterator_t final {
+        const std::unique_lock lock{_iter_mutex};
+        return iterator_t(_iterators.make(_components));
+    }
+
+    void delete_iterator(iterator_t&& i) final {
+        const std::unique_lock lock{_iter_mutex};
+        _iterators.eat(i.release());
+    }
+
+    auto has(entity_param e) -> bool final {
+        return _components.contains(e);
+    }
+
+    auto is_hidden(entity_param e) -> bool final {
+        return _hidden.contains(e);
+    }
+
+    auto is_hidden(iterator_t& i) -> bool final {
+        assert(not i.done());
+        return is_hidden(_iter_cast(i).current());
+    }
+
+    auto hide(entity_param e) -> bool final {
+        if(const auto slot{_components.slot_of(e)};
+           slot and _hidden.can_emplace(e)) {
+            _hidden.emplace(e, _components.release(*slot));
+            _observer.hidden(e);
+            return true;
+        }
+        return false;
+    }
+
+    void hide(iterator_t& i) final {
+        assert(not i.done());
+        auto& iter{_iter_cast(i)};
+        // a hidden entity is replaced by the last one, visited next
+        if(not hide(iter.current())) {
+            iter.next();
+        }
+    }
+
+    auto show(entity_param e) -> bool final {
+        if(const auto slot{_hidden.slot_of(e)};
+           slot and _components.can_emplace(e)) {
+            _components.emplace(e, _hidden.release(*slot));
+            _observer.shown(e);
+            return true;
+        }
+        return false;
+    }
+
+    auto copy(entity_param ef, entity_param et) -> void* final {
+        if(const auto found{_components.find(ef)}) {
+            return static_cast<void*>(store(et, Component(*found)));
+        }
+        return nullptr;
+    }
+
+    auto exchange(const entity_param ea, const entity_param eb) -> bool final {
+        const auto fa{_components.find(ea)};
+        const auto fb{_components.find(eb)};
+
+        if(fa and fb) {
+            using std::swap;
+            swap(*fa, *fb);
+        } else if(fa) {
+            Component tmp{std::move(*fa)};
+            remove(ea);
+            store(eb, std::move(tmp));
+        } else if(fb) {
+            Component tmp{std::move(*fb)};
+            remove(eb);
+            store(ea, std::move(tmp));
+        }
+        return true;
+    }
+
+    auto remove(entity_param e) -> bool final {
+        const bool was_hidden{_hidden.erase(e)};
+        const bool was_shown{_components.erase(e)};
+        if(was_hidden or was_shown) {
+            _observer.removed(e);
+        }
+        return was_shown;
+    }
+
+    void remove(iterator_t& i) final {
+        assert(not i.done());
+        auto& iter{_iter_cast(i)};
+        // a removed entity is replaced by the last one, visited next
+        if(not remove(iter.current())) {
+            iter.next();
+        }
+    }
+
+    auto store(entity_param e, Component&& c) -> Component* final {
+        if(not _hidden.can_emplace(e)) {
+            return nullptr;
+        }
+        _hidden.erase(e);
+        if(const auto result{_components.emplace(e, std::move(c))}) {
+            _observer.stored(e);
+            return result;
+        }
+        return nullptr;
+    }
+
+    auto store(iterator_t&, entity_param e, Component&& c)
+      -> Component* final {
+        return store(e, std::move(c));
+    }
+
+    void for_single(
+      const callable_ref<void(entity_param, manipulator<const Component>&)> func,
+      entity_param e) final {
+        if(const auto slot{_components.slot_of(e)}) {
+            _apply_single<const Component>(func, *slot);
+        }
+    }
+
+    void for_single(
+      const callable_ref<void(entity_param, manipulator<const Component>&)> func,
+      iterator_t& i) final {
+        assert(not i.done());
+        _for_single_iter<const Component>(func, _iter_cast(i));
+    }
+
+    void for_single(
+      const callable_ref<void(entity_param, manipulator<Component>&)> func,
+      entity_param e) final {
+        if(const auto slot{_components.slot_of(e)}) {
+            _apply_single<Component>(func, *slot);
+        }
+    }
+
+    void for_single(
+      const callable_ref<void(entity_param, manipulator<Component>&)> func,
+      iterator_t& i) final {
+        assert(not i.done());
+        _for_single_iter<Component>(func, _iter_cast(i));
+    }
+
+    void for_each(
+      const callable_ref<void(entity_param, manipulator<const Component>&)>
+        func) final {
+        for_each_direct<const Component>(func);
+    }
+
+    void for_each(
+      const callable_ref<void(entity_param, manipulator<Component>&)> func)
+      final {
+        for_each_direct<Component>(func);
+    }
+
+    void for_each(const callable_ref<void(manipulator<Component>&)> func) final {
+        concrete_manipulator<Component> m(true /*can_remove*/);
+        std::size_t slot{0U};
+        while(slot < _components.size()) {
+            m.reset(_components.data(slot));
+            func(m);
+            if(m.remove_requested()) {
+                _remove_at(slot);
+            } else {
+                _observer.modified(_components.entity(slot));
+                ++slot;
+            }
+        }
+    }
+
+    void for_each_batch(
+      const callable_ref<
+        void(std::span<const Entity>, std::span<const Component>)> func) final {
+        func(_components.entities(), _components.components());
+    }
+
+    void for_each_batch(
+      const callable_ref<void(std::span<const Entity>, std::span<Component>)>
+        func) final {
+        func(_components.entities(), _components.components());
+        _observer.modified(std::span<const Entity>{_components.entities()});
+    }
+
+    auto block_count(std::size_t size) -> std::size_t final {
+        return (_components.size() + size - 1U) / size;
+    }
+
+    void for_each_in_block(
+      std::size_t block,
+      std::size_t size,
+      const callable_ref<
+        void(std::span<const Entity>, std::span<const Component>)> func)
+      final {
+        const auto first{block * size};
+        const auto count{std::min(size, _components.size() - first)};
+        func(
+          std::span<const Entity>{_components.entities()}.subspan(first, count),
+          std::span<const Component>{_components.components()}.subspan(
+            first, count));
+    }
+
+    void for_each_in_block(
+      std::size_t block,
+      std::size_t size,
+      const callable_ref<void(std::span<const Entity>, std::span<Component>)>
+        func) final {
+        const auto first{block * size};
+        const auto count{std::min(size, _components.size() - first)};
+        func(
+          std::span<const Entity>{_components.entities()}.subspan(first, count),
+          std::span<Component>{_components.components()}.subspan(first, count));
+    }
+
+    void for_each_hidden(
+      const callable_ref<void(entity_param, manipulator<const Component>&)> func)
+      final {
+        concrete_manipulator<const Component> m(false /*can_remove*/);
+        for(std::size_t slot = 0; slot < _hidden.size(); ++slot) {
+            m.reset(_hidden.data(slot));
+            func(_hidden.entity(slot), m);
+        }
+    }
+
+    /// @brief Calls a function on each component without type erasure.
+    /// @see basic_manager::read_each
+    /// @see basic_manager::write_each
+    template <typename C, typename Function>
+    void for_each_direct(Function&& func) {
+        concrete_manipulator<C> m(true /*can_remove*/);
+        std::size_t slot{0U};
+        while(slot < _components.size()) {
+            m.reset(_components.data(slot));
+            func(_components.entity(slot), m);
+            if(m.remove_requested()) {
+                _remove_at(slot);
+            } else {
+                if constexpr(not std::is_const_v<C>) {
+                    _observer.modified(_components.entity(slot));
+                }
+                ++slot;
+            }
+        }
+    }
+
+private:
+    using _set_t = basic_sparse_set<Entity, Component, Index>;
+    using _set_iter_t =
+      basic_sparse_set_cmp_storage_iterator<Entity, Component, Index>;
+
+    _set_t _components{};
+    _set_t _hidden{};
+    object_pool<_set_iter_t, 2> _iterators{};
+    std::mutex _iter_mutex;
+    storage_observer_ref<Entity> _observer;
+
+    auto _iter_cast(component_storage_iterator<Entity>& i) noexcept -> auto& {
+        assert(dynamic_cast<_set_iter_t*>(i.ptr()));
+        return *static_cast<_set_iter_t*>(i.ptr());
+    }
+
+    template <typename C>
+    void _apply_single(
+      const callable_ref<void(entity_param, manipulator<C>&)>& func,
+      std::size_t slot) {
+        concrete_manipulator<C> m(_components.data(slot), true /*can_remove*/);
+        func(_components.entity(slot), m);
+        if(m.remove_requested()) {
+            _remove_at(slot);
+        } else if constexpr(not std::is_const_v<C>) {
+            _observer.modified(_components.entity(slot));
+        }
+    }
+
+    template <typename C>
+    void _for_single_iter(
+      const callable_ref<void(entity_param, manipulator<C>&)>& func,
+      _set_iter_t& iter) {
+        if(const auto slot{_components.slot_of(iter.current())}) {
+            concrete_manipulator<C> m(
+              _components.data(*slot), true /*can_remove*/);
+            func(_components.entity(*slot), m);
+            if(m.remove_requested()) {
+                _remove_at(*slot);
+            } else if constexpr(not std::is_const_v<C>) {
+                _observer.modified(_components.entity(*slot));
+            }
+        }
+    }
+
+    void _remove_at(std::size_t slot) {
+        _hidden.erase(_components.entity(slot));
+        _observer.removed(_components.entity(slot));
+        _components.erase_at(slot);
+    }
+};
+//------------------------------------------------------------------------------
+export template <
+  typename Entity,
+  typename Relation,
+  class Map,
+  class ReverseIndex = nothing_t>
 class basic_map_rel_storage;
 
 export template <typename Entity, typename Relation, class Map>
@@ -361,10 +1287,22 @@ private:
     Map* _map{nullptr};
     _iter_t _i;
 
-    friend class basic_map_rel_storage<Entity, Relation, Map>;
+    template <typename, typename, class, class>
+    friend class basic_map_rel_storage;
 };
 //------------------------------------------------------------------------------
-export template <typename Entity, typename Relation, class Map>
+/// @brief Relation storage keeping (subject, object) pairs in a sorted Map.
+/// @ingroup ecs
+/// @see basic_manager::for_each_subject_of
+///
+/// Unless ReverseIndex is nothing_t, it is a sorted set of (object, subject)
+/// pairs kept alongside the relations, which makes finding the subjects
+/// related to an object a range lookup instead of a scan of all relations.
+export template <
+  typename Entity,
+  typename Relation,
+  class Map,
+  class ReverseIndex>
 class basic_map_rel_storage : public relation_storage<Entity, Relation> {
     using _pair_t = std::pair<Entity, Entity>;
     using _map_iter_t = basic_map_rel_storage_iterator<Entity, Relation, Map>;
@@ -381,11 +1319,18 @@ public:
 
     void swap_buffers() final {}
 
+    void set_observer(storage_observer<Entity>* observer, std::size_t key)
+      final {
+        _observer.reset(observer, key);
+    }
+
     auto new_iterator(storage_buffer) -> iterator_t final {
+        const std::unique_lock lock{_iter_mutex};
         return iterator_t(_iterators.make(_relations));
     }
 
     void delete_iterator(iterator_t&& i) final {
+        const std::unique_lock lock{_iter_mutex};
         _iterators.eat(i.release());
     }
 
@@ -395,22 +1340,28 @@ public:
 
     auto store(entity_param s, entity_param o) -> bool final {
         _relations.emplace(_pair_t(s, o), Relation());
+        _index(s, o);
         return true;
     }
 
     auto store(entity_param s, entity_param o, Relation&& r)
       -> Relation* final {
         const auto pos = _relations.emplace(_pair_t(s, o), std::move(r)).first;
+        _index(s, o);
         return &pos->second;
     }
 
     auto remove(entity_param s, entity_param o) -> bool final {
-        return _relations.erase(_pair_t(s, o)) > 0;
+        if(_relations.erase(_pair_t(s, o)) > 0) {
+            _unindex(s, o);
+            return true;
+        }
+        return false;
     }
 
     void remove(iterator_t& i) final {
         assert(not i.done());
-        _iter_cast(i)._i = _relations.erase(_iter_cast(i)._i);
+        _iter_cast(i)._i = _remove(_iter_cast(i)._i);
     }
 
     void for_single(
@@ -450,11 +1401,12 @@ public:
       entity_param subject,
       entity_param object) final {
         if(const auto found{find(_relations, _pair_t(subject, object))}) {
-            // TODO: modify notification
             concrete_manipulator<Relation> m(*found, true /*can_erase*/);
             func(subject, object, m);
             if(m.remove_requested()) {
                 _remove(found.position());
+            } else {
+                _observer.modified(subject);
             }
         }
     }
@@ -467,13 +1419,14 @@ public:
         auto& po = _iter_cast(i)._i;
         assert(po != _relations.end());
 
-        // TODO: modify notification
         concrete_manipulator<Relation> m(
           po->second, true /*can_erase*/
         );
         func(po->first.first, po->first.second, m);
         if(m.remove_requested()) {
             po = _remove(po);
+        } else {
+            _observer.modified(po->first.first);
         }
     }
 
@@ -495,80 +1448,87 @@ public:
         }
     }
 
+    void for_each_subject_of(
+      const callable_ref<void(entity_param, entity_param)> func,
+      entity_param object) final {
+        if constexpr(_has_reverse_index) {
+            entity_param subject = entity_traits<Entity>::first();
+            auto pos = _reverse.lower_bound(_pair_t(object, subject));
+            while((pos != _reverse.end()) and (pos->first == object)) {
+                func(pos->second, object);
+                ++pos;
+            }
+        } else {
+            for(auto& p : _relations) {
+                if(p.first.second == object) {
+                    func(p.first.first, object);
+                }
+            }
+        }
+    }
+
     void for_each(
       const callable_ref<
         void(entity_param, entity_param, manipulator<const Relation>&)> func,
       entity_param subject) final {
-        concrete_manipulator<const Relation> m(true /*can_remove*/);
         entity_param object = entity_traits<Entity>::first();
-        auto po = _relations.lower_bound(_pair_t(subject, object));
-        while((po != _relations.end()) and (po->first.first == subject)) {
-            m.reset(po->second);
-            func(subject, po->first.second, m);
-            if(m.remove_requested()) {
-                po = _remove(po);
-            } else {
-                ++po;
-            }
-        }
+        _for_each<const Relation>(
+          func,
+          _relations.lower_bound(_pair_t(subject, object)),
+          [subject](const auto& entry) {
+              return entry.first.first == subject;
+          });
     }
 
     void for_each(
       const callable_ref<
         void(entity_param, entity_param, manipulator<Relation>&)> func,
       entity_param subject) final {
-        concrete_manipulator<Relation> m(true /*can_remove*/);
         entity_param object = entity_traits<Entity>::first();
-        auto po = _relations.lower_bound(_pair_t(subject, object));
-        while((po != _relations.end()) and (po->first.first == subject)) {
-            // TODO: modify notification
-            m.reset(po->second);
-            func(subject, po->first.second, m);
-            if(m.remove_requested()) {
-                po = _remove(po);
-            } else {
-                ++po;
-            }
-        }
+        _for_each<Relation>(
+          func,
+          _relations.lower_bound(_pair_t(subject, object)),
+          [subject](const auto& entry) {
+              return entry.first.first == subject;
+          });
     }
 
     void for_each(
       const callable_ref<
         void(entity_param, entity_param, manipulator<const Relation>&)> func)
       final {
-        concrete_manipulator<const Relation> m(true /*can_remove*/);
-        auto po = _relations.begin();
-        while(po != _relations.end()) {
-            m.reset(po->second);
-            func(po->first.first, po->first.second, m);
-            if(m.remove_requested()) {
-                po = _remove(po);
-            } else {
-                ++po;
-            }
-        }
+        _for_each<const Relation>(
+          func, _relations.begin(), [](const auto&) { return true; });
     }
 
     void for_each(
       const callable_ref<
         void(entity_param, entity_param, manipulator<Relation>&)> func) final {
-        concrete_manipulator<Relation> m(true /*can_remove*/);
-        auto po = _relations.begin();
-        while(po != _relations.end()) {
-            // TODO: modify notification
-            m.reset(po->second);
-            func(po->first.first, po->first.second, m);
-            if(m.remove_requested()) {
-                po = _remove(po);
-            } else {
-                ++po;
-            }
-        }
+        _for_each<Relation>(
+          func, _relations.begin(), [](const auto&) { return true; });
     }
 
 private:
+    static constexpr const bool _has_reverse_index{
+      not std::is_same_v<ReverseIndex, nothing_t>};
+
     Map _relations;
+    [[no_unique_address]] ReverseIndex _reverse{};
     object_pool<_map_iter_t, 2> _iterators{};
+    std::mutex _iter_mutex;
+    storage_observer_ref<Entity> _observer;
+
+    void _index(entity_param s, entity_param o) {
+        if constexpr(_has_reverse_index) {
+            _reverse.emplace(o, s);
+        }
+    }
+
+    void _unindex(entity_param s, entity_param o) {
+        if constexpr(_has_reverse_index) {
+            _reverse.erase(_pair_t(o, s));
+        }
+    }
 
     auto _iter_cast(relation_storage_iterator<Entity>& i) noexcept -> auto& {
         assert(dynamic_cast<_map_iter_t*>(i.ptr()) != nullptr);
@@ -577,8 +1537,36 @@ private:
 
     auto _remove(typename Map::iterator p) {
         assert(p != _relations.end());
+        _unindex(p->first.first, p->first.second);
         return _relations.erase(p);
     }
+
+    // in flat maps the requested removals are applied after the whole pass
+    template <typename R, typename Func, typename More>
+    void _for_each(
+      const Func& func,
+      typename Map::iterator pos,
+      const More& more) {
+        concrete_manipulator<R> m(true /*can_remove*/);
+        map_sweep(
+          _relations,
+          pos,
+          more,
+          [&](auto& entry) {
+              m.reset(entry.second);
+              func(entry.first.first, entry.first.second, m);
+              if(m.remove_requested()) {
+                  return true;
+              }
+              if constexpr(not std::is_const_v<R>) {
+                  _observer.modified(entry.first.first);
+              }
+              return false;
+          },
+          [this](const auto& entry) {
+              _unindex(entry.first.first, entry.first.second);
+          });
+    }
 };
 //------------------------------------------------------------------------------
 export template <typename Entity, typename Component>
@@ -590,6 +1578,13 @@ using std_map_rel_storage = basic_map_rel_storage<
   Entity,
   Relation,
   std::map<std::pair<Entity, Entity>, Relation>>;
+
+export template <typename Entity, typename Relation>
+using std_map_indexed_rel_storage = basic_map_rel_storage<
+  Entity,
+  Relation,
+  std::map<std::pair<Entity, Entity>, Relation>,
+  std::set<std::pair<Entity, Entity>>>;
 //------------------------------------------------------------------------------
 export template <typename Entity, typename Component>
 using flat_map_cmp_storage =
@@ -600,6 +1595,13 @@ using flat_map_rel_storage = basic_map_rel_storage<
   Entity,
   Relation,
   flat_map<std::pair<Entity, Entity>, Relation>>;
+
+export template <typename Entity, typename Relation>
+using flat_map_indexed_rel_storage = basic_map_rel_storage<
+  Entity,
+  Relation,
+  flat_map<std::pair<Entity, Entity>, Relation>,
+  std::set<std::pair<Entity, Entity>>>;
 //------------------------------------------------------------------------------
 export template <typename Entity, typename Component>
 using chunk_map_cmp_storage = basic_map_cmp_storage<
@@ -616,5 +1618,22 @@ using chunk_map_rel_storage = basic_map_rel_storage<
     Relation,
     4096 / sizeof(std::pair<Entity, Relation>)>>;
 //------------------------------------------------------------------------------
+export template <typename Entity, typename Component>
+using sparse_set_cmp_storage = basic_sparse_set_cmp_storage<
+  Entity,
+  Component,
+  std::unordered_map<Entity, std::size_t>>;
+
+/// @brief Sparse-set component storage addressing the index directly.
+/// @ingroup ecs
+/// @see entity_handle
+/// @see indexed_entity
+///
+/// Storing a component through a stale entity, while another generation
+/// of it is stored, fails and the stored component is kept.
+export template <indexed_entity Entity, typename Component>
+using direct_index_cmp_storage =
+  basic_sparse_set_cmp_storage<Entity, Component, direct_entity_index<Entity>>;
+//------------------------------------------------------------------------------
 } // namespace eagine::ecs
 
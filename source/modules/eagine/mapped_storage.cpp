@@ -0,0 +1,392 @@
+/// @file
+///
+/// Copyright Matus Chochlik.
+/// Distributed under the Boost Software License, Version 1.0.
+/// See accompanying file LICENSE_1_0.txt or copy at
+/// https://www.boost.org/LICENSE_1_0.txt
+///
+module;
+
+#include <cassert>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define EAGINE_ECS_USE_MMAP 1
+#else
+#define EAGINE_ECS_USE_MMAP 0
+#endif
+
+export module eagine.ecs:mapped_storage;
+
+import std;
+import eagine.core.types;
+import eagine.core.utility;
+import eagine.core.container;
+import :entity_traits;
+import :manipulator;
+import :storage;
+import :snapshot;
+
+namespace eagine::ecs {
+//------------------------------------------------------------------------------
+/// @brief Read-only mapping of a snapshot file into memory.
+/// @ingroup ecs
+/// @see mapped_cmp_storage
+/// @see basic_manager::save_snapshot
+///
+/// Uses memory-mapping of the file where available, otherwise the contents
+/// of the file are read into memory.
+export class snapshot_mapping {
+public:
+    /// @brief Maps the snapshot file at the specified path.
+    /// @see is_open
+    snapshot_mapping(const std::filesystem::path& path) {
+#if EAGINE_ECS_USE_MMAP
+        const int fd{::open(path.c_str(), O_RDONLY)};
+        if(fd >= 0) {
+            struct ::stat info {};
+            if((::fstat(fd, &info) == 0) and (info.st_size > 0)) {
+                const auto size{std::size_t(info.st_size)};
+                void* address{
+                  ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0)};
+                if(address != MAP_FAILED) {
+                    _address = address;
+                    _data = {static_cast<const std::byte*>(address), size};
+                }
+            }
+            ::close(fd);
+        }
+#else
+        std::ifstream input{path, std::ios::binary | std::ios::ate};
+        if(input) {
+            _buffer.resize(std::size_t(input.tellg()));
+            input.seekg(0);
+            if(input.read(
+                 reinterpret_cast<char*>(_buffer.data()),
+                 std::streamsize(_buffer.size()))) {
+                _data = {_buffer};
+            }
+        }
+#endif
+    }
+
+    snapshot_mapping(snapshot_mapping&&) = delete;
+    snapshot_mapping(const snapshot_mapping&) = delete;
+    auto operator=(snapshot_mapping&&) = delete;
+    auto operator=(const snapshot_mapping&) = delete;
+
+    ~snapshot_mapping() noexcept {
+#if EAGINE_ECS_USE_MMAP
+        if(_address) {
+            ::munmap(_address, _data.size());
+        }
+#endif
+    }
+
+    /// @brief Indicates if the file was successfully mapped.
+    [[nodiscard]] auto is_open() const noexcept -> bool {
+        return not _data.empty();
+    }
+
+    /// @brief Returns the mapped contents of the file.
+    [[nodiscard]] auto data() const noexcept -> std::span<const std::byte> {
+        return _data;
+    }
+
+private:
+    std::span<const std::byte> _data;
+#if EAGINE_ECS_USE_MMAP
+    void* _address{nullptr};
+#else
+    std::vector<std::byte> _buffer;
+#endif
+};
+//------------------------------------------------------------------------------
+export template <typename Entity, typename Component>
+class mapped_cmp_storage;
+
+export template <typename Entity>
+class mapped_cmp_storage_iterator
+  : public component_storage_iterator_intf<Entity> {
+public:
+    mapped_cmp_storage_iterator(std::span<const Entity> entities) noexcept
+      : _entities{entities} {}
+
+    void reset() final {
+        _pos = 0U;
+    }
+
+    auto done() -> bool final {
+        return _pos >= _entities.size();
+    }
+
+    void next() final {
+        assert(not done());
+        ++_pos;
+    }
+
+    auto seek(entity_param_t<Entity> e) -> bool final {
+        if(not done() and (_entities[_pos] < e)) {
+            const auto begin{std::next(_entities.begin(), _pos)};
+            _pos = std::size_t(std::distance(
+              _entities.begin(),
+              std::lower_bound(begin, _entities.end(), e)));
+        }
+        return not done();
+    }
+
+    auto find(entity_param_t<Entity> e) -> bool final {
+        return seek(e) and (_entities[_pos] == e);
+    }
+
+    auto current() -> Entity final {
+        assert(not done());
+        return _entities[_pos];
+    }
+
+private:
+    std::span<const Entity> _entities;
+    std::size_t _pos{0U};
+
+    template <typename, typename>
+    friend class mapped_cmp_storage;
+};
+//------------------------------------------------------------------------------
+/// @brief Read-only component storage using the data of a mapped snapshot.
+/// @ingroup ecs
+/// @see snapshot_mapping
+/// @see basic_manager::save_snapshot
+///
+/// The entities and components are used directly from the component section
+/// of the snapshot, without copying or deserialization, so both the Entity
+/// and the Component types must be trivially copyable. The storage does not
+/// advertise any capabilities; requests to store, remove, hide or modify
+/// the components are ignored. When an observer is set, the storage reports
+/// all its entities as stored, so that the signatures and views are updated.
+/// The hidden components saved in the section are not used.
+export template <typename Entity, typename Component>
+class mapped_cmp_storage : public component_storage<Entity, Component> {
+    static_assert(std::is_trivially_copyable_v<Entity>);
+    static_assert(std::is_trivially_copyable_v<Component>);
+
+public:
+    using entity_param = entity_param_t<Entity>;
+    using iterator_t = component_storage_iterator<Entity>;
+
+    /// @brief Construction with the mapping of a saved snapshot.
+    /// @see is_valid
+    mapped_cmp_storage(shared_holder<snapshot_mapping> mapping)
+      : _mapping{std::move(mapping)} {
+        if(_mapping) {
+            snapshot_header expected{};
+            expected.entity_size = sizeof(Entity);
+            if(auto reader{find_snapshot_section(
+                 _mapping->data(),
+                 expected,
+                 snapshot_section::component,
+                 identifier_t(Component::uid()),
+                 snapshot_layout::of<Component>())}) {
+                _view(*reader);
+            }
+        }
+    }
+
+    /// @brief Indicates if the component section was found in the snapshot.
+    /// @note The section is not used if the Component layout differs.
+    [[nodiscard]] auto is_valid() const noexcept -> bool {
+        return _valid;
+    }
+
+    auto capabilities() -> storage_caps final {
+        return storage_caps{};
+    }
+
+    void swap_buffers() final {}
+
+    void set_observer(storage_observer<Entity>* observer, std::size_t key)
+      final {
+        _observer.reset(observer, key);
+        for(const auto& e : _entities) {
+            _observer.stored(e);
+        }
+    }
+
+    auto size() -> std::size_t final {
+        return _entities.size();
+    }
+
+    auto new_iterator(storage_buffer) -> iterator_t final {
+        const std::unique_lock lock{_iter_mutex};
+        return iterator_t(_iterators.make(_entities));
+    }
+
+    void delete_iterator(iterator_t&& i) final {
+        const std::unique_lock lock{_iter_mutex};
+        _iterators.eat(i.release());
+    }
+
+    auto has(entity_param e) -> bool final {
+        return std::binary_search(_entities.begin(), _entities.end(), e);
+    }
+
+    auto is_hidden(entity_param) -> bool final {
+        return false;
+    }
+
+    auto is_hidden(iterator_t&) -> bool final {
+        return false;
+    }
+
+    auto hide(entity_param) -> bool final {
+        return false;
+    }
+
+    void hide(iterator_t& i) final {
+        assert(not i.done());
+        i.next();
+    }
+
+    auto show(entity_param) -> bool final {
+        return false;
+    }
+
+    auto copy(entity_param, entity_param) -> void* final {
+        return nullptr;
+    }
+
+    auto exchange(entity_param, entity_param) -> bool final {
+        return false;
+    }
+
+    auto remove(entity_param) -> bool final {
+        return false;
+    }
+
+    void remove(iterator_t& i) final {
+        assert(not i.done());
+        i.next();
+    }
+
+    auto store(entity_param, Component&&) -> Component* final {
+        return nullptr;
+    }
+
+    auto store(iterator_t&, entity_param, Component&&) -> Component* final {
+        return nullptr;
+    }
+
+    void for_single(
+      const callable_ref<void(entity_param, manipulator<const Component>&)> func,
+      entity_param e) final {
+        const auto pos{std::lower_bound(_entities.begin(), _entities.end(), e)};
+        if((pos != _entities.end()) and (*pos == e)) {
+            _apply(func, std::size_t(std::distance(_entities.begin(), pos)));
+        }
+    }
+
+    void for_single(
+      const callable_ref<void(entity_param, manipulator<const Component>&)> func,
+      iterator_t& i) final {
+        assert(not i.done());
+        _apply(func, _iter_cast(i)._pos);
+    }
+
+    void for_single(
+      const callable_ref<void(entity_param, manipulator<Component>&)>,
+      entity_param) final {}
+
+    void for_single(
+      const callable_ref<void(entity_param, manipulator<Component>&)>,
+      iterator_t&) final {}
+
+    void for_each(
+      const callable_ref<void(entity_param, manipulator<const Component>&)>
+        func) final {
+        for_each_direct<const Component>(func);
+    }
+
+    void for_each(
+      const callable_ref<void(entity_param, manipulator<Component>&)>) final {}
+
+    void for_each(const callable_ref<void(manipulator<Component>&)>) final {}
+
+    void for_each_batch(
+      const callable_ref<
+        void(std::span<const Entity>, std::span<const Component>)> func) final {
+        if(not _entities.empty()) {
+            func(_entities, _components);
+        }
+    }
+
+    void for_each_batch(
+      const callable_ref<void(std::span<const Entity>, std::span<Component>)>)
+      final {}
+
+    void for_each_hidden(
+      const callable_ref<void(entity_param, manipulator<const Component>&)>)
+      final {}
+
+    /// @brief Calls a function on each component without type erasure.
+    /// @see basic_manager::read_each
+    ///
+    /// Functions requesting modifiable components are not called.
+    template <typename C, typename Function>
+    void for_each_direct(Function&& func) {
+        if constexpr(std::is_const_v<C>) {
+            concrete_manipulator<C> m(false /*can_remove*/);
+            for(std::size_t index = 0U; index < _entities.size(); ++index) {
+                m.reset(_components[index]);
+                func(_entities[index], m);
+            }
+        }
+    }
+
+    /// @brief The mapped components cannot be replaced by a loaded snapshot.
+    auto load_snapshot(snapshot_reader&) -> bool final {
+        return false;
+    }
+
+private:
+    using _iter_t = mapped_cmp_storage_iterator<Entity>;
+
+    shared_holder<snapshot_mapping> _mapping;
+    std::span<const Entity> _entities;
+    std::span<const Component> _components;
+    bool _valid{false};
+    object_pool<_iter_t, 2> _iterators{};
+    std::mutex _iter_mutex;
+    storage_observer_ref<Entity> _observer;
+
+    void _view(snapshot_reader& reader) {
+        std::uint64_t count{0U};
+        if(not reader.read_value(count)) {
+            return;
+        }
+        const auto entities{reader.template view_values<Entity>(count)};
+        const auto components{reader.template view_values<Component>(count)};
+        if((entities.size() == count) and (components.size() == count)) {
+            _entities = entities;
+            _components = components;
+            _valid = true;
+        }
+    }
+
+    auto _iter_cast(iterator_t& i) noexcept -> auto& {
+        assert(dynamic_cast<_iter_t*>(i.ptr()));
+        return *static_cast<_iter_t*>(i.ptr());
+    }
+
+    void _apply(
+      const callable_ref<void(entity_param, manipulator<const Component>&)>&
+        func,
+      std::size_t index) {
+        concrete_manipulator<const Component> m(
+          _components[index], false /*can_remove*/);
+        func(_entities[index], m);
+    }
+};
+//------------------------------------------------------------------------------
+} // namespace eagine::ecs
@@ -0,0 +1,297 @@
+/// @file
+///
+/// Copyright Matus Chochlik.
+/// Distributed under the Boost Software License, Version 1.0.
+/// See accompanying file LICENSE_1_0.txt or copy at
+/// https://www.boost.org/LICENSE_1_0.txt
+///
+module;
+
+#include <cassert>
+
+export module eagine.ecs:scheduler;
+
+import std;
+import eagine.core.types;
+import eagine.core.container;
+import eagine.core.utility;
+import :entity_traits;
+import :component;
+import :manipulator;
+import :worker_pool;
+import :manager;
+
+namespace eagine::ecs {
+//------------------------------------------------------------------------------
+/// @brief Set of data types accessed by a system, with the access mode.
+/// @ingroup ecs
+/// @see system_intf
+/// @see basic_scheduler
+export class system_access {
+public:
+    /// @brief Declares that the component with the specified id is read.
+    auto reads(identifier_t cid) -> system_access& {
+        _components[cid];
+        return *this;
+    }
+
+    /// @brief Declares that the component with the specified id is written.
+    auto writes(identifier_t cid) -> system_access& {
+        _components[cid].write = true;
+        return *this;
+    }
+
+    /// @brief Declares that the component with the specified id is buffered.
+    /// @see double_buffer_cmp_storage
+    ///
+    /// Reads and writes of double-buffered components use separate buffers
+    /// and do not conflict.
+    auto buffered(identifier_t cid) -> system_access& {
+        _components[cid].buffered = true;
+        return *this;
+    }
+
+    /// @brief Declares access to the shared archetype tables.
+    /// @see basic_manager::uses_archetype_storage
+    auto uses_archetypes(bool write) noexcept -> system_access& {
+        _archetypes = true;
+        _archetypes_write = _archetypes_write or write;
+        return *this;
+    }
+
+    /// @brief Declares access to Component, writing unless it is const.
+    template <typename Component>
+    auto add() -> system_access& {
+        const identifier_t cid{std::remove_const_t<Component>::uid()};
+        return std::is_const_v<Component> ? reads(cid) : writes(cid);
+    }
+
+    /// @brief Declares access to Component, as stored in the specified manager.
+    template <typename Component, typename Entity>
+    auto add(basic_manager<Entity>& mgr) -> system_access& {
+        using C = std::remove_const_t<Component>;
+        if(mgr.template knows_component_type<C>()) {
+            if(mgr.template uses_archetype_storage<C>()) {
+                uses_archetypes(not std::is_const_v<Component>);
+            }
+            if(mgr.template component_storage_caps<C>().can_swap_buffers()) {
+                buffered(C::uid());
+            }
+        }
+        return add<Component>();
+    }
+
+    /// @brief Indicates if this and the other access may not run concurrently.
+    [[nodiscard]] auto conflicts_with(const system_access& that) const noexcept
+      -> bool {
+        for(const auto& [cid, mode] : _components) {
+            if(const auto pos{that._components.find(cid)};
+               pos != that._components.end()) {
+                const auto& other{pos->second};
+                if(mode.write and other.write) {
+                    return true;
+                }
+                if(
+                  (mode.write or other.write) and
+                  not(mode.buffered and other.buffered)) {
+                    return true;
+                }
+            }
+        }
+        return _archetypes and that._archetypes and
+               (_archetypes_write or that._archetypes_write);
+    }
+
+    void clear() noexcept {
+        _components.clear();
+        _archetypes = false;
+        _archetypes_write = false;
+    }
+
+private:
+    struct _mode {
+        bool write{false};
+        bool buffered{false};
+    };
+
+    flat_map<identifier_t, _mode> _components;
+    bool _archetypes{false};
+    bool _archetypes_write{false};
+};
+//------------------------------------------------------------------------------
+/// @brief Interface for systems updating entity data in a basic_manager.
+/// @ingroup ecs
+/// @see basic_scheduler
+/// @see function_system
+///
+/// Systems without conflicting access run concurrently and may store,
+/// hide, show and remove only the components they declare as written.
+/// The entity signatures updated by these operations are guarded by
+/// a shared mutex.
+export template <typename Entity>
+struct system_intf : interface<system_intf<Entity>> {
+    /// @brief Declares the data accessed by update.
+    virtual void declare_access(basic_manager<Entity>&, system_access&) = 0;
+
+    /// @brief Does a single update of the entity data.
+    virtual void update(basic_manager<Entity>&) = 0;
+};
+//------------------------------------------------------------------------------
+/// @brief System calling a function on each entity having all Components.
+/// @ingroup ecs
+/// @see basic_scheduler::add
+///
+/// Components qualified as const are read, the others are written,
+/// in the same way as with basic_manager::for_each_with.
+export template <typename Entity, typename Function, typename... Components>
+class function_system final : public system_intf<Entity> {
+public:
+    function_system(Function func) noexcept(
+      std::is_nothrow_move_constructible_v<Function>)
+      : _func{std::move(func)} {}
+
+    void declare_access(basic_manager<Entity>& mgr, system_access& access)
+      final {
+        (..., access.template add<Components>(mgr));
+    }
+
+    void update(basic_manager<Entity>& mgr) final {
+        const auto wrap{
+          [this](entity_param_t<Entity> e, manipulator<Components>&... m) {
+              std::tuple<_access<Components>...> access{m...};
+              std::apply([&](auto&... a) { _func(e, a.get()...); }, access);
+          }};
+        if constexpr(sizeof...(Components) == 1) {
+            mgr.template for_each<std::remove_const_t<Components>...>(
+              callable_ref<void(
+                entity_param_t<Entity>, manipulator<Components>&...)>{
+                construct_from, wrap});
+        } else {
+            mgr.template for_each_with<Components...>(wrap);
+        }
+    }
+
+private:
+    Function _func;
+
+    // written components are passed through, read components get
+    // a manipulator not allowing removal, because other systems in
+    // the same stage may be iterating over the same storage
+    template <typename C>
+    struct _access {
+        _access(manipulator<C>& m) noexcept
+          : _m{m} {}
+
+        auto get() noexcept -> manipulator<C>& {
+            return _m;
+        }
+
+        manipulator<C>& _m;
+    };
+
+    template <typename C>
+        requires(std::is_const_v<C>)
+    struct _access<C> {
+        _access(manipulator<C>& m) noexcept
+          : _m{optional_reference<C>{m.read()}, false /*can_remove*/} {}
+
+        auto get() noexcept -> manipulator<C>& {
+            return _m;
+        }
+
+        manipulator<C> _m;
+    };
+};
+//------------------------------------------------------------------------------
+/// @brief Runs systems on a basic_manager, concurrently where possible.
+/// @ingroup ecs
+/// @see system_intf
+/// @see system_access
+/// @see basic_manager::workers
+///
+/// On each update the systems are split into stages. A system is placed
+/// into the stage after the last one containing an earlier-added system
+/// with conflicting access. Systems in the same stage run concurrently,
+/// conflicting systems run in the order in which they were added.
+/// Systems reading and writing a double-buffered component do not conflict;
+/// the readers see the previous frame until basic_manager::swap_buffers.
+export template <typename Entity>
+class basic_scheduler {
+public:
+    /// @brief Construction with a reference to the manager.
+    basic_scheduler(basic_manager<Entity>& mgr) noexcept
+      : _manager{mgr} {}
+
+    /// @brief Adds the specified system.
+    auto add(unique_holder<system_intf<Entity>> sys) -> basic_scheduler& {
+        assert(sys);
+        _systems.emplace_back(std::move(sys));
+        return *this;
+    }
+
+    /// @brief Adds a system calling func on each entity having all Components.
+    /// @see function_system
+    template <component_data... Components, typename Function>
+    auto add(Function func) -> basic_scheduler& {
+        return add(
+          {hold<function_system<Entity, Function, Components...>>,
+           std::move(func)});
+    }
+
+    /// @brief Returns the number of added systems.
+    [[nodiscard]] auto system_count() const noexcept -> std::size_t {
+        return _systems.size();
+    }
+
+    /// @brief Returns the number of stages used by the last update.
+    [[nodiscard]] auto stage_count() const noexcept -> std::size_t {
+        return _stages.size();
+    }
+
+    /// @brief Runs a single update of all systems.
+    auto update() -> basic_scheduler& {
+        _plan();
+        for(const auto& stage : _stages) {
+            if(stage.size() == 1U) {
+                _systems[stage.front()]->update(_manager);
+            } else {
+                const auto run{[&](std::size_t i) {
+                    _systems[stage[i]]->update(_manager);
+                }};
+                _manager.workers().for_each_index(
+                  stage.size(),
+                  callable_ref<void(std::size_t)>{construct_from, run});
+            }
+        }
+        return *this;
+    }
+
+private:
+    basic_manager<Entity>& _manager;
+    std::vector<unique_holder<system_intf<Entity>>> _systems;
+    std::vector<system_access> _access;
+    std::vector<std::vector<std::size_t>> _stages;
+
+    void _plan() {
+        _access.resize(_systems.size());
+        std::vector<std::size_t> stage_of(_systems.size(), 0U);
+        _stages.clear();
+        for(std::size_t s = 0; s < _systems.size(); ++s) {
+            _access[s].clear();
+            _systems[s]->declare_access(_manager, _access[s]);
+            std::size_t stage{0U};
+            for(std::size_t p = 0; p < s; ++p) {
+                if(_access[s].conflicts_with(_access[p])) {
+                    stage = std::max(stage, stage_of[p] + 1U);
+                }
+            }
+            stage_of[s] = stage;
+            if(_stages.size() <= stage) {
+                _stages.resize(stage + 1U);
+            }
+            _stages[stage].push_back(s);
+        }
+    }
+};
+//------------------------------------------------------------------------------
+} // namespace eagine::ecs
@@ -0,0 +1,243 @@
+/// @file
+///
+/// Copyright Matus Chochlik.
+/// Distributed under the Boost Software License, Version 1.0.
+/// See accompanying file LICENSE_1_0.txt or copy at
+/// https://www.boost.org/LICENSE_1_0.txt
+///
+export module eagine.ecs:signature;
+
+import std;
+import eagine.core.types;
+import :entity_traits;
+import :storage;
+import :hash_storage;
+
+namespace eagine::ecs {
+//------------------------------------------------------------------------------
+/// @brief Per-entity bitsets of the visible and hidden components.
+/// @ingroup ecs
+/// @see basic_manager::use_signatures
+/// @see component_index
+///
+/// The bits are indexed by component_index and are kept up to date
+/// by the component storages, through the storage_observer interface.
+/// The signatures are kept in a hash map, with the bits of the first
+/// components stored inline. Systems running concurrently may store,
+/// hide and remove their written components, so the map is guarded by
+/// a shared mutex, updates lock it exclusively and queries shared.
+/// Removing the last component only clears the signature, cleared
+/// signatures are erased later, when new entities are stored.
+export template <typename Entity>
+class entity_signatures final : public storage_observer<Entity> {
+public:
+    using entity_param = entity_param_t<Entity>;
+
+    /// @brief Indicates if the entity has all the specified visible components.
+    [[nodiscard]] auto has_all(
+      entity_param e,
+      std::span<const std::size_t> bits) const noexcept -> bool {
+        const std::shared_lock lock{_mutex};
+        if(const auto pos{_signatures.find(e)}; pos != _signatures.end()) {
+            return std::all_of(bits.begin(), bits.end(), [&](auto bit) {
+                return pos->second.test(_visible_word(bit), bit);
+            });
+        }
+        return false;
+    }
+
+    /// @brief Indicates if the entity has any visible component.
+    [[nodiscard]] auto knows(entity_param e) const noexcept -> bool {
+        const std::shared_lock lock{_mutex};
+        if(const auto pos{_signatures.find(e)}; pos != _signatures.end()) {
+            const auto& sig{pos->second};
+            for(std::size_t w = 0; w < sig.word_count(); w += 2U) {
+                if(sig.word(w) != 0U) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    /// @brief Returns the bits of all components of an entity, with hidden.
+    [[nodiscard]] auto stored(entity_param e) const
+      -> std::vector<std::size_t> {
+        std::vector<std::size_t> result;
+        const std::shared_lock lock{_mutex};
+        if(const auto pos{_signatures.find(e)}; pos != _signatures.end()) {
+            const auto& sig{pos->second};
+            for(std::size_t w = 0; w < sig.word_count(); w += 2U) {
+                auto word{sig.word(w) | sig.word(w + 1U)};
+                while(word != 0U) {
+                    const auto b{std::size_t(std::countr_zero(word))};
+                    result.push_back((w / 2U) * _word_bits + b);
+                    word &= word - 1U;
+                }
+            }
+        }
+        return result;
+    }
+
+    /// @brief Clears the specified bit in the signatures of all entities.
+    void clear_bit(std::size_t bit) noexcept {
+        const std::unique_lock lock{_mutex};
+        for(auto& entry : _signatures) {
+            entry.second.reset(_visible_word(bit), bit);
+            entry.second.reset(_hidden_word(bit), bit);
+        }
+        _erase_cleared();
+    }
+
+    /// @brief Removes all signatures.
+    void clear() noexcept {
+        const std::unique_lock lock{_mutex};
+        _signatures.clear();
+        _cleared = 0U;
+    }
+
+    void on_stored(std::size_t bit, entity_param e) noexcept final {
+        const std::unique_lock lock{_mutex};
+        auto& sig{_signature_of(e)};
+        sig.set(_visible_word(bit), bit);
+        sig.reset(_hidden_word(bit), bit);
+    }
+
+    void on_removed(std::size_t bit, entity_param e) noexcept final {
+        const std::unique_lock lock{_mutex};
+        if(auto pos{_signatures.find(e)}; pos != _signatures.end()) {
+            auto& sig{pos->second};
+            sig.reset(_visible_word(bit), bit);
+            sig.reset(_hidden_word(bit), bit);
+            if(sig.is_empty()) {
+                ++_cleared;
+            }
+        }
+    }
+
+    void on_hidden(std::size_t bit, entity_param e) noexcept final {
+        const std::unique_lock lock{_mutex};
+        auto& sig{_signature_of(e)};
+        sig.reset(_visible_word(bit), bit);
+        sig.set(_hidden_word(bit), bit);
+    }
+
+    void on_shown(std::size_t bit, entity_param e) noexcept final {
+        on_stored(bit, e);
+    }
+
+    void on_modified(std::size_t, entity_param) noexcept final {}
+
+private:
+    static constexpr const std::size_t _word_bits{64U};
+    // the number of words stored inline (visible and hidden bits
+    // of the first 128 components)
+    static constexpr const std::size_t _inline_words{4U};
+
+    using _word_t = std::uint64_t;
+
+    // the even words hold the visible and the odd words the hidden components
+    class _signature {
+    public:
+
+        auto word_count() const noexcept -> std::size_t {
+            return _inline_words + _overflow_size;
+        }
+
+        auto word(std::size_t w) const noexcept -> std::uint64_t {
+            return _at(w);
+        }
+
+        auto test(std::size_t w, std::size_t bit) const noexcept -> bool {
+            return (w < word_count()) and ((word(w) & _mask(bit)) != 0U);
+        }
+
+        void set(std::size_t w, std::size_t bit) noexcept {
+            if(word_count() <= w) {
+                _grow(w + 2U - w % 2U);
+            }
+            _at(w) |= _mask(bit);
+        }
+
+        void reset(std::size_t w, std::size_t bit) noexcept {
+            if(w < word_count()) {
+                _at(w) &= ~_mask(bit);
+            }
+        }
+
+        auto is_empty() const noexcept -> bool {
+            for(std::size_t w = 0; w < word_count(); ++w) {
+                if(word(w) != 0U) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    private:
+        std::array<_word_t, _inline_words> _inline{};
+        std::unique_ptr<_word_t[]> _overflow{};
+        std::size_t _overflow_size{0U};
+
+        auto _at(std::size_t w) const noexcept -> const _word_t& {
+            return w < _inline_words ? _inline[w]
+                                     : _overflow[w - _inline_words];
+        }
+
+        auto _at(std::size_t w) noexcept -> _word_t& {
+            return w < _inline_words ? _inline[w]
+                                     : _overflow[w - _inline_words];
+        }
+
+        void _grow(std::size_t count) {
+            const auto size{count - _inline_words};
+            auto overflow{std::make_unique<_word_t[]>(size)};
+            std::copy_n(_overflow.get(), _overflow_size, overflow.get());
+            _overflow = std::move(overflow);
+            _overflow_size = size;
+        }
+    };
+
+    mutable std::shared_mutex _mutex;
+    hash_map<Entity, _signature> _signatures;
+    // the number of signatures cleared by on_removed since the last erase
+    std::size_t _cleared{0U};
+
+    static constexpr auto _visible_word(std::size_t bit) noexcept
+      -> std::size_t {
+        return (bit / _word_bits) * 2U;
+    }
+
+    static constexpr auto _hidden_word(std::size_t bit) noexcept
+      -> std::size_t {
+        return _visible_word(bit) + 1U;
+    }
+
+    static constexpr auto _mask(std::size_t bit) noexcept -> std::uint64_t {
+        return std::uint64_t(1U) << (bit % _word_bits);
+    }
+
+    auto _signature_of(entity_param e) -> _signature& {
+        if(auto pos{_signatures.find(e)}; pos != _signatures.end()) {
+            return pos->second;
+        }
+        if(_cleared * 2U > _signatures.size()) {
+            _erase_cleared();
+        }
+        return _signatures.try_emplace(e).first->second;
+    }
+
+    void _erase_cleared() noexcept {
+        auto pos{_signatures.begin()};
+        while(pos != _signatures.end()) {
+            if(pos->second.is_empty()) {
+                pos = _signatures.erase(pos);
+            } else {
+                ++pos;
+            }
+        }
+        _cleared = 0U;
+    }
+};
+//------------------------------------------------------------------------------
+} // namespace eagine::ecs
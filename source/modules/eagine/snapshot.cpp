@@ -0,0 +1,364 @@
+/// @file
+///
+/// Copyright Matus Chochlik.
+/// Distributed under the Boost Software License, Version 1.0.
+/// See accompanying file LICENSE_1_0.txt or copy at
+/// https://www.boost.org/LICENSE_1_0.txt
+///
+module;
+
+#include <cassert>
+
+export module eagine.ecs:snapshot;
+
+import std;
+
+namespace eagine::ecs {
+//------------------------------------------------------------------------------
+export class snapshot_writer;
+export class snapshot_reader;
+//------------------------------------------------------------------------------
+/// @brief Customization point for snapshots of non-trivially-copyable types.
+/// @ingroup ecs
+/// @see snapshot_data
+///
+/// Specializations provide a static save(snapshot_writer&, const T&) function
+/// and a static load(snapshot_reader&, T&) -> bool function.
+export template <typename T>
+struct snapshot_traits {};
+//------------------------------------------------------------------------------
+/// @brief Concept of types that can be saved to and loaded from snapshots.
+/// @ingroup ecs
+/// @see snapshot_traits
+///
+/// Trivially copyable types are saved as blobs of bytes, and must not contain
+/// pointers or other process-specific data. Other types need specialization
+/// of snapshot_traits.
+export template <typename T>
+concept snapshot_data =
+  std::default_initializable<T> and
+  (std::is_trivially_copyable_v<T> or
+   requires(snapshot_writer& w, snapshot_reader& r, const T& cv, T& v) {
+       snapshot_traits<T>::save(w, cv);
+       { snapshot_traits<T>::load(r, v) } -> std::convertible_to<bool>;
+   });
+//------------------------------------------------------------------------------
+/// @brief Buffer into which the sections of a snapshot are serialized.
+/// @ingroup ecs
+/// @see snapshot_reader
+/// @see basic_manager::save_snapshot
+///
+/// Values are written in native byte order. Arrays of trivially copyable
+/// values are aligned relative to the start of the snapshot, so that they
+/// can be used directly from a memory-mapped snapshot file.
+export class snapshot_writer {
+public:
+    /// @brief Construction with the offset of this buffer in the snapshot.
+    snapshot_writer(std::size_t offset = 0U) noexcept
+      : _offset{offset} {}
+
+    /// @brief Returns the offset of the next written byte in the snapshot.
+    [[nodiscard]] auto offset() const noexcept -> std::size_t {
+        return _offset + _data.size();
+    }
+
+    /// @brief Returns the bytes written so far.
+    [[nodiscard]] auto data() const noexcept -> std::span<const std::byte> {
+        return {_data};
+    }
+
+    /// @brief Writes zero bytes until the offset is a multiple of alignment.
+    auto align(std::size_t alignment) -> snapshot_writer& {
+        assert(alignment > 0U);
+        const auto padding{(alignment - offset() % alignment) % alignment};
+        _data.resize(_data.size() + padding);
+        return *this;
+    }
+
+    /// @brief Writes the specified bytes.
+    auto write(std::span<const std::byte> bytes) -> snapshot_writer& {
+        _data.insert(_data.end(), bytes.begin(), bytes.end());
+        return *this;
+    }
+
+    /// @brief Writes the string as its size followed by the characters.
+    auto write_string(std::string_view str) -> snapshot_writer& {
+        write_value(std::uint64_t(str.size()));
+        return write(std::as_bytes(std::span{str.data(), str.size()}));
+    }
+
+    /// @brief Writes a single value.
+    template <snapshot_data T>
+    auto write_value(const T& value) -> snapshot_writer& {
+        if constexpr(std::is_trivially_copyable_v<T>) {
+            return write(std::as_bytes(std::span{&value, 1U}));
+        } else {
+            snapshot_traits<T>::save(*this, value);
+            return *this;
+        }
+    }
+
+    /// @brief Writes an array of values, aligned if trivially copyable.
+    template <snapshot_data T>
+    auto write_values(std::span<const T> values) -> snapshot_writer& {
+        if constexpr(std::is_trivially_copyable_v<T>) {
+            return align(alignof(T)).write(std::as_bytes(values));
+        } else {
+            for(const auto& value : values) {
+                snapshot_traits<T>::save(*this, value);
+            }
+            return *this;
+        }
+    }
+
+private:
+    std::size_t _offset{0U};
+    std::vector<std::byte> _data;
+};
+//------------------------------------------------------------------------------
+/// @brief Reads the values written by snapshot_writer from a block of bytes.
+/// @ingroup ecs
+/// @see snapshot_writer
+/// @see basic_manager::load_snapshot
+///
+/// All read functions return false if there is not enough data left.
+export class snapshot_reader {
+public:
+    /// @brief Construction with the data and their offset in the snapshot.
+    snapshot_reader(std::span<const std::byte> data, std::size_t offset = 0U)
+      : _data{data}
+      , _offset{offset} {}
+
+    /// @brief Returns the offset of the next read byte in the snapshot.
+    [[nodiscard]] auto offset() const noexcept -> std::size_t {
+        return _offset + _position;
+    }
+
+    /// @brief Returns the number of bytes not read yet.
+    [[nodiscard]] auto remaining() const noexcept -> std::size_t {
+        return _data.size() - _position;
+    }
+
+    /// @brief Skips the padding written by snapshot_writer::align.
+    auto align(std::size_t alignment) -> bool {
+        assert(alignment > 0U);
+        return skip((alignment - offset() % alignment) % alignment);
+    }
+
+    /// @brief Skips the specified number of bytes.
+    auto skip(std::size_t size) -> bool {
+        if(size > remaining()) {
+            return false;
+        }
+        _position += size;
+        return true;
+    }
+
+    /// @brief Reads the specified number of bytes without copying them.
+    [[nodiscard]] auto read(std::size_t size) -> std::span<const std::byte> {
+        if(size > remaining()) {
+            return {};
+        }
+        const auto result{_data.subspan(_position, size)};
+        _position += size;
+        return result;
+    }
+
+    /// @brief Reads a string written by snapshot_writer::write_string.
+    auto read_string(std::string& str) -> bool {
+        std::uint64_t size{0U};
+        if(not read_value(size) or (size > remaining())) {
+            return false;
+        }
+        const auto bytes{read(std::size_t(size))};
+        str.assign(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        return true;
+    }
+
+    /// @brief Reads a single value.
+    template <snapshot_data T>
+    auto read_value(T& value) -> bool {
+        if constexpr(std::is_trivially_copyable_v<T>) {
+            if(sizeof(T) > remaining()) {
+                return false;
+            }
+            std::memcpy(
+              static_cast<void*>(&value), _data.data() + _position, sizeof(T));
+            _position += sizeof(T);
+            return true;
+        } else {
+            return snapshot_traits<T>::load(*this, value);
+        }
+    }
+
+    /// @brief Reads values written by snapshot_writer::write_values.
+    template <snapshot_data T>
+    auto read_values(std::span<T> values) -> bool {
+        if constexpr(std::is_trivially_copyable_v<T>) {
+            if(not align(alignof(T)) or (values.size_bytes() > remaining())) {
+                return false;
+            }
+            if(not values.empty()) {
+                std::memcpy(
+                  static_cast<void*>(values.data()),
+                  _data.data() + _position,
+                  values.size_bytes());
+                _position += values.size_bytes();
+            }
+            return true;
+        } else {
+            for(auto& value : values) {
+                if(not snapshot_traits<T>::load(*this, value)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    /// @brief Returns a view of values written by snapshot_writer::write_values.
+    /// @see snapshot_mapping
+    ///
+    /// The values are not copied, and the returned span refers to the data
+    /// of this reader. Returns an empty span if there is not enough data left
+    /// or if the data are not properly aligned in memory.
+    template <typename T>
+        requires(std::is_trivially_copyable_v<T>)
+    [[nodiscard]] auto view_values(std::size_t count) -> std::span<const T> {
+        if(not align(alignof(T)) or (count > remaining() / sizeof(T))) {
+            return {};
+        }
+        const auto* ptr{_data.data() + _position};
+        if(reinterpret_cast<std::uintptr_t>(ptr) % alignof(T) != 0U) {
+            return {};
+        }
+        _position += count * sizeof(T);
+        return {reinterpret_cast<const T*>(ptr), count};
+    }
+
+private:
+    std::span<const std::byte> _data;
+    std::size_t _offset{0U};
+    std::size_t _position{0U};
+};
+//------------------------------------------------------------------------------
+export template <>
+struct snapshot_traits<std::string> {
+    static void save(snapshot_writer& writer, const std::string& str) {
+        writer.write_string(str);
+    }
+
+    static auto load(snapshot_reader& reader, std::string& str) -> bool {
+        return reader.read_string(str);
+    }
+};
+//------------------------------------------------------------------------------
+/// @brief Kinds of the sections of a snapshot.
+/// @ingroup ecs
+/// @see basic_manager::save_snapshot
+///
+/// A snapshot starts with the snapshot_header and continues with sections,
+/// each starting with a snapshot_section_header, and ends with a section
+/// of the end kind. The section data start and end aligned to 8 bytes.
+export enum class snapshot_section : std::uint64_t {
+    end = 0U,
+    entities = 1U,
+    component = 2U,
+    relation = 3U
+};
+//------------------------------------------------------------------------------
+/// @brief The header at the start of a snapshot.
+/// @ingroup ecs
+export struct snapshot_header {
+    std::array<char, 8> magic{'E', 'A', 'G', 'I', 'E', 'C', 'S', '\0'};
+    std::uint32_t version{2U};
+    /// @brief The size of trivially copyable entities, zero otherwise.
+    std::uint32_t entity_size{0U};
+
+    [[nodiscard]] auto is_compatible(const snapshot_header& that) const noexcept
+      -> bool {
+        return (magic == that.magic) and (version == that.version) and
+               (entity_size == that.entity_size);
+    }
+};
+//------------------------------------------------------------------------------
+/// @brief The layout of the values saved in a section of a snapshot.
+/// @ingroup ecs
+/// @see snapshot_section_header
+///
+/// Trivially copyable values are saved as their bytes, so a section can be
+/// used only by a program in which the type has the same size and alignment.
+/// The layout of other values is defined by their snapshot_traits.
+export struct snapshot_layout {
+    /// @brief The size of trivially copyable values, zero otherwise.
+    std::uint32_t size{0U};
+    /// @brief The alignment of trivially copyable values, zero otherwise.
+    std::uint32_t alignment{0U};
+
+    /// @brief Returns the layout of the specified type.
+    template <typename T>
+    [[nodiscard]] static constexpr auto of() noexcept -> snapshot_layout {
+        if constexpr(std::is_trivially_copyable_v<T>) {
+            return {
+              .size = std::uint32_t(sizeof(T)),
+              .alignment = std::uint32_t(alignof(T))};
+        } else {
+            return {};
+        }
+    }
+
+    [[nodiscard]] constexpr auto operator==(const snapshot_layout&)
+      const noexcept -> bool = default;
+};
+//------------------------------------------------------------------------------
+/// @brief The header at the start of each section in a snapshot.
+/// @ingroup ecs
+export struct snapshot_section_header {
+    snapshot_section kind{snapshot_section::end};
+    /// @brief The component or relation uid.
+    std::uint64_t uid{0U};
+    /// @brief The size of the section data following this header.
+    std::uint64_t size{0U};
+    /// @brief The layout of the components or relations in the section.
+    snapshot_layout layout{};
+};
+//------------------------------------------------------------------------------
+/// @brief Finds the section with the specified kind and uid in a snapshot.
+/// @ingroup ecs
+/// @see snapshot_mapping
+///
+/// The data must contain the whole snapshot, starting with the header.
+/// Returns a reader of the section data, or nothing if the section was not
+/// found, if the snapshot is not compatible with the expected header or if
+/// the values in the section do not have the specified layout.
+export [[nodiscard]] auto find_snapshot_section(
+  std::span<const std::byte> data,
+  const snapshot_header& expected,
+  snapshot_section kind,
+  std::uint64_t uid,
+  const snapshot_layout& layout) -> std::optional<snapshot_reader> {
+    snapshot_reader reader{data};
+    snapshot_header header{};
+    if(not reader.read_value(header) or not header.is_compatible(expected)) {
+        return {};
+    }
+    while(true) {
+        snapshot_section_header section{};
+        if(
+          not reader.read_value(section) or
+          (section.kind == snapshot_section::end) or
+          (section.size > reader.remaining())) {
+            return {};
+        }
+        const auto offset{reader.offset()};
+        const auto section_data{reader.read(std::size_t(section.size))};
+        if((section.kind == kind) and (section.uid == uid)) {
+            if(section.layout != layout) {
+                return {};
+            }
+            return {snapshot_reader{section_data, offset}};
+        }
+    }
+}
+//------------------------------------------------------------------------------
+} // namespace eagine::ecs
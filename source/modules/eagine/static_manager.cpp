@@ -0,0 +1,607 @@
+/// @file
+///
+/// Copyright Matus Chochlik.
+/// Distributed under the Boost Software License, Version 1.0.
+/// See accompanying file LICENSE_1_0.txt or copy at
+/// https://www.boost.org/LICENSE_1_0.txt
+///
+module;
+
+#include <cassert>
+
+export module eagine.ecs:static_manager;
+
+import std;
+import eagine.core.types;
+import eagine.core.utility;
+import :entity_traits;
+import :manipulator;
+import :component;
+import :storage;
+import :map_storage;
+
+namespace eagine::ecs {
+//------------------------------------------------------------------------------
+/// @brief Specifies the Storage template used for Data in a static_manager.
+/// @ingroup ecs
+/// @see component_list
+/// @see relation_list
+export template <template <class, class> class Storage, typename Data>
+struct stored_in {
+    using data_type = Data;
+
+    template <typename Entity>
+    using storage_type = Storage<Entity, Data>;
+};
+
+/// @brief List of the component types stored in a static_manager.
+/// @ingroup ecs
+/// @see stored_in
+///
+/// The elements are either component types, which are stored in
+/// flat_map_cmp_storage, or stored_in specifying another storage.
+export template <typename... Components>
+struct component_list {};
+
+/// @brief List of the relation types stored in a static_manager.
+/// @ingroup ecs
+/// @see stored_in
+///
+/// The elements are either relation types, which are stored in
+/// flat_map_rel_storage, or stored_in specifying another storage.
+export template <typename... Relations>
+struct relation_list {};
+//------------------------------------------------------------------------------
+template <typename Spec, template <class, class> class Default>
+struct static_storage_spec : stored_in<Default, Spec> {};
+
+template <
+  template <class, class> class Storage,
+  typename Data,
+  template <class, class> class Default>
+struct static_storage_spec<stored_in<Storage, Data>, Default>
+  : stored_in<Storage, Data> {};
+
+template <typename Data, typename... D>
+consteval auto static_data_index() noexcept -> std::size_t {
+    const std::array<bool, sizeof...(D)> same{std::is_same_v<Data, D>...};
+    const auto pos{std::find(same.begin(), same.end(), true)};
+    return std::size_t(std::distance(same.begin(), pos));
+}
+//------------------------------------------------------------------------------
+export template <
+  typename Entity,
+  typename Components,
+  typename Relations = relation_list<>>
+class static_manager;
+
+/// @brief Entity manager with the component and relation types fixed at compile time.
+/// @ingroup ecs
+/// @see basic_manager
+/// @see component_list
+/// @see relation_list
+///
+/// The storages are members of this manager, with their concrete types,
+/// so finding the storage of a data type and the calls into the storages
+/// are resolved at compile time instead of by the type-erased lookup done
+/// by basic_manager. The member functions have the same names and signatures
+/// as those of basic_manager, so code written against one compiles with
+/// the other. Using a data type that is not in the lists is a compile error.
+export template <typename Entity, typename... CS, typename... RS>
+class static_manager<Entity, component_list<CS...>, relation_list<RS...>>
+  : public basic_manager_signals<Entity> {
+    template <typename Spec>
+    using _cmp_spec_t = static_storage_spec<Spec, flat_map_cmp_storage>;
+
+    template <typename Spec>
+    using _rel_spec_t = static_storage_spec<Spec, flat_map_rel_storage>;
+
+public:
+    /// @brief Preferred type to pass immutable entity identifier parameters.
+    using entity_param = entity_param_t<Entity>;
+
+    /// @brief Default constructor.
+    static_manager() = default;
+
+    /// @brief Indicates if the specified Component type can be used with this manager.
+    template <component_data Component>
+    [[nodiscard]] static constexpr auto knows_component_type() noexcept
+      -> bool {
+        return _cmp_index<Component>() < sizeof...(CS);
+    }
+
+    /// @brief Indicates if the specified Relation type can be used with this manager.
+    template <relation_data Relation>
+    [[nodiscard]] static constexpr auto knows_relation_type() noexcept -> bool {
+        return _rel_index<Relation>() < sizeof...(RS);
+    }
+
+    /// @brief Returns an object specifying Component storage capabilities.
+    template <component_data Component>
+    [[nodiscard]] auto component_storage_caps() -> storage_caps {
+        return _cmp_storage<Component>().capabilities();
+    }
+
+    /// @brief Returns an object specifying Relation storage capabilities.
+    template <relation_data Relation>
+    [[nodiscard]] auto relation_storage_caps() -> storage_caps {
+        return _rel_storage<Relation>().capabilities();
+    }
+
+    /// @brief Indicates if the storage object for Component has specified capability.
+    template <component_data Component>
+    [[nodiscard]] auto component_storage_can(const storage_cap_bit cap)
+      -> bool {
+        return component_storage_caps<Component>().has(cap);
+    }
+
+    /// @brief Indicates if the storage object for Relation has specified capability.
+    template <relation_data Relation>
+    [[nodiscard]] auto relation_storage_can(const storage_cap_bit cap) -> bool {
+        return relation_storage_caps<Relation>().has(cap);
+    }
+
+    /// @brief Indicates if the manager has any knowledge about the specified entity.
+    [[nodiscard]] auto knows(entity_param ent) -> bool {
+        return std::apply(
+          [&](auto&... s) { return (false or ... or s.has(ent)); },
+          _cmp_storages);
+    }
+
+    /// @brief Indicates if the entity was spawned and not forgotten since.
+    /// @see basic_manager::is_alive
+    [[nodiscard]] auto is_alive(entity_param ent) const noexcept -> tribool {
+        return _entities.is_alive(ent);
+    }
+
+    /// @brief Creates a new entity that is not yet known to this manager
+    /// @see basic_manager::spawn
+    auto spawn() noexcept -> Entity {
+        const Entity ent{
+          _entities.allocate([this](entity_param e) { return knows(e); })};
+        this->entity_spawned(ent);
+        return ent;
+    }
+
+    /// @brief Removes all components of the specified entity.
+    void forget(entity_param ent) {
+        if(ent) {
+            std::apply(
+              [&](auto&... s) {
+                  (...,
+                   (s.capabilities().can_remove() ? void(s.remove(ent))
+                                                  : void()));
+              },
+              _cmp_storages);
+            _entities.release(ent);
+            this->entity_forgotten(ent);
+        }
+    }
+
+    template <component_data Component>
+    [[nodiscard]] auto has(entity_param ent) -> bool {
+        return _cmp_storage<Component>().has(ent);
+    }
+
+    template <relation_data Relation>
+    [[nodiscard]] auto has(entity_param subject, entity_param object) -> bool {
+        return _rel_storage<Relation>().has(subject, object);
+    }
+
+    template <component_data... Components>
+    [[nodiscard]] auto has_all(entity_param ent) -> bool {
+        return (... and _cmp_storage<Components>().has(ent));
+    }
+
+    template <relation_data Relation>
+    [[nodiscard]] auto is(entity_param object, entity_param subject) -> bool {
+        return _rel_storage<Relation>().has(subject, object);
+    }
+
+    template <component_data Component>
+    [[nodiscard]] auto is_hidden(entity_param ent) -> bool {
+        return _cmp_storage<Component>().is_hidden(ent);
+    }
+
+    template <component_data... Components>
+    [[nodiscard]] auto are_hidden(entity_param ent) -> bool {
+        return (... and _cmp_storage<Components>().is_hidden(ent));
+    }
+
+    template <component_data... Components>
+    auto show(entity_param ent) -> auto& {
+        (..., _cmp_storage<Components>().show(ent));
+        return *this;
+    }
+
+    template <component_data... Components>
+    auto hide(entity_param ent) -> auto& {
+        (..., _cmp_storage<Components>().hide(ent));
+        return *this;
+    }
+
+    template <component_data... Components>
+    auto add(entity_param ent, Components&&... components) -> auto& {
+        (..., _cmp_storage<Components>().store(ent, std::move(components)));
+        return *this;
+    }
+
+    /// @brief Adds the components to the corresponding entities, in one batch.
+    /// @see basic_manager::add_bulk
+    template <component_data Component>
+    auto add_bulk(
+      std::span<const Entity> entities,
+      std::span<Component> components) -> auto& {
+        assert(entities.size() == components.size());
+        _cmp_storage<Component>().store_bulk(entities, components);
+        return *this;
+    }
+
+    template <component_data Component>
+    auto ensure(entity_param ent, std::type_identity<Component> = {})
+      -> manipulator<Component> {
+        return {_cmp_storage<Component>().store(ent, Component{}), false};
+    }
+
+    /// @brief Ensures that the entity with the specified key has Component.
+    /// @see basic_manager::ensure
+    ///
+    /// Storage must be the storage of Component specified in component_list.
+    template <
+      template <class, class> class Storage,
+      component_data Component,
+      typename Key>
+    auto ensure(const Key& key) -> manipulator<Component> {
+        using S = Storage<Entity, Component>;
+        auto& c_storage{_cmp_storage<Component>()};
+        static_assert(
+          std::is_same_v<std::remove_cvref_t<decltype(c_storage)>, S>);
+        if constexpr(requires(S& s) { s.ensure(key); }) {
+            return {c_storage.ensure(key), false};
+        } else {
+            return {c_storage.store(Entity(key), Component{}), false};
+        }
+    }
+
+    template <relation_data Relation>
+    auto add(entity_param subject, entity_param object, Relation&& rel)
+      -> manipulator<Relation> {
+        return {
+          _rel_storage<Relation>().store(
+            subject, object, std::forward<Relation>(rel)),
+          false};
+    }
+
+    template <relation_data Relation>
+    auto ensure(
+      entity_param subject,
+      entity_param object,
+      std::type_identity<Relation> = {}) -> bool {
+        return _rel_storage<Relation>().store(subject, object);
+    }
+
+    template <component_data Component>
+    auto copy(entity_param from, entity_param to) -> manipulator<Component> {
+        return {
+          static_cast<Component*>(_cmp_storage<Component>().copy(from, to)),
+          false};
+    }
+
+    template <component_data... Components>
+    auto copy(entity_param from, entity_param to) -> static_manager&
+        requires(sizeof...(Components) > 1)
+    {
+        (..., _cmp_storage<Components>().copy(from, to));
+        return *this;
+    }
+
+    template <component_data... Components>
+    auto exchange(entity_param e1, entity_param e2) -> auto& {
+        (..., _cmp_storage<Components>().exchange(e1, e2));
+        return *this;
+    }
+
+    template <component_data... Components>
+    auto remove(entity_param ent) -> auto& {
+        (..., _cmp_storage<Components>().remove(ent));
+        return *this;
+    }
+
+    template <relation_data Relation>
+    auto remove_relation(entity_param subject, entity_param object) -> auto& {
+        _rel_storage<Relation>().remove(subject, object);
+        return *this;
+    }
+
+    template <typename T, component_data Component>
+    [[nodiscard]] auto get(
+      T Component::*const mvp,
+      entity_param ent,
+      T res = T()) -> T {
+        assert(mvp);
+        const auto getter{[mvp, &res](entity_param, auto& cmp) {
+            res = cmp.read().*mvp;
+        }};
+        _cmp_storage<Component>().for_single(
+          callable_ref<void(entity_param, manipulator<const Component>&)>{
+            construct_from, getter},
+          ent);
+        return res;
+    }
+
+    template <component_data Component>
+    auto for_single(
+      entity_param ent,
+      const callable_ref<void(entity_param, manipulator<const Component>&)>&
+        func) -> auto& {
+        _cmp_storage<Component>().for_single(func, ent);
+        return *this;
+    }
+
+    template <component_data Component, typename Function>
+    auto read_single(entity_param ent, Function&& function) -> auto& {
+        return for_single(
+          ent,
+          callable_ref<void(entity_param, manipulator<const Component>&)>{
+            construct_from, std::forward<Function>(function)});
+    }
+
+    template <component_data... Component, typename Function>
+    auto read(entity_param ent, Function&& function) -> auto& {
+        std::tuple<manipulator<const Component>*...> ms{};
+        _join_at<0U, sizeof...(Component)>(ent, ms, function);
+        return *this;
+    }
+
+    template <component_data Component>
+    auto for_single(
+      entity_param ent,
+      const callable_ref<void(entity_param, manipulator<Component>&)>& func)
+      -> auto& {
+        _cmp_storage<Component>().for_single(func, ent);
+        return *this;
+    }
+
+    template <component_data Component, typename Function>
+    auto write_single(entity_param ent, Function&& function) -> auto& {
+        return for_single(
+          ent,
+          callable_ref<void(entity_param, manipulator<Component>&)>{
+            construct_from, std::forward<Function>(function)});
+    }
+
+    template <component_data... Component, typename Function>
+    auto write(entity_param ent, Function&& function) -> auto& {
+        std::tuple<manipulator<std::remove_const_t<Component>>*...> ms{};
+        _join_at<0U, sizeof...(Component)>(ent, ms, function);
+        return *this;
+    }
+
+    template <component_data Component>
+    auto for_each(
+      const callable_ref<void(entity_param, manipulator<const Component>&)>&
+        func) -> auto& {
+        _cmp_storage<Component>().for_each(func);
+        return *this;
+    }
+
+    /// @brief Calls function on each Component for reading.
+    ///
+    /// If the storage of Component has a for_each_direct loop the function
+    /// is called from it directly and can be inlined.
+    template <component_data Component, typename Function>
+    auto read_each(Function&& function) -> auto& {
+        _for_each_in<const Component>(function);
+        return *this;
+    }
+
+    template <component_data Component>
+    auto for_each(
+      const callable_ref<void(entity_param, manipulator<Component>&)>& func)
+      -> auto& {
+        _cmp_storage<Component>().for_each(func);
+        return *this;
+    }
+
+    /// @brief Calls function on each Component for writing.
+    /// @see read_each
+    template <component_data Component, typename Function>
+    auto write_each(Function&& function) -> auto& {
+        _for_each_in<Component>(function);
+        return *this;
+    }
+
+    /// @brief Same as read_each, the Storage is known at compile time anyway.
+    template <
+      template <class, class> class Storage,
+      component_data Component,
+      typename Function>
+    auto read_each(Function&& function) -> auto& {
+        return read_each<Component>(std::forward<Function>(function));
+    }
+
+    /// @brief Same as write_each, the Storage is known at compile time anyway.
+    template <
+      template <class, class> class Storage,
+      component_data Component,
+      typename Function>
+    auto write_each(Function&& function) -> auto& {
+        return write_each<Component>(std::forward<Function>(function));
+    }
+
+    template <relation_data Relation>
+    auto for_each_having(
+      const callable_ref<void(entity_param, entity_param)>& func) -> auto& {
+        _rel_storage<Relation>().for_each(func);
+        return *this;
+    }
+
+    /// @brief Calls func with each object with which the subject has Relation.
+    template <relation_data Relation>
+    auto for_each_object_of(
+      entity_param subject,
+      const callable_ref<void(entity_param, entity_param)>& func) -> auto& {
+        _rel_storage<Relation>().for_each(func, subject);
+        return *this;
+    }
+
+    /// @brief Calls func with each subject having Relation with the object.
+    template <relation_data Relation>
+    auto for_each_subject_of(
+      entity_param object,
+      const callable_ref<void(entity_param, entity_param)>& func) -> auto& {
+        _rel_storage<Relation>().for_each_subject_of(func, object);
+        return *this;
+    }
+
+    template <relation_data Relation>
+    auto for_each(
+      const callable_ref<
+        void(entity_param, entity_param, manipulator<const Relation>&)>& func)
+      -> auto& {
+        _rel_storage<Relation>().for_each(func);
+        return *this;
+    }
+
+    template <relation_data Relation>
+    auto for_each(
+      const callable_ref<
+        void(entity_param, entity_param, manipulator<Relation>&)>& func)
+      -> auto& {
+        _rel_storage<Relation>().for_each(func);
+        return *this;
+    }
+
+    /// @brief Calls func on each entity having all Components.
+    /// @see for_each_with
+    ///
+    /// The entities are visited in the order of the storage holding
+    /// the fewest components, the other storages are probed by entity.
+    template <component_data... Components>
+    auto for_each(
+      const callable_ref<void(entity_param, manipulator<Components>&...)>& func)
+      -> static_manager&
+        requires(sizeof...(Components) > 1)
+    {
+        _for_each_joined<Components...>(func);
+        return *this;
+    }
+
+    template <component_data... Components, typename Func>
+    auto for_each_with(const Func& func) -> auto& {
+        if constexpr(sizeof...(Components) == 1) {
+            _for_each_in<Components...>(func);
+        } else {
+            _for_each_joined<Components...>(func);
+        }
+        return *this;
+    }
+
+    /// @brief Swaps the current and next buffers of all double-buffered storages.
+    auto swap_buffers() -> auto& {
+        std::apply([](auto&... s) { (..., s.swap_buffers()); }, _cmp_storages);
+        std::apply([](auto&... s) { (..., s.swap_buffers()); }, _rel_storages);
+        return *this;
+    }
+
+private:
+    template <typename C>
+    static consteval auto _cmp_index() noexcept -> std::size_t {
+        return static_data_index<
+          std::remove_const_t<C>,
+          typename _cmp_spec_t<CS>::data_type...>();
+    }
+
+    template <typename R>
+    static consteval auto _rel_index() noexcept -> std::size_t {
+        return static_data_index<
+          std::remove_const_t<R>,
+          typename _rel_spec_t<RS>::data_type...>();
+    }
+
+    template <typename C>
+    auto _cmp_storage() noexcept -> auto& {
+        static_assert(
+          knows_component_type<std::remove_const_t<C>>(),
+          "component type not in the component_list");
+        return std::get<_cmp_index<C>()>(_cmp_storages);
+    }
+
+    template <typename R>
+    auto _rel_storage() noexcept -> auto& {
+        static_assert(
+          knows_relation_type<std::remove_const_t<R>>(),
+          "relation type not in the relation_list");
+        return std::get<_rel_index<R>()>(_rel_storages);
+    }
+
+    template <typename C, typename Func>
+    void _for_each_in(Func& func) {
+        auto& c_storage{_cmp_storage<C>()};
+        using S = std::remove_cvref_t<decltype(c_storage)>;
+        if constexpr(requires(S& s) { s.template for_each_direct<C>(func); }) {
+            c_storage.template for_each_direct<C>(func);
+        } else {
+            c_storage.for_each(
+              callable_ref<void(entity_param, manipulator<C>&)>{
+                construct_from, func});
+        }
+    }
+
+    // calls func with the manipulators in ms, filling in those
+    // at indices other than Skip from the storages, if e has them
+    template <std::size_t I, std::size_t Skip, typename Func, typename... C>
+    void _join_at(
+      entity_param e,
+      std::tuple<manipulator<C>*...>& ms,
+      const Func& func) {
+        if constexpr(I == sizeof...(C)) {
+            std::apply([&](auto*... m) { func(e, *m...); }, ms);
+        } else if constexpr(I == Skip) {
+            _join_at<I + 1U, Skip>(e, ms, func);
+        } else {
+            using Ci = std::tuple_element_t<I, std::tuple<C...>>;
+            const auto hlpr{[&](entity_param, manipulator<Ci>& m) {
+                std::get<I>(ms) = &m;
+                _join_at<I + 1U, Skip>(e, ms, func);
+            }};
+            _cmp_storage<Ci>().for_single(
+              callable_ref<void(entity_param, manipulator<Ci>&)>{
+                construct_from, hlpr},
+              e);
+        }
+    }
+
+    template <std::size_t D, typename... C, typename Func>
+    void _for_each_driven_by(const Func& func) {
+        using Driver = std::tuple_element_t<D, std::tuple<C...>>;
+        std::tuple<manipulator<C>*...> ms{};
+        auto hlpr{[&](entity_param e, manipulator<Driver>& m) {
+            std::get<D>(ms) = &m;
+            _join_at<0U, D>(e, ms, func);
+        }};
+        _for_each_in<Driver>(hlpr);
+    }
+
+    template <typename... C, typename Func>
+    void _for_each_joined(const Func& func) {
+        const std::array<std::size_t, sizeof...(C)> sizes{
+          _cmp_storage<C>().size()...};
+        const auto driver{std::size_t(
+          std::min_element(sizes.begin(), sizes.end()) - sizes.begin())};
+        [&]<std::size_t... D>(std::index_sequence<D...>) {
+            (void)(... or
+                   ((D == driver) and
+                    (_for_each_driven_by<D, C...>(func), true)));
+        }(std::make_index_sequence<sizeof...(C)>{});
+    }
+
+    typename entity_traits<Entity>::allocator_type _entities{};
+
+    std::tuple<typename _cmp_spec_t<CS>::template storage_type<Entity>...>
+      _cmp_storages;
+    std::tuple<typename _rel_spec_t<RS>::template storage_type<Entity>...>
+      _rel_storages;
+};
+//------------------------------------------------------------------------------
+} // namespace eagine::ecs
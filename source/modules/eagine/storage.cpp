@@ -17,6 +17,7 @@ import eagine.core.reflection;
 import eagine.core.utility;
 import :entity_traits;
 import :manipulator;
+import :snapshot;
 
 namespace eagine {
 namespace ecs {
@@ -44,7 +45,8 @@ export enum class storage_cap_bit : unsigned short {
     exchange = 1U << 3U,
     store = 1U << 4U,
     remove = 1U << 5U,
-    modify = 1U << 6U
+    modify = 1U << 6U,
+    unordered = 1U << 7U
 };
 //------------------------------------------------------------------------------
 export [[nodiscard]] auto operator|(
@@ -89,6 +91,12 @@ public:
     [[nodiscard]] auto can_modify() const noexcept -> bool {
         return has(storage_cap_bit::modify);
     }
+
+    /// @brief Indicates if the iterators visit the entities in ascending order.
+    /// @note Iterators of unordered storages seek an entity by direct lookup.
+    [[nodiscard]] auto is_ordered() const noexcept -> bool {
+        return not has(storage_cap_bit::unordered);
+    }
 };
 //------------------------------------------------------------------------------
 export auto all_storage_caps() noexcept -> storage_caps {
@@ -103,6 +111,141 @@ struct basic_manager_signals {
     signal<void(entity_param_t<Entity>) noexcept> entity_forgotten;
 };
 //------------------------------------------------------------------------------
+// Observers
+//------------------------------------------------------------------------------
+/// @brief Interface for observers of the entities in component storages.
+/// @ingroup ecs
+/// @see storage_observer_ref
+///
+/// The key is the value passed to the storage together with the observer.
+export template <typename Entity>
+struct storage_observer : interface<storage_observer<Entity>> {
+    /// @brief Called when a component was stored for the specified entity.
+    virtual void on_stored(std::size_t, entity_param_t<Entity>) noexcept = 0;
+
+    /// @brief Called when the component of the specified entity was removed.
+    virtual void on_removed(std::size_t, entity_param_t<Entity>) noexcept = 0;
+
+    /// @brief Called when the component of the specified entity was hidden.
+    virtual void on_hidden(std::size_t, entity_param_t<Entity>) noexcept = 0;
+
+    /// @brief Called when the component of the specified entity was shown.
+    virtual void on_shown(std::size_t, entity_param_t<Entity>) noexcept = 0;
+
+    /// @brief Called when the component of the specified entity was modified.
+    /// @note Any access through a non-const manipulator counts as modification.
+    virtual void on_modified(std::size_t, entity_param_t<Entity>) noexcept = 0;
+};
+//------------------------------------------------------------------------------
+/// @brief Optional reference to a storage_observer, used by storages.
+/// @ingroup ecs
+export template <typename Entity>
+class storage_observer_ref {
+public:
+    void reset(storage_observer<Entity>* observer, std::size_t key) noexcept {
+        _observer = observer;
+        _key = key;
+    }
+
+    /// @brief Indicates if an observer is set.
+    explicit operator bool() const noexcept {
+        return _observer != nullptr;
+    }
+
+    void stored(entity_param_t<Entity> e) const noexcept {
+        if(_observer) {
+            _observer->on_stored(_key, e);
+        }
+    }
+
+    void removed(entity_param_t<Entity> e) const noexcept {
+        if(_observer) {
+            _observer->on_removed(_key, e);
+        }
+    }
+
+    void hidden(entity_param_t<Entity> e) const noexcept {
+        if(_observer) {
+            _observer->on_hidden(_key, e);
+        }
+    }
+
+    void shown(entity_param_t<Entity> e) const noexcept {
+        if(_observer) {
+            _observer->on_shown(_key, e);
+        }
+    }
+
+    void modified(entity_param_t<Entity> e) const noexcept {
+        if(_observer) {
+            _observer->on_modified(_key, e);
+        }
+    }
+
+    void modified(std::span<const Entity> entities) const noexcept {
+        if(_observer) {
+            for(const auto& e : entities) {
+                _observer->on_modified(_key, e);
+            }
+        }
+    }
+
+private:
+    storage_observer<Entity>* _observer{nullptr};
+    std::size_t _key{0U};
+};
+//------------------------------------------------------------------------------
+/// @brief Storage observer forwarding the notifications to other observers.
+/// @ingroup ecs
+/// @see basic_manager::use_signatures
+/// @see basic_manager::view
+export template <typename Entity>
+class storage_observer_list final : public storage_observer<Entity> {
+public:
+    /// @brief Indicates if there are no observers in this list.
+    [[nodiscard]] auto empty() const noexcept -> bool {
+        return _observers.empty();
+    }
+
+    /// @brief Adds the specified observer to this list.
+    void add(storage_observer<Entity>& observer) {
+        _observers.push_back(&observer);
+    }
+
+    void on_stored(std::size_t key, entity_param_t<Entity> e) noexcept final {
+        for(const auto observer : _observers) {
+            observer->on_stored(key, e);
+        }
+    }
+
+    void on_removed(std::size_t key, entity_param_t<Entity> e) noexcept final {
+        for(const auto observer : _observers) {
+            observer->on_removed(key, e);
+        }
+    }
+
+    void on_hidden(std::size_t key, entity_param_t<Entity> e) noexcept final {
+        for(const auto observer : _observers) {
+            observer->on_hidden(key, e);
+        }
+    }
+
+    void on_shown(std::size_t key, entity_param_t<Entity> e) noexcept final {
+        for(const auto observer : _observers) {
+            observer->on_shown(key, e);
+        }
+    }
+
+    void on_modified(std::size_t key, entity_param_t<Entity> e) noexcept final {
+        for(const auto observer : _observers) {
+            observer->on_modified(key, e);
+        }
+    }
+
+private:
+    std::vector<storage_observer<Entity>*> _observers;
+};
+//------------------------------------------------------------------------------
 // Interfaces
 //------------------------------------------------------------------------------
 export template <typename Entity, data_kind>
@@ -156,6 +299,18 @@ struct storage_iterator_intf<Entity, data_kind::component>
 
     virtual void next() = 0;
 
+    /// @brief Moves forward to the first entity not less than the specified one.
+    /// @see find
+    ///
+    /// Never moves backward. Returns false if the iterator reached the end.
+    /// Implementations use the ordering of the storage to skip entities.
+    /// Iterators of unordered storages look the entity up directly instead
+    /// and move to the end if it is not stored.
+    /// @see storage_caps::is_ordered
+    virtual auto seek(entity_param_t<Entity>) -> bool = 0;
+
+    /// @brief Seeks to the specified entity, indicates if it was found.
+    /// @see seek
     virtual auto find(entity_param_t<Entity>) -> bool = 0;
 
     virtual auto current() -> Entity = 0;
@@ -214,6 +369,10 @@ public:
         return *this;
     }
 
+    auto seek(entity_param_t<Entity> e) -> bool {
+        return get().seek(e);
+    }
+
     auto find(entity_param_t<Entity> e) -> bool {
         return get().find(e);
     }
@@ -237,6 +396,13 @@ struct base_storage<Entity, data_kind::component>
 
     virtual void swap_buffers() = 0;
 
+    /// @brief Sets the observer notified about changes of the stored entities.
+    virtual void set_observer(storage_observer<Entity>*, std::size_t key) = 0;
+
+    /// @brief Returns the number of stored visible components.
+    /// @note May be an upper estimate, used for planning of joins.
+    virtual auto size() -> std::size_t = 0;
+
     virtual auto new_iterator(storage_buffer) -> iterator_t = 0;
 
     virtual void delete_iterator(iterator_t&&) = 0;
@@ -260,6 +426,18 @@ struct base_storage<Entity, data_kind::component>
     virtual auto remove(entity_param) -> bool = 0;
 
     virtual void remove(iterator_t&) = 0;
+
+    /// @brief Returns the layout of the components saved into a snapshot.
+    /// @see snapshot_section_header
+    virtual auto data_layout() -> snapshot_layout = 0;
+
+    /// @brief Saves the visible and then the hidden components into a snapshot.
+    /// @returns false if the components cannot be saved.
+    virtual auto save_snapshot(snapshot_writer&) -> bool = 0;
+
+    /// @brief Stores the components loaded from a snapshot.
+    /// @returns false if the snapshot data is not valid.
+    virtual auto load_snapshot(snapshot_reader&) -> bool = 0;
 };
 //------------------------------------------------------------------------------
 export template <typename Entity, typename Component>
@@ -273,6 +451,21 @@ struct storage<Entity, Component, data_kind::component>
     virtual auto store(iterator_t&, entity_param, Component&&)
       -> Component* = 0;
 
+    /// @brief Stores the components of the corresponding entities.
+    /// @see basic_manager::add_bulk
+    ///
+    /// The components are moved from. The result is the same as storing
+    /// the components one by one in order. This implementation does exactly
+    /// that; storages for which it is expensive merge the whole batch at once.
+    virtual void store_bulk(
+      std::span<const Entity> entities,
+      std::span<Component> components) {
+        assert(entities.size() == components.size());
+        for(std::size_t i = 0U; i < entities.size(); ++i) {
+            store(entities[i], std::move(components[i]));
+        }
+    }
+
     virtual void for_single(
       const callable_ref<void(entity_param, manipulator<const Component>&)>,
       entity_param) = 0;
@@ -296,6 +489,145 @@ struct storage<Entity, Component, data_kind::component>
       const callable_ref<void(entity_param, manipulator<Component>&)>) = 0;
 
     virtual void for_each(const callable_ref<void(manipulator<Component>&)>) = 0;
+
+    virtual void for_each_batch(
+      const callable_ref<
+        void(std::span<const Entity>, std::span<const Component>)>) = 0;
+
+    virtual void for_each_batch(
+      const callable_ref<
+        void(std::span<const Entity>, std::span<Component>)>) = 0;
+
+    /// @brief Returns the number of blocks of at most size visible components.
+    /// @see for_each_in_block
+    /// @see basic_manager::parallel_for_each
+    ///
+    /// The blocks can be visited concurrently. Storages that cannot be split
+    /// without visiting all components first return zero.
+    virtual auto block_count(std::size_t size) -> std::size_t {
+        return 0U;
+    }
+
+    /// @brief Calls a function on runs of components in the specified block.
+    /// @pre block < block_count(size)
+    ///
+    /// The storage must not be changed until all blocks are visited.
+    /// The observers are not notified about the modified components.
+    virtual void for_each_in_block(
+      std::size_t block,
+      std::size_t size,
+      const callable_ref<
+        void(std::span<const Entity>, std::span<const Component>)>) {}
+
+    /// @brief Calls a function on runs of components in the specified block.
+    /// @pre block < block_count(size)
+    virtual void for_each_in_block(
+      std::size_t block,
+      std::size_t size,
+      const callable_ref<void(std::span<const Entity>, std::span<Component>)>) {
+    }
+
+    /// @brief Calls a function on each hidden component.
+    /// @see save_snapshot
+    virtual void for_each_hidden(
+      const callable_ref<void(entity_param, manipulator<const Component>&)>) = 0;
+
+    auto data_layout() -> snapshot_layout final {
+        return snapshot_layout::of<Component>();
+    }
+
+    /// @brief Saves the components using snapshot_data of Component.
+    ///
+    /// The visible and the hidden components are saved as two blocks, each
+    /// sorted by entity, so that hidden components survive a reload.
+    auto save_snapshot(snapshot_writer& writer) -> bool override {
+        if constexpr(snapshot_data<Entity> and snapshot_data<Component>) {
+            std::vector<std::pair<Entity, const Component*>> entries;
+            entries.reserve(this->size());
+            const auto gather{
+              [&](entity_param e, manipulator<const Component>& m) {
+                  entries.emplace_back(e, &m.read());
+              }};
+            using gather_t =
+              callable_ref<void(entity_param, manipulator<const Component>&)>;
+
+            std::vector<Entity> entities;
+            const auto save_entries{[&] {
+                std::sort(
+                  entries.begin(),
+                  entries.end(),
+                  [](const auto& l, const auto& r) {
+                      return l.first < r.first;
+                  });
+                entities.clear();
+                entities.reserve(entries.size());
+                for(const auto& entry : entries) {
+                    entities.push_back(entry.first);
+                }
+                writer.write_value(std::uint64_t(entities.size()));
+                writer.write_values(std::span<const Entity>{entities});
+                if constexpr(std::is_trivially_copyable_v<Component>) {
+                    writer.align(alignof(Component));
+                }
+                for(const auto& entry : entries) {
+                    writer.write_value(*entry.second);
+                }
+                entries.clear();
+            }};
+
+            for_each(gather_t{construct_from, gather});
+            save_entries();
+            for_each_hidden(gather_t{construct_from, gather});
+            save_entries();
+            return true;
+        } else {
+            return false;
+        }
+    }
+
+    /// @brief Loads the components using snapshot_data of Component.
+    ///
+    /// The hidden components are stored and hidden again, unless the storage
+    /// cannot hide components, in which case they are not loaded.
+    auto load_snapshot(snapshot_reader& reader) -> bool override {
+        if constexpr(snapshot_data<Entity> and snapshot_data<Component>) {
+            std::vector<Entity> entities;
+            std::vector<Component> components;
+            const auto load_entries{[&]() -> bool {
+                std::uint64_t count{0U};
+                if(
+                  not reader.read_value(count) or
+                  (count > reader.remaining())) {
+                    return false;
+                }
+                entities.clear();
+                entities.resize(count);
+                if(not reader.read_values(std::span{entities})) {
+                    return false;
+                }
+                components.clear();
+                components.resize(count);
+                return reader.read_values(std::span{components});
+            }};
+
+            if(not load_entries()) {
+                return false;
+            }
+            store_bulk(entities, components);
+            if(not load_entries()) {
+                return false;
+            }
+            if(not entities.empty() and this->capabilities().can_hide()) {
+                store_bulk(entities, components);
+                for(const auto& e : entities) {
+                    this->hide(e);
+                }
+            }
+            return true;
+        } else {
+            return false;
+        }
+    }
 };
 //------------------------------------------------------------------------------
 //  Relation storage
@@ -387,6 +719,11 @@ struct base_storage<Entity, data_kind::relation>
 
     virtual void swap_buffers() = 0;
 
+    /// @brief Sets the observer notified about modified relations.
+    ///
+    /// Only the modifications are reported, with the subject of the relation.
+    virtual void set_observer(storage_observer<Entity>*, std::size_t key) = 0;
+
     virtual auto new_iterator(storage_buffer) -> iterator_t = 0;
 
     virtual void delete_iterator(iterator_t&&) = 0;
@@ -404,6 +741,23 @@ struct base_storage<Entity, data_kind::relation>
       entity_param subject) = 0;
 
     virtual void for_each(callable_ref<void(entity_param, entity_param)>) = 0;
+
+    /// @brief Calls a function on each subject related to the specified object.
+    virtual void for_each_subject_of(
+      const callable_ref<void(entity_param, entity_param)>,
+      entity_param object) = 0;
+
+    /// @brief Returns the layout of the relations saved into a snapshot.
+    /// @see snapshot_section_header
+    virtual auto data_layout() -> snapshot_layout = 0;
+
+    /// @brief Saves the relations, sorted by subject and object, to a snapshot.
+    /// @returns false if the relations cannot be saved.
+    virtual auto save_snapshot(snapshot_writer&) -> bool = 0;
+
+    /// @brief Stores the relations loaded from a snapshot.
+    /// @returns false if the snapshot data is not valid.
+    virtual auto load_snapshot(snapshot_reader&) -> bool = 0;
 };
 //------------------------------------------------------------------------------
 export template <typename Entity, typename Relation>
@@ -458,6 +812,84 @@ struct storage<Entity, Relation, data_kind::relation>
     virtual void for_each(
       const callable_ref<
         void(entity_param, entity_param, manipulator<Relation>&)>) = 0;
+
+    auto data_layout() -> snapshot_layout final {
+        return snapshot_layout::of<Relation>();
+    }
+
+    /// @brief Saves the relations using snapshot_data of Relation.
+    auto save_snapshot(snapshot_writer& writer) -> bool override {
+        if constexpr(snapshot_data<Entity> and snapshot_data<Relation>) {
+            std::vector<std::tuple<Entity, Entity, const Relation*>> entries;
+            const auto gather{[&](
+                                entity_param subject,
+                                entity_param object,
+                                manipulator<const Relation>& m) {
+                entries.emplace_back(subject, object, &m.read());
+            }};
+            using gather_t = callable_ref<void(
+              entity_param, entity_param, manipulator<const Relation>&)>;
+            for_each(gather_t{construct_from, gather});
+            std::sort(
+              entries.begin(), entries.end(), [](const auto& l, const auto& r) {
+                  return std::tie(std::get<0>(l), std::get<1>(l)) <
+                         std::tie(std::get<0>(r), std::get<1>(r));
+              });
+
+            std::vector<Entity> subjects;
+            std::vector<Entity> objects;
+            subjects.reserve(entries.size());
+            objects.reserve(entries.size());
+            for(const auto& entry : entries) {
+                subjects.push_back(std::get<0>(entry));
+                objects.push_back(std::get<1>(entry));
+            }
+            writer.write_value(std::uint64_t(entries.size()));
+            writer.write_values(std::span<const Entity>{subjects});
+            writer.write_values(std::span<const Entity>{objects});
+            if constexpr(std::is_trivially_copyable_v<Relation>) {
+                writer.align(alignof(Relation));
+            }
+            for(const auto& entry : entries) {
+                writer.write_value(*std::get<2>(entry));
+            }
+            return true;
+        } else {
+            return false;
+        }
+    }
+
+    /// @brief Loads the relations using snapshot_data of Relation.
+    auto load_snapshot(snapshot_reader& reader) -> bool override {
+        if constexpr(snapshot_data<Entity> and snapshot_data<Relation>) {
+            std::uint64_t count{0U};
+            if(not reader.read_value(count) or (count > reader.remaining())) {
+                return false;
+            }
+            std::vector<Entity> subjects(count);
+            std::vector<Entity> objects(count);
+            if(
+              not reader.read_values(std::span{subjects}) or
+              not reader.read_values(std::span{objects})) {
+                return false;
+            }
+            if constexpr(std::is_trivially_copyable_v<Relation>) {
+                if(not reader.align(alignof(Relation))) {
+                    return false;
+                }
+            }
+            for(std::size_t i = 0; i < subjects.size(); ++i) {
+                Relation relation{};
+                if(not reader.read_value(relation)) {
+                    return false;
+                }
+                store(subjects[i], objects[i], std::move(relation));
+            }
+            return true;
+        } else {
+            return false;
+        }
+    }
 };
 } // namespace ecs
 //------------------------------------------------------------------------------
@@ -465,14 +897,15 @@ export template <>
 struct enumerator_traits<ecs::storage_cap_bit> {
     static constexpr auto mapping() noexcept {
         using ecs::storage_cap_bit;
-        return enumerator_map_type<storage_cap_bit, 7>{
+        return enumerator_map_type<storage_cap_bit, 8>{
           {{"double_buffer", storage_cap_bit::double_buffer},
            {"hide", storage_cap_bit::hide},
            {"copy", storage_cap_bit::copy},
            {"exchange", storage_cap_bit::exchange},
            {"store", storage_cap_bit::store},
            {"remove", storage_cap_bit::remove},
-           {"modify", storage_cap_bit::modify}}};
+           {"modify", storage_cap_bit::modify},
+           {"unordered", storage_cap_bit::unordered}}};
     }
 };
 //------------------------------------------------------------------------------
@@ -0,0 +1,232 @@
+/// @file
+///
+/// Copyright Matus Chochlik.
+/// Distributed under the Boost Software License, Version 1.0.
+/// See accompanying file LICENSE_1_0.txt or copy at
+/// https://www.boost.org/LICENSE_1_0.txt
+///
+module;
+
+#include <cassert>
+
+export module eagine.ecs:view;
+
+import std;
+import eagine.core.types;
+import :entity_traits;
+import :storage;
+
+namespace eagine::ecs {
+//------------------------------------------------------------------------------
+/// @brief Cached sorted list of the entities having all of a set of components.
+/// @ingroup ecs
+/// @see basic_manager::view
+/// @see basic_view
+///
+/// The components are identified by component_index. The storages notify
+/// the view through the storage_observer interface and the entities with
+/// changed viewed components are recorded into a pre-reserved buffer,
+/// without locking. The recorded entities are merged into the cached list
+/// on the next access, so the list is kept up to date incrementally and
+/// does not change while it is being iterated. If the buffer is full,
+/// the list is rebuilt from the storages instead.
+///
+/// The view also keeps the addresses of the components of the listed
+/// entities, gathered during an iteration. These are dropped when any of
+/// the viewed components is stored, removed, hidden or shown. Archetype
+/// tables move their rows also when components of other types change,
+/// so views of components in tables drop them on any change.
+export template <typename Entity>
+class entity_view final : public storage_observer<Entity> {
+public:
+    using entity_param = entity_param_t<Entity>;
+
+    /// @brief Construction with the sorted indices of the viewed components.
+    entity_view(std::vector<std::size_t> indices) noexcept
+      : _indices{std::move(indices)} {}
+
+    /// @brief Indicates if the view includes the component with the index.
+    [[nodiscard]] auto observes(std::size_t index) const noexcept -> bool {
+        return std::binary_search(_indices.begin(), _indices.end(), index);
+    }
+
+    /// @brief Returns the position of the component with the index in a row.
+    /// @pre observes(index)
+    [[nodiscard]] auto position(std::size_t index) const noexcept
+      -> std::size_t {
+        return std::size_t(std::distance(
+          _indices.begin(),
+          std::lower_bound(_indices.begin(), _indices.end(), index)));
+    }
+
+    /// @brief Returns the number of viewed components.
+    [[nodiscard]] auto width() const noexcept -> std::size_t {
+        return _indices.size();
+    }
+
+    void on_stored(std::size_t index, entity_param e) noexcept final {
+        _touch(index, e);
+    }
+
+    void on_removed(std::size_t index, entity_param e) noexcept final {
+        _touch(index, e);
+    }
+
+    void on_hidden(std::size_t index, entity_param e) noexcept final {
+        _touch(index, e);
+    }
+
+    void on_shown(std::size_t index, entity_param e) noexcept final {
+        _touch(index, e);
+    }
+
+    void on_modified(std::size_t, entity_param) noexcept final {}
+
+    /// @brief Marks the view to be rebuilt from the storages.
+    /// @see needs_rebuild
+    void invalidate() noexcept {
+        _rows_valid.store(false, std::memory_order_relaxed);
+        _rebuild.store(true, std::memory_order_relaxed);
+    }
+
+    /// @brief Indicates if the view must be rebuilt from the storages.
+    /// @see assign
+    [[nodiscard]] auto needs_rebuild() const noexcept -> bool {
+        return _rebuild.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Replaces the cached entities with the specified ones.
+    /// @param moving_rows indicates if the components are in archetype tables.
+    void assign(std::vector<Entity> entities, bool moving_rows) {
+        std::sort(entities.begin(), entities.end());
+        _entities = std::move(entities);
+        _moving_rows = moving_rows;
+        _rows_valid.store(false, std::memory_order_relaxed);
+        _reserve_changed();
+        _rebuild.store(false, std::memory_order_relaxed);
+    }
+
+    /// @brief Merges the recorded changed entities into the cached list.
+    /// @param has_all indicates if an entity has all the viewed components.
+    /// @pre not needs_rebuild()
+    template <typename Predicate>
+    void refresh(const Predicate& has_all) {
+        const auto count{std::min(
+          _changed_count.load(std::memory_order_relaxed), _changed.size())};
+        if(count == 0U) {
+            return;
+        }
+        const auto changed{std::span{_changed}.first(count)};
+        std::sort(changed.begin(), changed.end());
+        const auto changed_end{std::unique(changed.begin(), changed.end())};
+
+        std::vector<Entity> merged;
+        merged.reserve(_entities.size() + count);
+        auto pos{changed.begin()};
+        const auto add_if{[&](entity_param e) {
+            if(has_all(e)) {
+                merged.push_back(e);
+            }
+        }};
+        for(const auto& e : _entities) {
+            while((pos != changed_end) and (*pos < e)) {
+                add_if(*pos++);
+            }
+            if((pos != changed_end) and (*pos == e)) {
+                add_if(*pos++);
+            } else {
+                merged.push_back(e);
+            }
+        }
+        while(pos != changed_end) {
+            add_if(*pos++);
+        }
+        _entities.swap(merged);
+        _reserve_changed();
+    }
+
+    /// @brief Returns the cached entities, in ascending order.
+    [[nodiscard]] auto entities() const noexcept -> std::span<const Entity> {
+        return {_entities};
+    }
+
+    /// @brief Returns the cached component addresses, if gathered with key.
+    /// @see gather_rows
+    ///
+    /// There is a row of width() addresses for each of the entities,
+    /// ordered by the indices of the components. The key identifies
+    /// the components accessed for writing, for which double-buffered
+    /// storages return other addresses than for reading.
+    [[nodiscard]] auto rows(std::uint64_t key) const noexcept
+      -> std::span<void* const> {
+        if(rows_valid() and (_rows_key == key)) {
+            return {_rows};
+        }
+        return {};
+    }
+
+    /// @brief Indicates if the storages did not change since gather_rows.
+    [[nodiscard]] auto rows_valid() const noexcept -> bool {
+        return _rows_valid.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Starts gathering the component addresses of the entities.
+    /// @see add_row
+    /// @see finish_rows
+    void gather_rows(std::uint64_t key) {
+        _rows.clear();
+        _rows.reserve(_entities.size() * width());
+        _rows_key = key;
+        _rows_valid.store(true, std::memory_order_relaxed);
+    }
+
+    /// @brief Appends the component addresses of the next entity.
+    void add_row(std::span<void* const> row) {
+        assert(row.size() == width());
+        _rows.insert(_rows.end(), row.begin(), row.end());
+    }
+
+    /// @brief Keeps the gathered addresses if the storages did not change.
+    void finish_rows() noexcept {
+        if(_rows.size() != _entities.size() * width()) {
+            _rows_valid.store(false, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    std::vector<std::size_t> _indices;
+    std::vector<Entity> _entities;
+    // the entities with changed viewed components, filled from the front
+    std::vector<Entity> _changed;
+    std::atomic<std::size_t> _changed_count{0U};
+    std::vector<void*> _rows;
+    std::uint64_t _rows_key{0U};
+    std::atomic<bool> _rows_valid{false};
+    std::atomic<bool> _rebuild{true};
+    bool _moving_rows{false};
+
+    void _reserve_changed() {
+        _changed.resize(std::max<std::size_t>(64U, _entities.size() / 4U));
+        _changed_count.store(0U, std::memory_order_relaxed);
+    }
+
+    void _touch(std::size_t index, entity_param e) noexcept {
+        if(observes(index)) {
+            _rows_valid.store(false, std::memory_order_relaxed);
+            const auto pos{
+              _changed_count.fetch_add(1U, std::memory_order_relaxed)};
+            if(pos < _changed.size()) {
+                try {
+                    _changed[pos] = e;
+                    return;
+                } catch(...) {
+                }
+            }
+            _rebuild.store(true, std::memory_order_relaxed);
+        } else if(_moving_rows) {
+            _rows_valid.store(false, std::memory_order_relaxed);
+        }
+    }
+};
+//------------------------------------------------------------------------------
+} // namespace eagine::ecs
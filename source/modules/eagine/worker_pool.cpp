@@ -0,0 +1,155 @@
+/// @file
+///
+/// Copyright Matus Chochlik.
+/// Distributed under the Boost Software License, Version 1.0.
+/// See accompanying file LICENSE_1_0.txt or copy at
+/// https://www.boost.org/LICENSE_1_0.txt
+///
+module;
+
+#include <cassert>
+
+export module eagine.ecs:worker_pool;
+
+import std;
+import eagine.core.utility;
+
+namespace eagine::ecs {
+//------------------------------------------------------------------------------
+/// @brief Pool of threads running the parallel passes of basic_manager.
+/// @ingroup ecs
+/// @see basic_manager::parallel_for_each
+///
+/// The calling thread participates in each job. The indices of a job are
+/// handed out dynamically, so threads finishing early pick up the remaining
+/// work instead of waiting for a static partition.
+export class worker_pool {
+public:
+    /// @brief Constructs a pool using all available hardware threads.
+    worker_pool()
+      : worker_pool{std::max(std::thread::hardware_concurrency(), 1U) - 1U} {}
+
+    /// @brief Constructs a pool with the specified number of extra threads.
+    explicit worker_pool(std::size_t worker_count) {
+        _workers.reserve(worker_count);
+        for(std::size_t w = 0; w < worker_count; ++w) {
+            _workers.emplace_back([this] { _run(); });
+        }
+    }
+
+    worker_pool(worker_pool&&) = delete;
+    worker_pool(const worker_pool&) = delete;
+    auto operator=(worker_pool&&) = delete;
+    auto operator=(const worker_pool&) = delete;
+
+    ~worker_pool() noexcept {
+        {
+            const std::unique_lock lock{_mutex};
+            _stop = true;
+        }
+        _start_cv.notify_all();
+    }
+
+    /// @brief Returns the number of threads running a job, with the caller.
+    [[nodiscard]] auto thread_count() const noexcept -> std::size_t {
+        return _workers.size() + 1U;
+    }
+
+    /// @brief Calls func with each index in [0, count) and waits for it.
+    /// @note The first exception thrown by func is re-thrown in the caller.
+    ///
+    /// Calls made from inside a running job are executed sequentially
+    /// by the calling thread.
+    void for_each_index(
+      std::size_t count,
+      const callable_ref<void(std::size_t)> func) {
+        if(count == 0U) {
+            return;
+        }
+        if(_workers.empty() or (count == 1U) or _inside_job) {
+            for(std::size_t i = 0; i < count; ++i) {
+                func(i);
+            }
+            return;
+        }
+        const std::unique_lock job_lock{_job_mutex};
+        {
+            const std::unique_lock lock{_mutex};
+            _job = &func;
+            _job_count = count;
+            _next_index = 0U;
+            _busy = _workers.size();
+            _error = {};
+            ++_generation;
+        }
+        _start_cv.notify_all();
+        _work();
+        std::unique_lock lock{_mutex};
+        _done_cv.wait(lock, [this] { return _busy == 0U; });
+        _job = nullptr;
+        if(_error) {
+            std::rethrow_exception(std::exchange(_error, {}));
+        }
+    }
+
+private:
+    std::mutex _job_mutex;
+    std::mutex _mutex;
+    std::condition_variable _start_cv;
+    std::condition_variable _done_cv;
+    const callable_ref<void(std::size_t)>* _job{nullptr};
+    std::size_t _job_count{0U};
+    std::atomic<std::size_t> _next_index{0U};
+    std::size_t _busy{0U};
+    std::size_t _generation{0U};
+    std::exception_ptr _error;
+    bool _stop{false};
+    std::vector<std::jthread> _workers;
+
+    static inline thread_local bool _inside_job{false};
+
+    void _work() noexcept {
+        assert(_job);
+        _inside_job = true;
+        try {
+            while(true) {
+                const auto i{_next_index.fetch_add(1U)};
+                if(i >= _job_count) {
+                    break;
+                }
+                (*_job)(i);
+            }
+        } catch(...) {
+            const std::unique_lock lock{_mutex};
+            if(not _error) {
+                _error = std::current_exception();
+            }
+            _next_index = _job_count;
+        }
+        _inside_job = false;
+    }
+
+    void _run() noexcept {
+        std::size_t generation{0U};
+        while(true) {
+            {
+                std::unique_lock lock{_mutex};
+                _start_cv.wait(lock, [&] {
+                    return _stop or (_generation != generation);
+                });
+                if(_stop) {
+                    return;
+                }
+                generation = _generation;
+            }
+            _work();
+            {
+                const std::unique_lock lock{_mutex};
+                --_busy;
+            }
+            _done_cv.notify_one();
+        }
+    }
+};
+//------------------------------------------------------------------------------
+} // namespace eagine::ecs